@@ -8,6 +8,33 @@
  * Header File
  *
  * Feb 19, 2011  Original Design
+ * Oct 17, 2026  Update the directory in the calling thread for
+ *               local blocks instead of sending self requests.
+ * Oct 17, 2026  Invalidate all sharers of a block at once.
+ * Oct 17, 2026  Answer the requests with a pool of service workers,
+ *               requests on one directory entry are still serialized.
+ * Oct 17, 2026  Requests on a busy directory entry wait in a queue,
+ *               no more TAG_ACK_RETRY and backoff.
+ * Oct 17, 2026  Keep the local directory in a compact vsdirectory.
+ * Oct 17, 2026  Choose the cache replacement policy at construction,
+ *               add GetCacheStatistics().
+ * Oct 17, 2026  Split the local cache into shards with their own locks.
+ * Oct 17, 2026  A cleaner thread writes back the cold dirty blocks
+ *               ahead of their eviction, TAG_REQ_CLEAN.
+ * Oct 17, 2026  Evicted dirty blocks wait their write back in a victim
+ *               buffer, TAG_REQ_VICTIM.
+ * Oct 17, 2026  Take the message buffers from a vsbufpool.
+ * Oct 17, 2026  A local disk cache of the clean remote blocks, checked
+ *               by their versions, TAG_REQ_BLOCK_VERSION.
+ * Oct 17, 2026  Write back only the dirty sectors of a block.
+ * Oct 17, 2026  Or only its dirty byte ranges.
+ * Oct 17, 2026  ReadStorage(), reads of the local storage run concurrently.
+ * Oct 17, 2026  A lsal_queue in ServiceBuffers.
+ * Oct 17, 2026  AckStorageBlock()
+ * Oct 17, 2026  Drop the self request tags, no node sends them.
+ * Oct 17, 2026  Request queues on the busy entries, shared by the workers.
+ * Oct 17, 2026  Sync()
+ * Oct 17, 2026  SetSectoredCoherence()
  *
  */
 
@@ -17,10 +44,15 @@
 #include "vstype.h"
 #include "vsmutex.h"
 #include "vscache.h"
+#include "vsdirectory.h"
+#include "vsarena.h"
+#include "vsdiskcache.h"
 #include "mpal.h"
 #include "lsal.h"
 #include <pthread.h>
-#include <set>
+#include <deque>
+#include <map>
+#include <vector>
 
 namespace vlaser {
 
@@ -32,14 +64,26 @@ namespace vlaser {
    * coherence protocol.
    *
    * 1) Class cpl uses a second thread as service thread for
-   * handling coherence protocol requests from other nodes.
-   * All the requests will queue in message passing abstract
-   * layer and will be processed one at a time.
+   * receiving coherence protocol requests from other nodes.
+   * Requests on directory entries are passed to a pool of
+   * service workers. The requests on a busy entry wait in the
+   * entry's queue, so they are processed one at a time in their
+   * arriving order, while any idle worker takes a request of
+   * another entry.
    * 2) All requests have their acknowledgement message.
    * 3) Class cpl uses point-to-point communication, and
    * does not support broadcasting.
    * 4) The local directory is used to record the memory block's
    * cache-copy holder and the cache status.
+   * 5) A cleaner thread writes back the dirty blocks at the cold
+   * end of the replacement order, so a cache miss seldom waits
+   * for writing back its victim. The cleaned block stays in cache
+   * as EXCLUSIVE.
+   * 6) An optional disk cache keeps the clean remote blocks replaced
+   * from the local cache. The home counts a version of each block,
+   * raised when the block is given as exclusive, and a block read
+   * again from the disk cache is used only if its version is still
+   * the home's.
    *
    */
 
@@ -59,9 +103,11 @@ namespace vlaser {
      * the block size, number of blocks that the cache has,
      * number of blocks the local storage has, the node's vlaser id,
      * number of nodes, message passing abstract layer's pointer
-     * local storage abstract layer's pointer
+     * local storage abstract layer's pointer, the number of
+     * service worker threads, and the cache replacement policy
      */
-    cpl(BlockSize bsize, vsaddr csize, vsaddr lvolume, vsnodeid thisid, vsnodeid nm, mpal* pmp, lsal* pls);
+    cpl(BlockSize bsize, vsaddr csize, vsaddr lvolume, vsnodeid thisid, vsnodeid nm, mpal* pmp, lsal* pls, int wnum = 4,
+      ReplacementPolicy policy = REPLACE_LRU);
 
     virtual ~cpl();
 
@@ -87,6 +133,37 @@ namespace vlaser {
      */
     void WaitShutDown();
 
+    /* hits, misses and evictions of the local cache so far */
+    void GetCacheStatistics(vscache::Statistics& st);
+
+    /* the durability barrier of this node. the blocks written to the
+     * local storage so far are durable when it returns, the dirty
+     * blocks still in the caches are not. it is done by the shutdown
+     * sequence as well
+     */
+    void Sync();
+
+    /* watermarks of the cleaner in percent of a cache shard's blocks,
+     * call it before Initialize(). the cleaner keeps the low coldest
+     * blocks clean, and when more than high blocks are dirty, it cleans
+     * the coldest ones until low are left. high 0 turns the cleaner off
+     */
+    void SetWriteBackWatermarks(int high, int low);
+
+    /* keep up to n replaced clean remote blocks in a disk cache at the
+     * file path, call it before Initialize(). the file is removed when
+     * it is opened
+     */
+    void SetDiskCache(const char* path, vsaddr n);
+
+    /* keep the coherence of the remote blocks by sectors, 1/64 of a
+     * block each, call it before Initialize() on every node. a write
+     * takes only the sectors it touches as exclusive, the other holders
+     * keep the rest of their shared copies, and only the sectors the
+     * writer has not got are shipped. see SectoredRequest()
+     */
+    void SetSectoredCoherence();
+
     const int block_size;
     const vsaddr local_block_num; // how many blocks local storage has
     const vsaddr cache_block_num; // how many blocks cache has
@@ -94,9 +171,19 @@ namespace vlaser {
     const vsnodeid node_num; // how many nodes the whole system has
 
     const int cache_holder_advice_num;
+    const int worker_num; // how many service worker threads
 
   protected:
 
+    /* private resource of a thread which updates the directory or answers requests */
+    typedef struct {
+      vsbyte* send_buf;
+      vsbyte* recv_buf;
+      vsnodeid* ser_dests; /* holder list of a directory entry, node_num rooms */
+      lsal_queue* io_queue; /* asynchronous requests on the local storage */
+      vsbyte* io_buf; /* a block read while the directory is being updated */
+    } ServiceBuffers;
+
     /* coherence protocol message's tags */
     enum MessageTag {
       TAG_REQ_BLOCK                = 0, //request a read only block
@@ -112,49 +199,73 @@ namespace vlaser {
       TAG_SHUTDOWN                 = 8, //shutdown signal
       TAG_FINISH                   = 9, //finish signal
 
-      TAG_SELF_REQ_BLOCK           = 10, //request a read only block from local serivce
-      TAG_SELF_REQ_BLOCK_EXCLUSIVE = 11, //request a exclusive block from local service
+      TAG_REQ_CLEAN                = 12, //request writing back a dirty block which stays in cache
+      TAG_CLEAN_DONE               = 13, //tell the requester of TAG_REQ_CLEAN the result
+      TAG_REQ_VICTIM               = 14, //request writing back an evicted dirty block without waiting the ack
+      TAG_VICTIM_DONE              = 15, //tell the requester of TAG_REQ_VICTIM it is done
+      TAG_REQ_BLOCK_VERSION        = 16, //request a read only block unless the version the requester has is current
+      TAG_REQ_NUM                  = 17, //the tags of the requests are below it
 
       TAG_ACK_BLOCK_SHARED         = 21, //ack the block as shared
       TAG_ACK_BLOCK_EXCLUSIVE      = 22, //ack the block as exclusived
       TAG_ACK_ASK_OTHER            = 23, //ack the advice list
       TAG_ACK_NOBLOCK              = 24, //ack no such block 
       TAG_ACK_CONFIRM              = 25, //ack confirm
-      TAG_ACK_RETRY                = 26, //request failed because of ser sending timeout
+      TAG_ACK_VERSION_VALID        = 26, //ack the version of TAG_REQ_BLOCK_VERSION is current
       TAG_ACK_NOT_HOLDER           = 27, //ack the overdue request
 
       TAG_SER_SET_WRITEBACK        = 28, //ack to a set with the block writeback
       TAG_SER_SET_CONFIRM          = 29, //confirm the set
       TAG_SER_READY                = 30,
-      TAG_SER_BEGIN                = 31
+      TAG_SER_BEGIN                = 31,
+      TAG_SER_SET_KEPT             = 32  //confirm the set, some sectors of the shared block are kept
     };
 
-    /* member function pointer table for the 12 requests' response procedures */
-    void (cpl::*resp_table[12])(vsnodeid, vsaddr, vsaddr);
+    /* member function pointer table for the requests' response procedures */
+    void (cpl::*resp_table[TAG_REQ_NUM])(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
 
     /* request response methods */
-    void Resp_req_block(vsnodeid, vsaddr, vsaddr);
-    void Resp_req_cached_block(vsnodeid, vsaddr, vsaddr);
-    void Resp_req_block_this_node(vsnodeid, vsaddr, vsaddr);
-    void Resp_req_block_exclusive(vsnodeid, vsaddr, vsaddr);
-    void Resp_req_exclusive(vsnodeid, vsaddr, vsaddr);
-    void Resp_req_writeback(vsnodeid, vsaddr, vsaddr);
-    void Resp_set_invalid(vsnodeid, vsaddr, vsaddr);
-    void Resp_set_shared(vsnodeid, vsaddr, vsaddr);
-    void Resp_shutdown(vsnodeid, vsaddr, vsaddr);
-    void Resp_finish(vsnodeid, vsaddr, vsaddr);
-    void Resp_self_req_block(vsnodeid, vsaddr, vsaddr);
-    void Resp_self_req_block_exclusive(vsnodeid, vsaddr, vsaddr);
+    void Resp_req_block(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_cached_block(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_block_this_node(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_block_exclusive(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_exclusive(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_writeback(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_set_invalid(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_set_shared(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_shutdown(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_finish(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_clean(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_clean_done(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_victim(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_victim_done(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+    void Resp_req_block_version(ServiceBuffers&, vsnodeid, vsaddr, vsaddr);
+
+    /* ack a block to source with its version appended, the data may be
+     * in sb.send_buf already. caller holds the entry's DirMutex()
+     */
+    void AckBlock(ServiceBuffers& sb, vsnodeid source, int tag, vsbyte* data, vsaddr localaddr);
 
-    void MakeRespTable();
+    /* ack the block of the local storage, copied straight from the
+     * storage if it is mapped. caller holds the entry's DirMutex()
+     */
+    void AckStorageBlock(ServiceBuffers& sb, vsnodeid source, int tag, vsaddr localaddr);
+
+    /* ack the sectors of mask of the block data to source as exclusive,
+     * packed in address order with the version after them. caller holds
+     * the entry's DirMutex()
+     */
+    void AckSectors(ServiceBuffers& sb, vsnodeid source, vsbyte* data, unsigned long long mask, vsaddr localaddr);
 
-    /* backoff_counter records how many times the Backoff()
-     * method has been called yet
+    /* ack the block from this node as TAG_REQ_BLOCK_THIS_NODE does, after
+     * the directory is updated to the status st. caller holds the entry's
+     * DirMutex()
      */
-    int backoff_counter;
+    void AckHomeBlock(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr, int st);
+
+    void MakeRespTable();
+
     void MakeRandomSeed();
-    void Backoff(); /* backoff for a interval */
-    void CleanBackoffCounter(); /* clean the backoff_counter to 0 */
 
     /* three statuses of a block in local directory */
     enum StorageDirectoryStatus {
@@ -164,37 +275,82 @@ namespace vlaser {
     };
 
 
-    typedef std::set<vsnodeid> TypeOfHolderList;
-
-    typedef struct {
-      StorageDirectoryStatus status;
-      TypeOfHolderList holders;
-    } StorageDirectory;
-
-
     /*
      * multi-thread-shared resources
      */
-    vscache* plocal_cache;
+    vscache** cache_shards; /* the local cache, use CacheOf() to get the shard of a block */
+    int cache_shard_num;
     mpal* pmessage_passing;
     lsal* plocal_storage;
-    StorageDirectory* local_dir;
+    vsdirectory* local_dir;
     
     /* mutex for local directory, cache, and local stroage
-     * respectively
+     * respectively. the directory is locked by stripes,
+     * use DirMutex() to get the mutex of an entry, and each
+     * cache shard has its mutex, use CacheMutex() to get it.
+     * a thread holds one cache shard's mutex at a time, or
+     * all of them in ascending order
+     */
+    vlamutex* dir_mutex;
+    int dir_mutex_num;
+    vlamutex* cache_mutex;
+    vlamutex storage_mutex; /* for the writes, and the reads if lsal::ConcurrentRead() is 0 */
+    /* one mutex for each node, held from sending a TAG_SET_INVALID or
+     * TAG_SET_SHARED request to the node until its answer is received,
+     * lock them in ascending order of node id
+     */
+    vlamutex* ser_mutex;
+
+    /*
+     * the sectored coherence.
+     * the directory is still kept for whole blocks, and a node given a
+     * block as exclusive is its owner, which may write the sectors it
+     * has. the other holders may keep shared copies of the sectors the
+     * owner has not got, so the holder list of a DIR_EXCLUSIVE entry
+     * has the owner and them, and the owner is in dir_owner.
+     * TAG_REQ_BLOCK_EXCLUSIVE carries the sectors the requester wants
+     * and the ones to be shipped, and TAG_SET_INVALID the sectors wanted.
+     * an owner told to set invalid writes back and drops its whole copy,
+     * a shared holder drops the sectors only, and answers
+     * TAG_SER_SET_KEPT if it keeps others. a shared copy missing a sector
+     * read is read again whole, as a miss. the local blocks in the home's
+     * own cache are always whole
+     */
+    int sectored;
+    vsnodeid* dir_owner; /* owner of each DIR_EXCLUSIVE local block, NULL if not sectored */
+
+    /* source is the exclusive holder of the local block, caller holds the entry's DirMutex() */
+    int IsOwner(vsaddr localaddr, vsnodeid source);
+
+    /* the exclusive holder has written the local block back and left it,
+     * caller holds the entry's DirMutex()
      */
-    vlamutex dir_mutex, cache_mutex, storage_mutex;
+    void DropOwner(vsaddr localaddr);
+
+    vlamutex& DirMutex(vsaddr localaddr) { return dir_mutex[localaddr % dir_mutex_num]; }
+    vscache* CacheOf(vsaddr globaladdr) { return cache_shards[globaladdr % cache_shard_num]; }
+    vlamutex& CacheMutex(vsaddr globaladdr) { return cache_mutex[globaladdr % cache_shard_num]; }
+
     volatile int finish_signal; //finish signal used for shutdown sequence
     volatile int is_message_service_ready;
-    volatile int io_busy; //indecates if read or write method is running
+    volatile int io_busy; //how many read, write or cleaning methods are running
+    volatile int io_waiting; //service thread is waiting io_busy changing to 0
+
+    /* mark the beginning and the end of a read, write or cleaning method.
+     * BeginIO() returns 0 if the method must not run
+     */
+    int BeginIO();
+    void EndIO();
 
     const int message_buf_size;
 
+    /* all message buffers of message_buf_size bytes, thread safe */
+    vsbufpool* message_pool;
+
     /*
      * message service thread's private resource
      */
-    vsbyte* send_buf;
-    vsbyte* recv_buf;
+    ServiceBuffers service_bufs;
     
     /*
      * indicates which node start the shutdown sequence
@@ -208,23 +364,201 @@ namespace vlaser {
     vsbyte* vsaddr_tag_only_buf;
     pthread_t service_thread_id;
 
+    ServiceBuffers self_bufs; // for SelfUpdateDirectory()
+
+    /* a request waiting for a service worker */
+    typedef struct {
+      vsnodeid source;
+      int tag;
+      vsaddr gaddr;
+      vsbyte* data; /* the received message if the worker needs it, or NULL */
+    } ServiceJob;
+
+    /* a service worker thread */
+    struct ServiceWorker {
+      cpl* owner;
+      pthread_t thread_id;
+      ServiceBuffers bufs; /* worker's private resource */
+    };
+    ServiceWorker* workers;
+
+    /*
+     * the requests waiting for the workers, under job_mutex.
+     * an entry is busy while one of its requests is runnable or being
+     * answered, and then it has a deque in pending_jobs, where its later
+     * requests wait in arriving order. runnable_jobs holds at most one
+     * request of each entry, and any idle worker takes the first one.
+     * when a worker finishes a request, the next one of the entry
+     * becomes runnable, so a slow request only holds up its own entry
+     */
+    vlamutex job_mutex;
+    vlacond job_cond; /* signaled when a job becomes runnable */
+    std::deque<ServiceJob> runnable_jobs;
+    std::map<vsaddr, std::deque<ServiceJob> > pending_jobs; /* by local address of the busy entries */
+    volatile int workers_stop;
+
+    /*
+     * the cleaner.
+     * a remote block is written back by TAG_REQ_CLEAN, its home answers
+     * with TAG_CLEAN_DONE, so the cleaner never waits on the message
+     * channels shared with the other threads. until TAG_CLEAN_DONE
+     * arrives, the block is pinned and its address is in the shard's
+     * cleaning list, and the main thread does not request the block,
+     * so a late TAG_REQ_CLEAN never overwrites the storage of a newer copy
+     */
+    int clean_high, clean_low; /* watermarks in percent of a shard */
+    pthread_t cleaner_thread_id;
+    vlamutex cleaner_mutex;
+    vlacond cleaner_cond; /* wakes the cleaner before its interval passes */
+    volatile int cleaner_stop;
+    vsbyte* clean_buf; /* cleaner's private resource */
+    std::vector<vsaddr> clean_list;
+    std::vector<vsaddr>* cleaning; /* each shard's blocks waiting TAG_CLEAN_DONE, under the shard's mutex */
+    vlacond** writeback_cond; /* bound to the shard's mutex, broadcast when a clean or a victim is done */
+    volatile unsigned long long cleaned_num; /* blocks cleaned ahead of time */
+
+    /*
+     * the victim buffer.
+     * an evicted dirty remote block is copied to the buffer of its shard
+     * and sent by TAG_REQ_VICTIM, the main thread goes on fetching the
+     * new block. the home answers with TAG_VICTIM_DONE, until then the
+     * buffer answers TAG_SET_INVALID and TAG_SET_SHARED of the block,
+     * and the main thread does not request it again. a victim in flight
+     * counts in io_busy, so the shutdown sequence waits it
+     */
+    typedef struct {
+      vsaddr addr;
+      int busy; /* waiting TAG_VICTIM_DONE */
+      int dirty; /* the home has not got the data by a TAG_SET_* answer */
+      vsbyte* mes; /* the TAG_REQ_VICTIM message, address and dirty sectors */
+      int len; /* bytes of mes */
+    } VictimBlock;
+    VictimBlock* victims; /* each shard's buffer, under the shard's mutex, use VictimsOf() */
+
+    VictimBlock* VictimsOf(vsaddr globaladdr);
+
+    /* the busy victim of address addr, or NULL */
+    VictimBlock* FindVictim(vsaddr addr);
+
+    /* move the dirty block addr from its shard to the victim buffer and
+     * return the message to send and its length, or NULL if it is not
+     * dirty any more. called with the shard's mutex held, wait for a free
+     * entry
+     */
+    vsbyte* PutVictim(vsaddr addr, int& len);
+
+    /* write back the block of the holder source to the local storage as
+     * TAG_REQ_WRITEBACK does, return 1 if it is written.
+     * caller holds the entry's DirMutex()
+     */
+    int AcceptWriteBack(vsnodeid source, vsaddr localaddr, vsbyte* data);
+
+    /* wait until no write back of the block addr is in flight, with its shard's mutex held */
+    void WaitWriteBack(vsaddr addr);
+
+    void WakeCleaner();
+
+    /*
+     * the disk cache, used by the main thread only.
+     * each local block has a version, changed under the entry's
+     * DirMutex() whenever a node is given the block as exclusive,
+     * so the data of a version does not change after a node has
+     * read it as shared. the blocks acked from the home carry their
+     * version after the data, and the advice list carries it after
+     * the holders
+     */
+    vsdiskcache* pdisk_cache; /* NULL if there is no disk cache */
+    vsaddr* block_version; /* local blocks' versions */
+    vsbyte* disk_buf; /* main thread's buffer for reading the disk cache */
+    unsigned long long disk_hits, disk_stales;
+
+    /* put the clean shared remote block addr being replaced to the disk cache,
+     * called with the shard's mutex unlocked after the block is chosen,
+     * the main thread does not change its data until it pushes the new block
+     */
+    void SpillVictim(vscache* pcache, vlamutex& cmutex, vsaddr addr);
+
+    /* write back the cold dirty blocks of a shard as the watermarks say */
+    void CleanShard(int shard);
+
+    /* cleaner thread main code */
+    void CleanerThread();
+    static void* _cleaner_routine(void* pclass);
+    void StartCleaner();
+    void StopCleaner();
+
+    void NewServiceBuffers(ServiceBuffers& sb);
+    void FreeServiceBuffers(ServiceBuffers& sb);
+
     void PackAddr(vsaddr addr, vsbyte* packed);
     void UnpackAddr(vsbyte* packed, vsaddr& addr);
 
+    /* a sector mask is packed as two addresses, DIRTY_MASK_SIZE bytes */
+    void PackMask(unsigned long long mask, vsbyte* packed);
+    void UnpackMask(vsbyte* packed, unsigned long long& mask);
+
+    /* copy the sectors of mask from data to mes in address order and return
+     * the bytes copied, or copy them back from mes to data
+     */
+    int PackSectors(vsbyte* data, unsigned long long mask, vsbyte* mes);
+    int UnpackSectors(vsbyte* mes, unsigned long long mask, vsbyte* data);
+
+    /*
+     * a block written back is sent as its dirty mask, DIRTY_MASK_SIZE
+     * bytes, followed by the sectors the mask has, in address order.
+     * the whole block has a mask of all ones. when the block's dirty
+     * byte ranges are fewer bytes, the mask is 0 and followed by the
+     * number of ranges, and each range's offset, length and data
+     */
+    /* pack the dirty part of the block addr of pcache, whose data is data,
+     * to mes, return the bytes packed
+     */
+    int PackDirty(vscache* pcache, vsaddr addr, vsbyte* data, vsbyte* mes);
+
+    /* read a local block, a block is never read while it is written,
+     * as the writes hold the entry's DirMutex(), and the reads hold it
+     * or the shard's mutex of a block cached by this node
+     */
+    void ReadStorage(vsaddr localaddr, vsbyte* buf);
+
+    /* write the sectors packed in mes to the local block, caller holds storage_mutex */
+    void WriteDirty(vsaddr localaddr, vsbyte* mes);
+
     /*
      * output a list of node ids which are holding a specific block
      */
-    int AdviseCacheHolder(vsaddr localaddr, vsbyte* mes);
+    int AdviseCacheHolder(ServiceBuffers& sb, vsaddr localaddr, vsbyte* mes);
 
     /*
      * update the specific block's directory status according to
      * the expected new status st and the requester's id source_id.
-     * the block is indecated by glocaladdr and localaddr
+     * the block is indecated by glocaladdr and localaddr.
+     * caller holds the entry's DirMutex(), so the requests on a
+     * busy entry wait in its worker queue until this returns
+     */
+    int UpdateDirectory(ServiceBuffers& sb, vsaddr globaladdr, vsaddr localaddr, StorageDirectoryStatus st, vsnodeid source_id,
+      unsigned long long want = ~0ULL);
+
+    /* UpdateDirectory() of the sectored coherence, source_id wants the
+     * sectors of want if st is DIR_EXCLUSIVE
      */
-    int UpdateDirectory(vsaddr globaladdr, vsaddr localaddr, StorageDirectoryStatus st, vsnodeid source_id);
+    int UpdateSectored(ServiceBuffers& sb, vsaddr globaladdr, vsaddr localaddr, StorageDirectoryStatus st, vsnodeid source_id,
+      unsigned long long want);
 
-    /* wait a request and then handle it*/
+    /*
+     * update a local block's directory for this node in the calling thread,
+     * return the status set as UpdateDirectory() does
+     */
+    int SelfUpdateDirectory(vsaddr globaladdr, StorageDirectoryStatus st);
+
+    /* wait a request and then handle it or pass it to a worker */
     void CopeWithOneReq();
+
+    /* service worker threads main code */
+    void ServiceWorkerThread(ServiceWorker& w);
+    static void* _worker_routine(void* pworker);
+    void StartWorkers();
+    void StopWorkers();
     
     /* service thread main code */
     void MessageServiceThread();
@@ -234,6 +568,14 @@ namespace vlaser {
     void WriteWithinBlock(vsaddr addr, int startpoint, int count, vsbyte* buf);
     void ReadWithinBlock(vsaddr addr, int startpoint, int count, vsbyte* buf);
 
+    /* make this node the owner of the remote block addr in its cache,
+     * with the sectors of count bytes from startpoint valid. the ones the
+     * bytes cover whole are not shipped if overwrite is 1. return the
+     * block's data with the shard's mutex held, or NULL with it unlocked
+     * if the block is lost meanwhile, then the caller tries again
+     */
+    vsbyte* SectoredRequest(vsaddr addr, int startpoint, int count, int overwrite);
+
   }; //end class cpl declaration
 
 } //end namespace vlaser
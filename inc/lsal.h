@@ -10,6 +10,17 @@
  *
  * Feb 16, 2011  Original Design
  * May 15, 2011  Add class lsal_air
+ * Oct 17, 2026  lsal_air::Initialize() and Finalize() return 0
+ * Oct 17, 2026  Rd() and Wr() of lsal_fileemulate and lsal_air, for
+ *               writing back parts of a block.
+ * Oct 17, 2026  Sync() and ConcurrentRead(), lsal_fileemulate uses
+ *               positional I/O without O_SYNC.
+ * Oct 17, 2026  class lsal_queue for asynchronous reads and writes,
+ *               lsal::NewQueue().
+ * Oct 17, 2026  Alignment(), lsal_fileemulate may bypass the page cache.
+ * Oct 17, 2026  BlockPointer()
+ * Oct 17, 2026  RdBlocks() and WrBlocks(), lsal_fileemulate coalesces
+ *               the adjacent blocks, lsal_queue submits by them.
  *
  */
 
@@ -17,10 +28,14 @@
 #define _VLASER_LSAL_H_
 
 #include "vstype.h"
+#include "vsarena.h"
+#include <stddef.h>
 #include <stdexcept>
 
 namespace vlaser {
 
+  class lsal_queue;
+
   /*
    * CLASS lsal
    * 
@@ -30,7 +45,10 @@ namespace vlaser {
    * 1) local storage is block storage,
    * has only RdBlock() and WrBlock() interface
    * 2) whether is lsal thread safe is undefined,
-   * it depends on specific implementation.
+   * it depends on specific implementation. if
+   * ConcurrentRead() returns 1, reads may run at the
+   * same time with each other and with the writes.
+   * 3) the blocks written are durable after Sync().
    *
    */
 
@@ -68,8 +86,21 @@ namespace vlaser {
 
     virtual void WrBlock(vsaddr blockno, vsbyte* buf) = 0;
 
-    /* random access version of read and write.
-     * reserved for functional integrity.
+    /* read or write n blocks, blocknos[i] to or from bufs[i]. an
+     * implementation may reorder them, the same block written twice
+     * keeps the order.
+     */
+    virtual void RdBlocks(const vsaddr* blocknos, vsbyte* const* bufs, int n) {
+      for(int i = 0; i < n; ++i)
+        RdBlock(blocknos[i], bufs[i]);
+    }
+    virtual void WrBlocks(const vsaddr* blocknos, vsbyte* const* bufs, int n) {
+      for(int i = 0; i < n; ++i)
+        WrBlock(blocknos[i], bufs[i]);
+    }
+
+    /* random access version of read and write, within a block.
+     * writing back the dirty sectors of a block uses Wr().
      */
     virtual int Rd(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size) {
       throw lsal_logic_error("lsal::Rd() method has been called: from lsal::Rd()");
@@ -79,33 +110,144 @@ namespace vlaser {
       throw lsal_logic_error("lsal::Wr() method has been called: from lsal::Wr()");
       return 0;
     }
+
+    /* make the blocks written so far durable */
+    virtual void Sync() {}
+
+    /* return 1 if RdBlock() and Rd() need no lock */
+    virtual int ConcurrentRead() { return 0; }
+
+    /* the blocks read to or written from buffers aligned to this
+     * are not copied, 0 if any buffer is good
+     */
+    virtual size_t Alignment() { return 0; }
+
+    /* the block in memory, if the storage is mapped, or else NULL.
+     * reading it needs the same locks as RdBlock(), it is written
+     * by WrBlock() and Wr() only.
+     */
+    virtual vsbyte* BlockPointer(vsaddr /* blockno */) { return NULL; }
+
+    /* a new queue of asynchronous requests on this storage, holding
+     * at most depth requests. the caller deletes it.
+     */
+    virtual lsal_queue* NewQueue(int depth);
+    /* class interface end */
+  };
+
+  /*
+   * CLASS lsal_queue
+   *
+   * A queue of asynchronous block reads and writes
+   * on a lsal, owned by one thread.
+   *
+   * 1) RdBlockAsync() and WrBlockAsync() queue a request
+   * with a tag, Submit() starts all the queued requests at
+   * once, Complete() waits for one of them to finish and
+   * gives its tag. Requests finish in any order.
+   * 2) the buffer of a request is in use until it finishes.
+   * 3) the requests need the same locks as RdBlock() and
+   * WrBlock(), held until they finish.
+   * 4) this version keeps the requests until Submit(), then
+   * runs them in the caller, each run of reads or of writes by
+   * one RdBlocks() or WrBlocks(). a lsal with asynchronous I/O
+   * returns its own queue.
+   *
+   */
+
+  class lsal_queue {
+  public:
+    lsal_queue(lsal* pls, int dp);
+    virtual ~lsal_queue();
+
+    /* class interface */
+
+    const int depth; /* most requests queued or in flight */
+
+    virtual void RdBlockAsync(vsaddr blockno, vsbyte* buf, void* tag);
+
+    virtual void WrBlockAsync(vsaddr blockno, vsbyte* buf, void* tag);
+
+    /* start the queued requests, return how many */
+    virtual int Submit();
+
+    /* wait for a request to finish and give its tag,
+     * return 0 if no request is queued or in flight
+     */
+    virtual int Complete(void*& tag);
+
+    /* requests queued or in flight */
+    int Pending() { return pending; }
+
     /* class interface end */
+
+  protected:
+    lsal* storage;
+    int pending;
+    void** done; /* tags of the requests run by this class, a ring of depth */
+    int done_head;
+    int done_num;
+    /* the requests kept until Submit() */
+    vsaddr* waiting_blocks;
+    vsbyte** waiting_bufs;
+    void** waiting_tags;
+    int* waiting_writes;
+    int waiting_num;
+
+    void Reserve();
+    void Keep(vsaddr blockno, vsbyte* buf, void* tag, int write);
   };
 
   /* linux file emulating version of lsal.
-   * not thread safe, use mutex outside
-   * the class for synchronization.
+   * the reads and writes are positional, so reads
+   * need no lock, the writes are serialized outside
+   * the class. the writes are durable after Sync().
+   * with DIRECT_IO the file is opened with O_DIRECT, out
+   * of the page cache, the blocks go to and from aligned
+   * buffers directly, and other buffers and the parts of
+   * a block through a pool of aligned buffers. if the file
+   * system can not do it, the file is opened as usual.
+   * RdBlocks() and WrBlocks() sort the blocks, and do the
+   * adjacent ones in one preadv64() or pwritev64().
    */
   class lsal_fileemulate : public lsal {
   public:
-    lsal_fileemulate(BlockSize bs, vsaddr vol, const char* fp);
+    enum {
+      DIRECT_IO = 1
+    };
+    lsal_fileemulate(BlockSize bs, vsaddr vol, const char* fp, int flags = 0);
     ~lsal_fileemulate();
     int Initialize();
     int Finalize();
     void RdBlock(vsaddr blockno, vsbyte* buf); 
     void WrBlock(vsaddr blockno, vsbyte* buf);
-  private:
+    void RdBlocks(const vsaddr* blocknos, vsbyte* const* bufs, int n);
+    void WrBlocks(const vsaddr* blocknos, vsbyte* const* bufs, int n);
+    int Rd(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size);
+    int Wr(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size);
+    void Sync();
+    int ConcurrentRead() { return 1; }
+    size_t Alignment() { return align; }
+  protected:
     int fd; /* file descriptor */
+    size_t align; /* 0 if not opened with O_DIRECT */
+    vsbufpool* bounce_pool; /* aligned buffers for the copies, NULL if not O_DIRECT */
+
+    int Aligned(const vsbyte* buf) { return ((size_t)buf & (align - 1)) == 0; }
+    void Blocks(const vsaddr* blocknos, vsbyte* const* bufs, int n, int write);
   };
 
   class lsal_air: public lsal {
   public:
     lsal_air(BlockSize bs, vsaddr vol) : lsal(bs, vol) {}
     ~lsal_air() {}
-    int Initialize() {}
-    int Finalize() {}
-    void RdBlock(vsaddr blockno, vsbyte* buf) {}
-    void WrBlock(vsaddr blockno, vsbyte* buf) {}
+    int Initialize() { return 0; }
+    int Finalize() { return 0; }
+    void RdBlock(vsaddr /* blockno */, vsbyte* /* buf */) {}
+    void WrBlock(vsaddr /* blockno */, vsbyte* /* buf */) {}
+    int Rd(vsaddr /* blockno */, blockoffset /* pos */, vsbyte* /* buf */, blockoffset size) { return size; }
+    int Wr(vsaddr /* blockno */, blockoffset /* pos */, vsbyte* /* buf */, blockoffset size) { return size; }
+    int ConcurrentRead() { return 1; }
   };
 } // end namespace vlaser
 
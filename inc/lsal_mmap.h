@@ -0,0 +1,67 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Storage Memory Mapped Implementation
+ * class vlaser::lsal_mmap
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  ClearDirty()
+ *
+ */
+
+#ifndef _VLASER_LSAL_MMAP_H_
+#define _VLASER_LSAL_MMAP_H_
+
+#include "vstype.h"
+#include "lsal.h"
+#include <stddef.h>
+
+namespace vlaser {
+
+  /*
+   * CLASS lsal_mmap
+   *
+   * Class lsal_mmap maps the whole local storage file,
+   * for the nodes whose storage fits in the memory.
+   *
+   * 1) the reads and writes are memory copies, without
+   * system calls, BlockPointer() gives the block itself.
+   * 2) the file is extended to the storage size, never
+   * shrunk.
+   * 3) the blocks written are marked dirty, Sync() flushes
+   * the runs of dirty blocks by msync(). the writes and
+   * Sync() are serialized outside the class, cpl does it by
+   * storage_mutex in cpl::Sync().
+   *
+   */
+
+  class lsal_mmap : public lsal {
+  public:
+    lsal_mmap(BlockSize bs, vsaddr vol, const char* fp);
+    ~lsal_mmap();
+    int Initialize() { return 0; }
+    int Finalize();
+    void RdBlock(vsaddr blockno, vsbyte* buf);
+    void WrBlock(vsaddr blockno, vsbyte* buf);
+    int Rd(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size);
+    int Wr(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size);
+    void Sync();
+    int ConcurrentRead() { return 1; }
+    vsbyte* BlockPointer(vsaddr blockno);
+  protected:
+    int fd;
+    vsbyte* base; /* the mapping */
+    size_t map_size;
+    unsigned char* dirty_map; /* a bit for each block written since Sync() */
+
+    void MarkDirty(vsaddr blockno) { dirty_map[blockno >> 3] |= 1 << (blockno & 7); }
+    int IsDirty(vsaddr blockno) { return dirty_map[blockno >> 3] & (1 << (blockno & 7)); }
+    void ClearDirty(vsaddr blockno) { dirty_map[blockno >> 3] &= ~(1 << (blockno & 7)); }
+  };
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_LSAL_MMAP_H_
@@ -0,0 +1,108 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Storage io_uring Implementation
+ * class vlaser::lsal_uring
+ * class vlaser::lsal_uring_queue
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  O_DIRECT flag of lsal_fileemulate.
+ * Oct 17, 2026  Requests off the ring run in Submit().
+ *
+ */
+
+#ifndef _VLASER_LSAL_URING_H_
+#define _VLASER_LSAL_URING_H_
+
+#include "vstype.h"
+#include "lsal.h"
+#include <stddef.h>
+
+namespace vlaser {
+
+  /*
+   * CLASS lsal_uring
+   *
+   * Class lsal_uring is the file emulating lsal whose
+   * queues run on linux io_uring, so a thread keeps many
+   * reads and writes in flight and does other work while
+   * they go. RdBlock() and WrBlock() are those of
+   * lsal_fileemulate, so are the flags.
+   *
+   */
+
+  class lsal_uring : public lsal_fileemulate {
+  public:
+    lsal_uring(BlockSize bs, vsaddr vol, const char* fp, int flags = 0) : lsal_fileemulate(bs, vol, fp, flags) {}
+    ~lsal_uring() {}
+    lsal_queue* NewQueue(int depth);
+  };
+
+  /*
+   * CLASS lsal_uring_queue
+   *
+   * 1) every queue has its own ring, set up by the
+   * io_uring system calls, without liburing.
+   * 2) the queued requests go to the kernel in one
+   * io_uring_enter() call in Submit(), Complete() waits
+   * in the kernel only if no completion is in the ring.
+   * 3) if the kernel has no io_uring, the queue works as
+   * lsal_queue does, running the requests in Submit(). so does
+   * a request on a buffer not aligned for O_DIRECT.
+   *
+   */
+
+  class lsal_uring_queue : public lsal_queue {
+  public:
+    lsal_uring_queue(lsal_uring* pls, int fd, int dp);
+    ~lsal_uring_queue();
+
+    void RdBlockAsync(vsaddr blockno, vsbyte* buf, void* tag);
+    void WrBlockAsync(vsaddr blockno, vsbyte* buf, void* tag);
+    int Submit();
+    int Complete(void*& tag);
+
+  protected:
+
+    typedef struct {
+      void* tag;
+      vsbyte* buf;
+      vsaddr blockno;
+      int write;
+    } Request;
+
+    int file_fd;
+    int ring_fd; /* -1 if the kernel has no io_uring */
+    int queued; /* requests not submitted yet */
+    Request* requests;
+    int* free_requests; /* a stack of free request numbers */
+    int free_num;
+
+    /* the rings shared with the kernel */
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    void* sqes;
+    void* cqes;
+    void* sq_ring;
+    void* cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    void Queue(vsaddr blockno, vsbyte* buf, void* tag, int write);
+
+    /* finish a request the kernel did only part of */
+    void Finish(Request& req, int done);
+  };
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_LSAL_URING_H_
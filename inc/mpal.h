@@ -87,7 +87,7 @@ namespace vlaser {
   protected:
 
     enum MessageChannel {
-      MPAL_REQ, MPAL_ACK, MPAL_COMFIRM
+      MPAL_REQ, MPAL_ACK, MPAL_SER, MPAL_CHANNEL_NUM
     };
 
   }; //end class mpal declaration
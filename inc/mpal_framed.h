@@ -0,0 +1,94 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing Abstract Layer
+ * abstract class vlaser::mpal_framed
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#ifndef _VLASER_MPAL_FRAMED_H_
+#define _VLASER_MPAL_FRAMED_H_
+
+#include "vstype.h"
+#include "mpal.h"
+#include "mpal_inbox.h"
+#include <stdexcept>
+
+namespace vlaser {
+
+  /*
+   * CLASS mpal_framed
+   *
+   * Class mpal_framed implements the mpal primitives
+   * on top of frames, for the transports which only
+   * move frames between nodes.
+   *
+   * 1) A transport implements PostFrame() for sending, and puts
+   * every frame it receives to the inbox.
+   * 2) TrySerReqSend() is a handshake: the receiver confirms a
+   * FRAME_TRY message when WaitReq() takes it, then the sender
+   * sends FRAME_GO, or FRAME_CANCEL if no confirming arrives in time.
+   * 3) DeliverTo() lets a transport put its frames to another
+   * transport's inbox, so one node can mix transports.
+   *
+   */
+
+  class mpal_framed : public mpal {
+  public:
+    mpal_framed(vsnodeid id, vsnodeid num);
+
+    virtual ~mpal_framed();
+
+    /* standard interface derives from mpal */
+
+    int ReqSend(vsnodeid dest, int tag, vsbyte* buf, int count);
+    int WaitReq(vsnodeid& source, int& tag, vsbyte* buf, int count);
+    int AckSend(vsnodeid dest, int tag, vsbyte* buf, int count);
+    int WaitAck(vsnodeid source, int& tag, vsbyte* buf, int count);
+    int SerSend(vsnodeid dest, int tag, vsbyte* buf, int count);
+    int WaitSer(vsnodeid source, int& tag, vsbyte* buf, int count);
+    int TrySerReqSend(vsnodeid dest, int tag, vsbyte* buf, int count);
+
+    /* transport primitive, send one frame to dest on the channel.
+     * FRAME_CONFIRM frames go back to the sender of a FRAME_TRY message.
+     */
+    virtual void PostFrame(int channel, vsnodeid dest, int kind, int tag, unsigned int seq, vsbyte* buf, int count) = 0;
+
+    /* put all received frames to owner's inbox from now on,
+     * must be called before Initialize()
+     */
+    void DeliverTo(mpal_framed* owner);
+
+    /* class interface end */
+
+  protected:
+
+    enum {
+      MPAL_CTL = MPAL_CHANNEL_NUM, /* control channel for TestOnFrames() */
+      MPAL_FRAMED_CHANNEL_NUM
+    };
+
+    volatile int is_initialized;
+    mpal_inbox* pinbox; /* where the received frames go */
+    mpal_inbox* own_inbox;
+    unsigned int try_seq; /* last sequence number used by TrySerReqSend() */
+
+    /* Test() on the control channel, node 0 gathers every node's flag
+     * and sends the result back
+     */
+    int TestOnFrames(unsigned char flag);
+
+  private:
+
+    void Take(int channel, vsnodeid source, int& tag, vsbyte* buf, int count);
+
+  }; //end class mpal_framed declaration
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_MPAL_FRAMED_H_
@@ -0,0 +1,124 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing Abstract Layer
+ * class vlaser::mpal_inbox
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  Keep only the expected confirmings, no timed out seq is kept
+ *
+ */
+
+#ifndef _VLASER_MPAL_INBOX_H_
+#define _VLASER_MPAL_INBOX_H_
+
+#include "vstype.h"
+#include "vsmutex.h"
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace vlaser {
+
+  /*
+   * CLASS mpal_inbox
+   *
+   * Class mpal_inbox keeps the incoming messages of a node
+   * for the mpal implementations.
+   *
+   * 1) A receive engine Put()s every complete frame, the frames
+   * are queued per channel and per source node, so waiting
+   * a message of one source never picks up another source's message.
+   * 2) Frames of the TrySerReqSend() handshake are not queued:
+   * confirmings and decisions are kept aside for WaitConfirm()
+   * and WaitDecision(), a cancelled frame still in queue is dropped.
+   * 3) All methods are thread safe.
+   *
+   */
+
+  class mpal_inbox {
+  public:
+
+    /* frame kinds carried by the transports */
+    enum FrameKind {
+      FRAME_DATA, /* an ordinary message */
+      FRAME_TRY, /* a message sent by TrySerReqSend(), must be confirmed */
+      FRAME_CONFIRM, /* receiver has taken the FRAME_TRY message */
+      FRAME_GO, /* sender accepts the confirming, message is valid */
+      FRAME_CANCEL /* sender has given up, message must be dropped */
+    };
+
+    typedef struct {
+      int channel;
+      vsnodeid source;
+      int kind;
+      int tag;
+      unsigned int seq; /* sequence number of FRAME_TRY handshake */
+      int count; /* bytes in data */
+      vsbyte* data;
+    } Frame;
+
+    mpal_inbox(vsnodeid num, int chnum);
+
+    ~mpal_inbox();
+
+    const vsnodeid node_num;
+    const int channel_num;
+
+    /* a frame with count bytes data space, to be filled and Put() */
+    Frame* NewFrame(int count);
+
+    void FreeFrame(Frame* f);
+
+    /* hand over a complete frame, the inbox owns it afterwards */
+    void Put(Frame* f);
+
+    /* block until a message arrives from the source on the channel */
+    Frame* Take(int channel, vsnodeid source);
+
+    /* block until a message arrives from any source on the channel,
+     * messages are taken in their arriving order
+     */
+    Frame* TakeAny(int channel);
+
+    /* the FRAME_TRY message seq to dest is to be sent, so its
+     * confirming is kept for WaitConfirm(). call it before sending.
+     */
+    void Expect(vsnodeid dest, unsigned int seq);
+
+    /* block until the dest confirms the FRAME_TRY message seq,
+     * return 0 if it does not in timeout microseconds.
+     * a timeout seq is forgotten, a late confirming of it is dropped.
+     */
+    int WaitConfirm(vsnodeid dest, unsigned int seq, int timeout);
+
+    /* block until the source decides on the FRAME_TRY message seq,
+     * return FRAME_GO or FRAME_CANCEL
+     */
+    int WaitDecision(vsnodeid source, unsigned int seq);
+
+  private:
+
+    typedef std::pair<vsnodeid, unsigned int> TypeOfSeqKey;
+
+    vlamutex inbox_mutex;
+    vlacond message_cond; /* signaled when a message is queued */
+    vlacond handshake_cond; /* signaled when a confirming or decision arrives */
+
+    std::deque<Frame*>* queues; /* indexed by channel * node_num + source */
+    std::list<vsnodeid>* arrivals; /* arriving order of the sources, one list per channel */
+    std::set<TypeOfSeqKey> confirms; /* confirmings not yet waited */
+    std::set<TypeOfSeqKey> expected; /* seqs being waited or to be waited by WaitConfirm() */
+    std::map<TypeOfSeqKey, int> decisions; /* decisions not yet waited */
+
+    Frame* PopFrom(int channel, vsnodeid source);
+  };
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_MPAL_INBOX_H_
@@ -0,0 +1,66 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing In-Process Implementation
+ * class vlaser::mpal_inproc
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#ifndef _VLASER_MPAL_INPROC_H_
+#define _VLASER_MPAL_INPROC_H_
+
+#include "vstype.h"
+#include "mpal_framed.h"
+#include <stdexcept>
+
+namespace vlaser {
+
+  /*
+   * CLASS mpal_inproc
+   *
+   * Class mpal_inproc is in-process implementation of
+   * abstract bass class mpal, all nodes live in one process.
+   *
+   * 1) Sending a frame puts it to the dest node's inbox directly,
+   * no network and no configuration files are involved.
+   * 2) The nodes find each other through an array of node_num
+   * pointers shared by all of them, every node must be constructed
+   * before any node is initialized.
+   *
+   */
+
+  class mpal_inproc : public mpal_framed {
+  public:
+
+    /* nodes: array of num pointers shared by all nodes of the process,
+     * the constructor puts this node to nodes[id]
+     */
+    mpal_inproc(vsnodeid id, vsnodeid num, mpal_inproc** nodes);
+    virtual ~mpal_inproc();
+
+    /* standard interface derives from mpal */
+
+    int Test(unsigned char flag);
+    int Initialize();
+    int Finalize();
+
+    /* frame sending derives from mpal_framed */
+
+    void PostFrame(int channel, vsnodeid dest, int kind, int tag, unsigned int seq, vsbyte* buf, int count);
+
+    /* class interface end */
+
+  private:
+
+    mpal_inproc** peers; // all nodes of the process, indexed by node id
+
+  }; //end class mpal_inproc declaration
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_MPAL_INPROC_H_
@@ -0,0 +1,151 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing Shared Memory Implementation
+ * class vlaser::mpal_shm
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#ifndef _VLASER_MPAL_SHM_H_
+#define _VLASER_MPAL_SHM_H_
+
+#include "vstype.h"
+#include "mpal_framed.h"
+#include "vsmutex.h"
+#include <sys/types.h>
+#include <pthread.h>
+#include <string>
+#include <stdexcept>
+
+namespace vlaser {
+
+  /*
+   * CLASS mpal_shm
+   *
+   * Class mpal_shm is POSIX shared memory implementation of
+   * abstract bass class mpal, for the nodes running on one host.
+   *
+   * 1) Every pair of nodes on this host shares a memory segment
+   * with two single producer single consumer ring buffers, one
+   * for each direction. Frames are copied into the ring directly.
+   * 2) Every node has a small segment with a futex doorbell, senders
+   * ring it after writing a frame, so an idle receive thread sleeps.
+   * 3) Messages to the nodes on other hosts go through the remote
+   * transport, its frames come to this node's inbox too.
+   * 4) Segments are unlinked as soon as all nodes have mapped them,
+   * nothing is left in /dev/shm after Initialize().
+   *
+   */
+
+  class mpal_shm : public mpal_framed {
+  public:
+
+    /* local_ids_path: file of the vlaser ids of the nodes on this host, this node included
+     * shm_name: name prefix of the shared memory segments, same on all nodes of the host
+     * remote: transport for the nodes on other hosts, NULL if all nodes are on this host,
+     * it is initialized and finalized by mpal_shm
+     */
+    mpal_shm(vsnodeid id, vsnodeid num, char local_ids_path[], char shm_name[], mpal_framed* remote = NULL);
+    virtual ~mpal_shm();
+
+    /* standard interface derives from mpal */
+
+    int Test(unsigned char flag);
+    int Initialize();
+    int Finalize();
+
+    /* frame sending derives from mpal_framed */
+
+    void PostFrame(int channel, vsnodeid dest, int kind, int tag, unsigned int seq, vsbyte* buf, int count);
+
+    /* class interface end */
+
+  private:
+
+    /* control block of one ring, head and tail on their own cache lines */
+    typedef struct {
+      volatile unsigned long long head; /* bytes ever written, moved by the sender only */
+      char pad0[56];
+      volatile unsigned long long tail; /* bytes ever read, moved by the receiver only */
+      char pad1[56];
+    } RingHead;
+
+    /* beginning of every segment */
+    typedef struct {
+      volatile int magic; /* set by the creator when the segment is ready */
+      pid_t creator;
+      volatile int attached; /* how many other nodes have mapped the segment */
+      volatile int doorbell; /* node segment only, futex word bumped by the senders */
+      volatile int sleeping; /* node segment only, receive thread waits on the doorbell */
+    } SegHead;
+
+    /* header written before every message */
+    typedef struct {
+      int channel;
+      int kind; /* mpal_inbox::FrameKind */
+      int tag;
+      int count; /* bytes of the message following this header */
+      unsigned int seq; /* sequence number of FRAME_TRY handshake */
+    } FrameHead;
+
+    /* receiving state of a ring */
+    typedef struct {
+      RingHead* ring;
+      unsigned char* data;
+      unsigned long long tail; /* private copy of ring->tail */
+      FrameHead head;
+      unsigned int head_got; /* header bytes received */
+      mpal_inbox::Frame* frame; /* the frame being received */
+      int body_got; /* message bytes received */
+    } RingReader;
+
+    mpal_framed* premote;
+    std::string local_ids_file_path; // path of the file of the nodes on this host
+    std::string shm_name_prefix;
+
+    char* is_local; // is_local[id] is set if node id is on this host
+    vsnodeid local_num;
+    void** pair_segs; // pair segments indexed by peer id, NULL for the nodes on other hosts
+    SegHead** node_segs; // doorbell segments indexed by node id, this node included
+    RingHead** tx_rings; // rings to the peers
+    unsigned char** tx_data;
+    vlamutex* tx_mutex; // one mutex for each ring to a peer
+    RingReader* readers; // rings from the peers
+
+    volatile int stop_flag;
+    pthread_t recv_thread_id;
+
+    /* read the ids of the nodes on this host */
+    void GetLocalIds();
+    /* create or map all segments, return when all local nodes have mapped them */
+    void MapSegments();
+
+    std::string SegmentName(vsnodeid a, vsnodeid b);
+    void* CreateSegment(const std::string& name, size_t size);
+    void* OpenSegment(const std::string& name, size_t size);
+
+    /* receive thread main code */
+    void ReceiveThread();
+    static void* _recv_routine(void* pclass);
+
+    /* take all available bytes of a ring, put complete frames to inbox.
+     * return 0 if the ring is empty
+     */
+    int ReadRing(RingReader& rd);
+
+    /* copy count bytes into the ring to dest, caller must hold tx_mutex[dest] */
+    void RingWrite(vsnodeid dest, const unsigned char* src, int count);
+
+    /* wake up the receive thread of node dest */
+    void Ring(vsnodeid dest);
+
+  }; //end class mpal_shm declaration
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_MPAL_SHM_H_
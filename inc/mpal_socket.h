@@ -8,6 +8,13 @@
  * Header File
  *
  * Mar 26, 2011  Original Design
+ * Oct 17, 2026  Keep one persistent framed connection per
+ *               peer and channel instead of connecting
+ *               for every message.
+ * Oct 17, 2026  Receive all connections with an epoll thread
+ *               into class mpal_inbox.
+ * Oct 17, 2026  Derive from class mpal_framed, which now keeps
+ *               the message and handshake protocol.
  *
  */
 
@@ -15,8 +22,10 @@
 #define _VLASER_MPAL_SOCKET_H_
 
 #include "vstype.h"
-#include "mpal.h"
+#include "mpal_framed.h"
+#include "vsmutex.h"
 #include <arpa/inet.h>
+#include <pthread.h>
 #include <string>
 #include <stdexcept>
 
@@ -26,10 +35,20 @@ namespace vlaser {
    * CLASS mpal_socket
    *
    * Class mpal_socket is Linux socket/TCP implementation of
-   * abstract bass class mpal.
+   * abstract bass class mpal, the messages are carried as frames
+   * of class mpal_framed.
+   *
+   * 1) Initialize() sets up one TCP connection to every node
+   * (this node included) for each of the request, acknowledgment
+   * and service channels, these connections are kept until Finalize().
+   * 2) Messages are framed with a small header, so messages from
+   * different requests share the same stream.
+   * 3) A receive thread watches all connections with epoll and
+   * puts every complete frame to the inbox, which queues them
+   * per channel and per source node.
    */
 
-  class mpal_socket : public mpal {
+  class mpal_socket : public mpal_framed {
   public:
     mpal_socket(vsnodeid id, vsnodeid num, char my_addr_path[], char hosts_addr_path[]);
     virtual ~mpal_socket();
@@ -39,14 +58,10 @@ namespace vlaser {
     int Test(unsigned char flag); 
     int Initialize();
     int Finalize();
-    
-    int ReqSend(vsnodeid dest, int tag, vsbyte* buf, int count);
-    int WaitReq(vsnodeid& source, int& tag, vsbyte* buf, int count); 
-    int AckSend(vsnodeid dest, int tag, vsbyte* buf, int count);
-    int WaitAck(vsnodeid source, int& tag, vsbyte* buf, int count);
-    int SerSend(vsnodeid dest, int tag, vsbyte* buf, int count);
-    int WaitSer(vsnodeid source, int& tag, vsbyte* buf, int count);
-    int TrySerReqSend(vsnodeid dest, int tag, vsbyte* buf, int count);
+
+    /* frame sending derives from mpal_framed */
+
+    void PostFrame(int channel, vsnodeid dest, int kind, int tag, unsigned int seq, vsbyte* buf, int count);
 
     /* class interface end */
     
@@ -54,7 +69,6 @@ namespace vlaser {
 
     typedef uint32_t my_inet_addr_t; // type of ipv4 address
     typedef in_port_t my_inet_port_t; // type of port number
-    volatile int is_initialized;
     volatile int is_busy;
 
     my_inet_addr_t my_inet_addr; // ip address of this node
@@ -79,9 +93,50 @@ namespace vlaser {
     /* create and listen three channel sockets */
     void PrepareSocks();
 
-    int SendProto(my_inet_port_t the_port, vsnodeid dest, int tag, vsbyte* buf, int count);
-
-    int RecvProto(int the_socket, vsnodeid& source, int& tag, vsbyte* buf, int count);
+    /* header sent before every message */
+    typedef struct {
+      int kind; /* mpal_inbox::FrameKind */
+      int tag;
+      int count; /* bytes of the message following this header */
+      unsigned int seq; /* sequence number of FRAME_TRY handshake */
+    } FrameHead;
+
+    /* receiving state of a connection */
+    typedef struct {
+      int sock;
+      int channel;
+      vsnodeid peer;
+      FrameHead head;
+      int head_got; /* header bytes received */
+      mpal_inbox::Frame* frame; /* the frame being received */
+      int body_got; /* message bytes received */
+    } Connection;
+
+    int* out_socks; // outgoing connections, indexed by channel * node_num + dest
+    int* in_socks; // incoming connections, indexed by channel * node_num + source
+    vlamutex* out_mutex; // one mutex for each outgoing connection
+    vlamutex* confirm_mutex; // one mutex for each incoming request connection, for sending confirmings
+
+    Connection* conns; // incoming connections of all channels, then outgoing request connections
+    int epoll_fd;
+    int wake_fd; // eventfd for stopping the receive thread
+    pthread_t recv_thread_id;
+
+    /* connect to every node on every channel and accept theirs */
+    void MakeMesh();
+    void AcceptMesh();
+    static void* _accept_routine(void* pclass);
+
+    /* receive thread main code */
+    void ReceiveThread();
+    static void* _recv_routine(void* pclass);
+
+    /* read all available bytes of a connection, put complete frames to inbox.
+     * return -1 if the peer has closed the connection
+     */
+    int ReadConnection(Connection& conn);
+
+    int SendFrame(int the_socket, int kind, int tag, unsigned int seq, vsbyte* buf, int count);
 
   }; //end class mpal_socket declaration
 
@@ -0,0 +1,124 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Memory Arenas
+ * class vlaser::vsarena
+ * class vlaser::vsbufpool
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  Alignment of the vsbufpool buffers.
+ *
+ */
+
+#ifndef _VLASER_VSARENA_H_
+#define _VLASER_VSARENA_H_
+
+#include "vstype.h"
+#include "vsmutex.h"
+#include <stddef.h>
+#include <vector>
+#include <stdexcept>
+
+namespace vlaser {
+
+  /* CLASS vsarena
+   *
+   * A large block of memory mapped for the cache data
+   * or the message buffers.
+   *
+   * 1) With ARENA_HUGE_PAGES, an arena of at least one huge
+   * page tries the explicit huge pages first, then the
+   * transparent huge pages, then the normal pages.
+   * 2) With ARENA_NUMA_LOCAL, the pages are preferred on the
+   * NUMA node of the constructing thread.
+   * 3) The memory is zero filled.
+   *
+   */
+
+  class vsarena {
+  public:
+
+    class arena_runtime_error : public std::runtime_error {
+    public:
+      arena_runtime_error(const char* msg = "") : runtime_error(msg) {}
+    };
+
+    enum {
+      ARENA_HUGE_PAGES = 1,
+      ARENA_NUMA_LOCAL = 2
+    };
+
+    /* what the arena got */
+    enum Backing {
+      BACKING_PAGES, /* normal pages */
+      BACKING_TRANSPARENT_HUGE, /* normal pages advised as transparent huge pages */
+      BACKING_HUGE /* explicit huge pages, MAP_HUGETLB */
+    };
+
+    vsarena(size_t size, int flags = ARENA_HUGE_PAGES | ARENA_NUMA_LOCAL);
+
+    virtual ~vsarena();
+
+    /* class interface */
+
+    vsbyte* Base() { return base; }
+    size_t Size() { return size; }
+    Backing GetBacking() { return backing; }
+    const char* BackingName();
+    int NumaNode() { return numa_node; } /* -1 if not bound */
+    int Contains(const void* p) { return (vsbyte*)p >= base && (vsbyte*)p < base + size; }
+
+    /* class interface end */
+
+  protected:
+
+    vsbyte* base;
+    size_t size; /* bytes asked */
+    void* map_addr; /* what to unmap */
+    size_t map_size;
+    Backing backing;
+    int numa_node;
+
+    void BindLocal();
+
+  }; //end class vsarena declaration
+
+  /* CLASS vsbufpool
+   *
+   * Buffers of one size carved from a vsarena, Get() and Put()
+   * are thread safe. When all of them are in use, Get() takes
+   * a buffer from the heap, and Put() frees it there. The
+   * buffers start on cache lines, or on align if it is larger.
+   *
+   */
+
+  class vsbufpool {
+  public:
+
+    vsbufpool(size_t bsize, int n, int flags = vsarena::ARENA_HUGE_PAGES | vsarena::ARENA_NUMA_LOCAL,
+      size_t align = 0);
+
+    virtual ~vsbufpool();
+
+    const size_t buf_size;
+    const size_t buf_align;
+
+    vsbyte* Get();
+    void Put(vsbyte* buf);
+
+    vsarena* Arena() { return arena; }
+
+  protected:
+
+    vsarena* arena;
+    std::vector<vsbyte*> free_bufs;
+    vlamutex pool_mutex;
+
+  }; //end class vsbufpool declaration
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_VSARENA_H_
@@ -11,17 +11,28 @@
  * May 11, 2011  Add a list to record all invalid
  *               blocks in cache to speed up the
  *               replacement procedure.
+ * Oct 17, 2026  Open addressing index, and the LRU and invalid
+ *               lists linked by block indices inside the blocks.
+ * Oct 17, 2026  Pluggable replacement policies, hit and miss counters.
+ * Oct 17, 2026  TryRead(), reading a hit block without the lock.
+ * Oct 17, 2026  Keep a list of the MODIFIED blocks.
+ * Oct 17, 2026  FindColdModified(), BeginClean() and EndClean() for
+ *               writing back dirty blocks ahead of their eviction.
+ * Oct 17, 2026  Block data in a vsarena.
+ * Oct 17, 2026  Keep the version of a block given by its home.
+ * Oct 17, 2026  Dirty sectors of the MODIFIED blocks.
+ * Oct 17, 2026  Dirty byte ranges of the MODIFIED blocks.
+ * Oct 17, 2026  Referenced flags, no TryRead() hit is lost.
+ * Oct 17, 2026  Valid sector masks.
  *
  */
 
 #ifndef _VLASER_VSCACHE_H_
 #define _VLASER_VSCACHE_H_
 
-#define VLASER_VSCACHE_HASH_MAP_NAMESPACE __gnu_cxx
-
 #include "vstype.h"
-#include <hash_map>
-#include <list>
+#include "vsreplacer.h"
+#include "vsarena.h"
 #include <vector>
 #include <stdexcept>
 
@@ -29,10 +40,18 @@ namespace vlaser {
 
   /* CLASS vscache
    *
-   * LRU algorithm for cache block replacement.
-   * The hash map is used for address mapping.
-   * And the link list is for implementing the 
-   * acurrate LRU.
+   * An open addressing hash table with linear probing
+   * is used for address mapping. The invalid block list
+   * is linked by the block indices stored in the blocks,
+   * so a cache hit needs no memory allocation.
+   * Invalid blocks are always replaced first, otherwise
+   * the replacement policy (see vsreplacer.h) chooses one
+   * of the valid and not pinned blocks.
+   * Except TryRead(), the methods are not thread safe, the
+   * caller locks the cache. Each block has a sequence number
+   * which is odd while its address or status is being
+   * changed, so TryRead() can copy a block without the lock
+   * and then check that the block has not changed.
    *
    */
    
@@ -61,7 +80,8 @@ namespace vlaser {
       cache_logic_error(const char* msg = "") : logic_error(msg) {}
     };
 
-    vscache(BlockSize bsize, vsaddr n); /* indicate the block size and the number of total blocks */
+    /* indicate the block size, the number of total blocks and the replacement policy */
+    vscache(BlockSize bsize, vsaddr n, ReplacementPolicy policy = REPLACE_LRU);
     
     virtual ~vscache();
 
@@ -69,22 +89,35 @@ namespace vlaser {
 
     const vsaddr cache_size; /* number of blocks */
     const BlockSize cache_block_size;
+
+    /* counters of the accesses from the user */
+    typedef struct {
+      unsigned long long hits;
+      unsigned long long misses;
+      unsigned long long evictions; /* valid blocks chosen to be replaced */
+      unsigned long long dirty_evictions; /* the MODIFIED ones of them */
+    } Statistics;
   
     BlockStatus GetBlockStatus(vsaddr addr);
 
     void SetBlockStatus(vsaddr addr, BlockStatus status); 
     
+    /* return the block's data, or NULL if it is not valid in cache.
+     * set rec_flag to 1 for an access from the user, which is counted
+     * as a hit or a miss and told to the replacement policy
+     */
     vsbyte* AccessBlock(vsaddr addr, int rec_flag); 
 
     void LockBlock(vsaddr addr);
 
     void ReleaseBlock(vsaddr addr); 
     
-    /* tells which block will be replaced according to LRU
-     * algorithms and return 1, if there is invalid block
-     * ready for replacement, the method will return 0.
+    /* tells which block will be replaced for the block of
+     * address newaddr according to the replacement policy
+     * and return 1, if there is invalid block ready for
+     * replacement, the method will return 0.
      */
-    int FindReplacingBlock(vsaddr& addr, int& if_writeback);
+    int FindReplacingBlock(vsaddr newaddr, vsaddr& addr, int& if_writeback);
 
     /* if swapblock is set to 1, the method will
      * occupy a new block in the cache by kicking out the block
@@ -96,53 +129,191 @@ namespace vlaser {
 
     void SetIntegrity(vsaddr addr);
     
+    /* a block missing some of its sectors is not integral */
     int IsIntegrity(vsaddr addr);
 
+    /* the version of the block's data given by its home, a new
+     * block has NO_VERSION
+     */
+    enum { NO_VERSION = 0xffffffffu };
+
+    void SetBlockVersion(vsaddr addr, vsaddr version);
+
+    vsaddr GetBlockVersion(vsaddr addr);
+
+    /* a block is divided into DIRTY_SECTORS sectors, and the written
+     * ones are marked in a mask, bit i for sector i. the mask is
+     * cleared when the block becomes MODIFIED, and kept after it
+     * leaves MODIFIED until it becomes MODIFIED again, so it can be
+     * read after CleanBlock() or BeginClean()
+     */
+    enum { DIRTY_SECTORS = 64 };
+
+    void MarkDirty(vsaddr addr, int startpoint, int count);
+
+    unsigned long long GetDirtyMask(vsaddr addr);
+
+    /* the written bytes are also kept as at most DIRTY_RANGES ranges,
+     * touching ranges are merged. write the ranges of the block to
+     * start and len and return how many they are, or return 0 if the
+     * block has been written in more places, then only the mask tells
+     */
+    enum { DIRTY_RANGES = 4 };
+
+    int GetDirtyRanges(vsaddr addr, blockoffset* start, blockoffset* len);
+
+    /* the sectors holding the block's data, in a mask as the dirty
+     * one. a block pushed has all of them, only the sectored coherence
+     * of cpl leaves some out. TryRead() misses a range whose sectors
+     * are not all valid
+     */
+    unsigned long long GetValidSectors(vsaddr addr);
+
+    void SetValidSectors(vsaddr addr, unsigned long long mask);
+
+    int HasSectors(vsaddr addr, int startpoint, int count);
+
+    /* the mask of the sectors count bytes from startpoint touch,
+     * and of the ones they cover whole
+     */
+    unsigned long long SectorsOf(int startpoint, int count);
+
+    unsigned long long WholeSectorsOf(int startpoint, int count);
+
     int IsCached(vsaddr addr, BlockStatus& status); /* a fast and non-exception version of finding block */
     
     vsaddr GetPinningNum();
 
+    /* return the MODIFIED blocks one by one in ascending address order,
+     * and set them as INVALID. the blocks are the ones MODIFIED at the
+     * first calling, return 0 when all of them are returned
+     */
     int CleanCache(vsaddr& addr, vsbyte** buf);
 
+    vsaddr GetModifiedNum() { return modified_num; }
+
+    /* write the addresses of all MODIFIED blocks to list in ascending order */
+    void GetModifiedBlocks(std::vector<vsaddr>& list);
+
+    /* set the block addr as INVALID if it is MODIFIED and return its data,
+     * or return NULL
+     */
+    vsbyte* CleanBlock(vsaddr addr);
+
+    /* write to list at most max addresses of the MODIFIED and not pinned
+     * blocks among the scan coldest blocks of the replacement order,
+     * the coldest first
+     */
+    void FindColdModified(vsaddr max, vsaddr scan, std::vector<vsaddr>& list);
+
+    /* start writing back the MODIFIED block addr while it stays in cache.
+     * the block is pinned and its data is returned, or NULL is returned
+     * if it is not MODIFIED or is pinned.
+     * EndClean() sets it as EXCLUSIVE if written is 1 and its status has
+     * not been set since BeginClean(), and releases it. return 1 if the
+     * block is set as EXCLUSIVE
+     */
+    vsbyte* BeginClean(vsaddr addr);
+    int EndClean(vsaddr addr, int written);
+
+    /* copy count bytes from startpoint of the valid block addr
+     * to buf without the lock, counted as an access from the user.
+     * return 0 if the block is not cached or is being changed,
+     * the caller then tries again with the lock.
+     * the block's data must not be written at the same time
+     */
+    int TryRead(vsaddr addr, int startpoint, int count, vsbyte* buf);
+
+    void GetStatistics(Statistics& st) { st = stats; }
+
+    void ClearStatistics();
+
+    const char* PolicyName() { return replacer->Name(); }
+
+    /* the memory holding the blocks' data */
+    vsarena* DataArena() { return arena; }
+
     /* class interface end */
 
   protected:
 
-    /* type of LRU list */
-    typedef std::list<vsaddr> TypeOfLRUList;
-    typedef std::list<vsaddr> TypeOfInvalidList;
-    
+    enum { NIL = -1 }; /* end of a list, or an empty index slot */
+
     /* cache block's structure */
     typedef struct {
+      vsaddr addr; /* the block's address, key of the index */
       BlockStatus status; /* MESI */
-      vsbyte* data; /* pointer for cache block data */
       unsigned int pinning_flag;
-      TypeOfLRUList::iterator list_pos; /* indicating the block's position in LRU list */
       unsigned int integrity_flag;
-      TypeOfInvalidList::iterator invalid_pos; //indicating the block's position in invalid list
+      unsigned int cleaning_flag; /* being written back, cleared when the status is set */
+      vsaddr version; /* the version from the home, NO_VERSION if unknown */
+      unsigned long long dirty_mask; /* sectors written since the block became MODIFIED */
+      unsigned long long valid_mask; /* sectors holding data, changed as addr and status */
+      int range_num; /* number of dirty ranges, -1 if there are too many */
+      blockoffset range_start[DIRTY_RANGES], range_end[DIRTY_RANGES]; /* [start, end) */
+      volatile unsigned int seq; /* odd while addr or status is being changed */
+      volatile int referenced; /* hit by TryRead() and not yet told to the policy */
+      int invalid_prev, invalid_next; /* neighbours in invalid list */
+      int modified_prev, modified_next; /* neighbours in modified list */
+      vsbyte* data; /* pointer for cache block data */
     } CacheBlock;
-    
-    /* address mapping hash */
-    typedef VLASER_VSCACHE_HASH_MAP_NAMESPACE::hash_map<vsaddr, CacheBlock*, VLASER_VSCACHE_HASH_MAP_NAMESPACE::hash<vsaddr> > TypeOfCacheMap;
 
+    /* slot of the address index */
+    typedef struct {
+      vsaddr addr;
+      int block; /* index of the block in cache_blocks, NIL if empty */
+    } IndexSlot;
+
+    IndexSlot* index_slots; /* the address index, at least twice as many slots as blocks */
+    vsaddr index_mask; /* slots number - 1, slots number is a power of 2 */
+    int index_shift; /* 32 - log2(slots number) */
+    vsreplacer* replacer;
+    Statistics stats;
 
-    TypeOfLRUList cache_list; /* the cache blocks' LRU list */
-    TypeOfCacheMap cache_map; /* the address hash map contains each pointer of block */
-    vsbyte* cacheX; /* holding all cache block data space */
+    /* the blocks hit by TryRead(), they are told to the policy
+     * later with the lock. TryRead() sets a block's referenced flag,
+     * and puts the block to the ring when the flag was clear, so a
+     * block is in the ring at most once, and the ring, as large as
+     * the blocks, is never overrun. DrainTouches() clears the flags
+     */
+    volatile int* touch_ring; /* NIL in a slot not yet filled */
+    vsaddr touch_mask; /* ring size - 1, ring size is a power of 2 */
+    volatile unsigned int touch_head;
+    unsigned int touch_tail;
+
+    void DrainTouches();
+
+    void BeginChange(CacheBlock* tmp) { ++tmp->seq; __sync_synchronize(); }
+    void EndChange(CacheBlock* tmp) { __sync_synchronize(); ++tmp->seq; }
+    int invalid_head; /* the invalid blocks, the newest first */
+    int modified_head; /* the MODIFIED blocks, in no order */
+    vsaddr modified_num;
+    vsarena* arena;
+    vsbyte* cacheX; /* holding all cache block data space, in arena */
     CacheBlock* cache_blocks;
     vsaddr pinning_block_num;
-    std::vector<vsaddr> modified_blocks; /* record the blocks which are tagged as MODIFIED */
-    TypeOfInvalidList invalid_blocks; // record all the invalid blocks;
+    std::vector<vsaddr> modified_blocks; /* the blocks CleanCache() has to return, the largest address first */
     int is_create_modified_list;
 
+    /* index of the block with address addr, NIL when cache miss */
+    int LookUp(vsaddr addr);
     CacheBlock* FindBlock(vsaddr addr); /* find a block with address addr, throw exception when cache miss */
 
-    void FindAllModified(); /* find all MODIFIED blocks, and write them to ModifiedBlocks list */
+    void IndexInsert(vsaddr addr, int block);
+    void IndexErase(vsaddr addr);
+
+    void InvalidUnlink(int block);
+    void InvalidPushFront(int block);
+
+    /* keep the modified list when a block's status changes from oldst to newst */
+    void TraceModified(int block, BlockStatus oldst, BlockStatus newst);
+
+    void FindAllModified(); /* write all MODIFIED blocks to modified_blocks */
 
     /* use the new block replace the old block
      * and return the new block's data pointer
      */
-    vsbyte* SwapBlock(TypeOfCacheMap::iterator oldmap_iter, vsaddr newaddr, BlockStatus newstatus);
+    vsbyte* SwapBlock(int block, vsaddr newaddr, BlockStatus newstatus);
     
 	};//end class vscache declaration
 }//end namespace vlaser
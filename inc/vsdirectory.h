@@ -0,0 +1,112 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Storage Directory Component
+ * class vlaser::vsdirectory
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#ifndef _VLASER_VSDIRECTORY_H_
+#define _VLASER_VSDIRECTORY_H_
+
+#define VSDIRECTORY_BITS_NODE_MAX 128 //largest cluster using the bit-vector format
+#define VSDIRECTORY_POINTER_NUM 4 //node ids an entry holds before it turns coarse
+
+#include "vstype.h"
+#include <stdexcept>
+
+namespace vlaser {
+
+  /* CLASS vsdirectory
+   *
+   * The status and the cache-copy holders of every
+   * local storage block, each entry is 24 bytes inline.
+   *
+   * 1) Up to VSDIRECTORY_BITS_NODE_MAX nodes, the holders are
+   * a bit-vector with one bit for each node.
+   * 2) For larger clusters, an entry records up to
+   * VSDIRECTORY_POINTER_NUM node ids. When more nodes hold the
+   * block, the entry turns to a coarse vector, one bit for a
+   * group of nodes. A coarse entry is a superset of the holders,
+   * Erase() keeps the group's bit, and Clear() makes it exact again.
+   * 3) The holders are always listed in ascending order.
+   * 4) vsdirectory does no locking, the caller locks the entries.
+   *
+   */
+
+  class vsdirectory {
+  public:
+
+    class directory_logic_error : public std::logic_error {
+    public:
+      directory_logic_error(const char* msg = "") : logic_error(msg) {}
+    };
+
+    vsdirectory(vsaddr n, vsnodeid nm); /* number of entries and number of nodes */
+
+    virtual ~vsdirectory();
+
+    /* class interface */
+
+    const vsaddr entry_num;
+    const vsnodeid node_num;
+
+    int GetStatus(vsaddr laddr) { return entries[laddr].status; }
+    void SetStatus(vsaddr laddr, int st) { entries[laddr].status = st; }
+
+    void Insert(vsaddr laddr, vsnodeid id);
+    void Erase(vsaddr laddr, vsnodeid id);
+    void Clear(vsaddr laddr);
+    int Has(vsaddr laddr, vsnodeid id);
+
+    /* number of holders, counts every node of a coarse group */
+    int Count(vsaddr laddr);
+
+    /* write the holders to list in ascending order, list has node_num
+     * rooms, return the number of holders written
+     */
+    int List(vsaddr laddr, vsnodeid* list);
+
+    /* bytes used by the entries */
+    unsigned long long Footprint() { return (unsigned long long)entry_num * sizeof(Entry); }
+
+    /* name of the holders format */
+    const char* FormatName();
+
+    /* class interface end */
+
+  private:
+
+    enum EntryKind {
+      ENTRY_BITS,     /* one bit for each node */
+      ENTRY_POINTERS, /* up to VSDIRECTORY_POINTER_NUM node ids */
+      ENTRY_COARSE    /* one bit for each group of nodes */
+    };
+
+    typedef struct {
+      unsigned char status;
+      unsigned char kind; /* EntryKind */
+      unsigned char num;  /* node ids in ptrs */
+      union {
+        unsigned long long bits[VSDIRECTORY_BITS_NODE_MAX / 64];
+        vsnodeid ptrs[VSDIRECTORY_POINTER_NUM]; /* ascending */
+      };
+    } Entry;
+
+    Entry* entries;
+    vsnodeid group_size; /* nodes for each bit of a coarse entry */
+
+    int TestBit(const Entry& e, vsnodeid i) { return (e.bits[i >> 6] >> (i & 63)) & 1; }
+    void SetBit(Entry& e, vsnodeid i) { e.bits[i >> 6] |= 1ULL << (i & 63); }
+    void ClearBits(Entry& e);
+
+  }; //end class vsdirectory declaration
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_VSDIRECTORY_H_
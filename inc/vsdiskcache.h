@@ -0,0 +1,98 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Disk Cache Component
+ * class vlaser::vsdiskcache
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#ifndef _VLASER_VSDISKCACHE_H_
+#define _VLASER_VSDISKCACHE_H_
+
+#include "vstype.h"
+#include <stdexcept>
+
+namespace vlaser {
+
+  /* CLASS vsdiskcache
+   *
+   * The second level cache in a local disk file, holding
+   * clean remote blocks replaced from vscache. Each block
+   * keeps the version its home gave, the caller asks the
+   * home whether the version is still current before using
+   * the data.
+   *
+   * 1) The slots are replaced in FIFO order, an open
+   * addressing index maps the addresses to the slots.
+   * 2) The file is removed when it is opened, so it goes
+   * away with the process.
+   * 3) vsdiskcache does no locking, the caller locks it.
+   *
+   */
+
+  class vsdiskcache {
+  public:
+
+    class diskcache_runtime_error : public std::runtime_error {
+    public:
+      diskcache_runtime_error(const char* msg = "") : runtime_error(msg) {}
+    };
+    class diskcache_logic_error : public std::logic_error {
+    public:
+      diskcache_logic_error(const char* msg = "") : logic_error(msg) {}
+    };
+
+    /* the block size, number of blocks, and the file path */
+    vsdiskcache(BlockSize bsize, vsaddr n, const char* path);
+
+    virtual ~vsdiskcache();
+
+    /* class interface */
+
+    const BlockSize block_size;
+    const vsaddr slot_num;
+
+    /* return 1 and the version if the block addr is held */
+    int Find(vsaddr addr, vsaddr& version);
+
+    /* read the held block addr to buf */
+    void Read(vsaddr addr, vsbyte* buf);
+
+    /* keep the block addr of the given version, replacing the oldest one */
+    void Put(vsaddr addr, vsaddr version, vsbyte* buf);
+
+    void Erase(vsaddr addr);
+
+    /* class interface end */
+
+  protected:
+
+    enum { NIL = -1 };
+
+    typedef struct {
+      vsaddr addr;
+      vsaddr version;
+      int used;
+    } Slot;
+
+    Slot* slots;
+    vsaddr hand; /* the slot to be replaced next */
+    int* index_slots; /* slot numbers, NIL if empty */
+    vsaddr index_mask;
+    int index_shift;
+    int fd;
+
+    vsaddr Home(vsaddr addr) { return (vsaddr)(addr * 2654435769u) >> index_shift; }
+    int LookUp(vsaddr addr);
+    void IndexErase(vsaddr addr);
+
+  }; //end class vsdiskcache declaration
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_VSDISKCACHE_H_
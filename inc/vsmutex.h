@@ -14,6 +14,8 @@
 #define _VSMUTEX_H_
 
 #include <pthread.h>
+#include <time.h>
+#include <errno.h>
 #include <stdexcept>
 
 namespace vlaser {
@@ -49,6 +51,43 @@ namespace vlaser {
     }
   private:
     pthread_mutex_t mylock;
+
+    friend class vlacond;
+  };
+
+  class vlacond {
+  public:
+    vlacond(vlamutex& m) : mymutex(m) {
+      if(pthread_cond_init(&mycond, NULL) != 0)
+        throw vlamutex::mutex_runtime_error("condition error: from class vlacond");
+    }
+    ~vlacond() {
+      pthread_cond_destroy(&mycond);
+    }
+
+    /* wait with the mutex being locked */
+    void wait() {
+      if(pthread_cond_wait(&mycond, &mymutex.mylock) != 0)
+        throw vlamutex::mutex_runtime_error("condition error: from class vlacond");
+    }
+    /* return 0 when the absolute time abstime passes */
+    int timedwait(const struct timespec* abstime) {
+      int i = pthread_cond_timedwait(&mycond, &mymutex.mylock, abstime);
+      if(i == ETIMEDOUT)
+        return 0;
+      if(i != 0)
+        throw vlamutex::mutex_runtime_error("condition error: from class vlacond");
+      return 1;
+    }
+    void signal() {
+      pthread_cond_signal(&mycond);
+    }
+    void broadcast() {
+      pthread_cond_broadcast(&mycond);
+    }
+  private:
+    vlamutex& mymutex;
+    pthread_cond_t mycond;
   };
 } //end namespace vlaser
 
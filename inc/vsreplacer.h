@@ -0,0 +1,321 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Cache Block Replacement Policies
+ * abstract class vlaser::vsreplacer
+ * class vlaser::vsreplacer_lru
+ * class vlaser::vsreplacer_clock
+ * class vlaser::vsreplacer_2q
+ * class vlaser::vsreplacer_arc
+ * Header File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  Coldest() and Warmer(), walking the blocks in
+ *               replacement order.
+ *
+ */
+
+#ifndef _VLASER_VSREPLACER_H_
+#define _VLASER_VSREPLACER_H_
+
+#include "vstype.h"
+#include <stdexcept>
+
+namespace vlaser {
+
+  /*
+   * CLASS vsreplacer
+   *
+   * Class vsreplacer defines how vscache chooses the
+   * block to be replaced.
+   *
+   * 1) Blocks are named by their indices in the cache,
+   * 0 to block_num - 1.
+   * 2) A policy only holds the blocks which can be replaced,
+   * the valid and not pinned ones. The cache tells it when a
+   * block comes in with Insert(), when it is hit with Touch(),
+   * and when it goes out with Remove().
+   * 3) Victim() only chooses a block, the block leaves the
+   * policy with the following Remove().
+   * 4) vsreplacer does no locking, the cache's lock covers it.
+   *
+   */
+
+  class vsreplacer {
+  public:
+
+    class replacer_logic_error : public std::logic_error {
+    public:
+      replacer_logic_error(const char* msg = "") : logic_error(msg) {}
+    };
+
+    vsreplacer(vsaddr n); /* number of cache blocks */
+
+    virtual ~vsreplacer();
+
+    /* create the policy p for n blocks */
+    static vsreplacer* Create(ReplacementPolicy p, vsaddr n);
+
+    /* class interface */
+
+    const vsaddr block_num;
+
+    /* block is filled with the block of address addr */
+    virtual void Insert(int block, vsaddr addr) = 0;
+
+    /* block is accessed by the user */
+    virtual void Touch(int block) = 0;
+
+    /* block holding address addr can not be replaced any more.
+     * evicted is 1 if it is replaced as the victim, 0 if it is
+     * set invalid or pinned
+     */
+    virtual void Remove(int block, vsaddr addr, int evicted) = 0;
+
+    /* the block to be replaced for the block of address newaddr,
+     * NIL if no block can be replaced
+     */
+    virtual int Victim(vsaddr newaddr) = 0;
+
+    /* walk the blocks in about the order they will be replaced,
+     * Coldest() is the first and Warmer() gives the next one,
+     * NIL at the end. the walk does not change the policy
+     */
+    virtual int Coldest() = 0;
+    virtual int Warmer(int block) = 0;
+
+    virtual const char* Name() = 0;
+
+    /* class interface end */
+
+    enum { NIL = -1 };
+
+  protected:
+
+    /* a list of blocks linked by block_prev and block_next,
+     * a block is in one list at most
+     */
+    typedef struct {
+      int head, tail;
+      vsaddr size;
+    } BlockList;
+
+    int* block_prev;
+    int* block_next;
+    unsigned char* block_list; /* which list the block is in, policy defined */
+
+    void ListInit(BlockList& l);
+    void ListPushBack(BlockList& l, int block);
+    void ListUnlink(BlockList& l, int block);
+
+  }; //end class vsreplacer declaration
+
+  /*
+   * CLASS vsghost
+   *
+   * The addresses of recently replaced blocks, kept in
+   * several FIFO lists which share one address index.
+   * An address is in one list at most.
+   *
+   */
+
+  class vsghost {
+  public:
+
+    vsghost(vsaddr cap, int listnum); /* most addresses held, and number of lists */
+
+    virtual ~vsghost();
+
+    const vsaddr capacity;
+    const int list_num;
+
+    /* the list holding addr, or -1 */
+    int Find(vsaddr addr);
+
+    /* append addr to list l, drop the oldest address when full */
+    void PushBack(int l, vsaddr addr);
+
+    void Erase(vsaddr addr);
+
+    /* drop the oldest address of list l */
+    void PopFront(int l);
+
+    vsaddr Size(int l) { return lists[l].size; }
+
+  private:
+
+    enum { NIL = -1 };
+
+    typedef struct {
+      vsaddr addr;
+      int list;
+      int prev, next;
+    } Entry;
+
+    typedef struct {
+      int head, tail;
+      vsaddr size;
+    } List;
+
+    Entry* entries;
+    int free_head; /* unused entries, linked by next */
+    List* lists;
+    int* index_slots; /* entry indices, NIL if empty */
+    vsaddr index_mask;
+    int index_shift;
+
+    vsaddr Home(vsaddr addr) { return (vsaddr)(addr * 2654435769u) >> index_shift; }
+    int LookUp(vsaddr addr);
+    void EraseEntry(int e);
+
+  }; //end class vsghost declaration
+
+  /*
+   * CLASS vsreplacer_lru
+   *
+   * Accurate least recently used.
+   *
+   */
+
+  class vsreplacer_lru : public vsreplacer {
+  public:
+
+    vsreplacer_lru(vsaddr n);
+
+    virtual ~vsreplacer_lru() {}
+
+    virtual void Insert(int block, vsaddr addr);
+    virtual void Touch(int block);
+    virtual void Remove(int block, vsaddr addr, int evicted);
+    virtual int Victim(vsaddr newaddr);
+    virtual int Coldest();
+    virtual int Warmer(int block);
+    virtual const char* Name() { return "LRU"; }
+
+  protected:
+
+    BlockList lru; /* the least recently used first */
+
+  }; //end class vsreplacer_lru declaration
+
+  /*
+   * CLASS vsreplacer_clock
+   *
+   * Second chance. The blocks are in a ring, a hit only
+   * sets the block's reference bit, and the hand clears
+   * the bits until it meets a block without one.
+   *
+   */
+
+  class vsreplacer_clock : public vsreplacer {
+  public:
+
+    vsreplacer_clock(vsaddr n);
+
+    virtual ~vsreplacer_clock();
+
+    virtual void Insert(int block, vsaddr addr);
+    virtual void Touch(int block);
+    virtual void Remove(int block, vsaddr addr, int evicted);
+    virtual int Victim(vsaddr newaddr);
+    virtual int Coldest();
+    virtual int Warmer(int block);
+    virtual const char* Name() { return "CLOCK"; }
+
+  protected:
+
+    BlockList ring; /* the ring is closed at tail and head */
+    int hand;
+    unsigned char* referenced;
+
+  }; //end class vsreplacer_clock declaration
+
+  /*
+   * CLASS vsreplacer_2q
+   *
+   * Full 2Q of Johnson and Shasha. A new block goes to the
+   * FIFO A1in, and only a block requested again after it has
+   * left A1in, found in the ghost list A1out, goes to the LRU
+   * list Am. So a scan passes through A1in without flushing Am.
+   *
+   */
+
+  class vsreplacer_2q : public vsreplacer {
+  public:
+
+    vsreplacer_2q(vsaddr n);
+
+    virtual ~vsreplacer_2q();
+
+    virtual void Insert(int block, vsaddr addr);
+    virtual void Touch(int block);
+    virtual void Remove(int block, vsaddr addr, int evicted);
+    virtual int Victim(vsaddr newaddr);
+    virtual int Coldest();
+    virtual int Warmer(int block);
+    virtual const char* Name() { return "2Q"; }
+
+  protected:
+
+    enum { IN_NONE, IN_A1IN, IN_AM };
+
+    BlockList a1in, am;
+    vsghost* a1out;
+    const vsaddr kin; /* A1in's target size, a quarter of the blocks */
+
+    /* the list Victim() takes from first */
+    BlockList& ColdList() { return (a1in.size > kin || am.head == NIL) ? a1in : am; }
+
+  }; //end class vsreplacer_2q declaration
+
+  /*
+   * CLASS vsreplacer_arc
+   *
+   * Adaptive replacement cache of Megiddo and Modha.
+   * T1 holds the blocks used once and T2 the blocks used
+   * more than once, their ghost lists B1 and B2 move the
+   * target size of T1 towards the list which misses more.
+   *
+   */
+
+  class vsreplacer_arc : public vsreplacer {
+  public:
+
+    vsreplacer_arc(vsaddr n);
+
+    virtual ~vsreplacer_arc();
+
+    virtual void Insert(int block, vsaddr addr);
+    virtual void Touch(int block);
+    virtual void Remove(int block, vsaddr addr, int evicted);
+    virtual int Victim(vsaddr newaddr);
+    virtual int Coldest();
+    virtual int Warmer(int block);
+    virtual const char* Name() { return "ARC"; }
+
+  protected:
+
+    enum { IN_NONE, IN_T1, IN_T2 };
+    enum { B1, B2 };
+
+    BlockList t1, t2;
+    vsghost* ghost; /* B1 and B2 */
+    vsaddr target; /* target size of T1 */
+
+    /* the ghost hit of newaddr has been adapted by Victim() */
+    int adapted;
+    vsaddr adapted_addr;
+
+    /* move target on a ghost hit in list l */
+    void Adapt(int l);
+
+    /* the list Victim() takes from first, without a ghost hit */
+    BlockList& ColdList() { return (t1.head != NIL && (t1.size > target || t2.head == NIL)) ? t1 : t2; }
+
+  }; //end class vsreplacer_arc declaration
+
+} //end namespace vlaser
+
+#endif //#ifndef _VLASER_VSREPLACER_H_
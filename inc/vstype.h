@@ -6,6 +6,7 @@
  * Global Type Header File
  *
  * Feb 11, 2011  Original Design
+ * Oct 17, 2026  Add enum ReplacementPolicy
  *
  */
 
@@ -46,6 +47,10 @@ namespace vlaser {
   enum MESICoherence {
     MODIFIED, EXCLUSIVE, SHARED, INVALID
   };//MESI coherency Protocol
+
+  enum ReplacementPolicy {
+    REPLACE_LRU, REPLACE_CLOCK, REPLACE_2Q, REPLACE_ARC
+  };//cache block replacement policies, see vsreplacer.h
 }
 
 #endif //#ifndef _VSTYPE_H_
@@ -8,20 +8,72 @@
  * Source File
  *
  * Feb 19, 2011  Original Design
+ * Oct 17, 2026  Update the directory in the calling thread for
+ *               local blocks instead of sending self requests.
+ * Oct 17, 2026  Invalidate all sharers of a block at once.
+ * Oct 17, 2026  Answer the requests with a pool of service workers,
+ *               requests on one directory entry are still serialized.
+ * Oct 17, 2026  Requests on a busy directory entry wait in a queue,
+ *               no more TAG_ACK_RETRY and backoff.
+ * Oct 17, 2026  Keep the local directory in a compact vsdirectory.
+ * Oct 17, 2026  Choose the cache replacement policy at construction,
+ *               only the first lookup of a read or write is counted
+ *               as an access of the replacement policy.
+ * Oct 17, 2026  Split the local cache into shards with their own locks.
+ * Oct 17, 2026  Read a cache hit without locking the shard.
+ * Oct 17, 2026  Clean the cache at shutdown in address order, only
+ *               visiting the MODIFIED blocks.
+ * Oct 17, 2026  Write back the cold dirty blocks ahead of time in a
+ *               cleaner thread.
+ * Oct 17, 2026  A miss does not wait the write back of its dirty victim,
+ *               the victim buffer holds the block until it is done.
+ * Oct 17, 2026  Message buffers from a vsbufpool.
+ * Oct 17, 2026  Block versions, and a local disk cache of the replaced
+ *               clean remote blocks.
+ * Oct 17, 2026  Write back the dirty sectors of a block instead of the
+ *               whole block.
+ * Oct 17, 2026  Write back the dirty byte ranges when they are fewer
+ *               bytes than the dirty sectors.
+ * Oct 17, 2026  Read the local storage without storage_mutex if the
+ *               lsal allows it.
+ * Oct 17, 2026  Read the block of an exclusive request while the holders
+ *               are invalidated, and queue the local writes of the
+ *               shutdown sequence, by the lsal_queue of the thread.
+ * Oct 17, 2026  Message buffers aligned as the local storage asks.
+ * Oct 17, 2026  Ack a block of a mapped local storage from the mapping.
+ * Oct 17, 2026  Drop the self request handlers, no node sends them.
+ * Oct 17, 2026  Queue the requests of a busy entry on the entry, any
+ *               idle worker answers the next runnable one.
+ * Oct 17, 2026  Sync() flushes the local storage under storage_mutex,
+ *               and so does the shutdown sequence.
+ * Oct 17, 2026  The sectored coherence, the exclusive requests and the
+ *               invalidations carry sector masks.
  *
  */
 
-#define BACKOFF_INTERVAL_UNIT 20000 //microsecond
-#define BACKOFF_COUNTER_MAX 8
+#define DIR_LOCKS_PER_WORKER 16 //stripes of the directory lock for each service worker
+#define CACHE_SHARD_NUM 16 //most shards of the local cache, each shard has its own lock
+#define CACHE_SHARD_MIN_BLOCKS 16 //fewest blocks in a cache shard
+#define CLEANER_HIGH_WATERMARK 25 //default watermarks of the cleaner, in percent of a shard's blocks
+#define CLEANER_LOW_WATERMARK 10
+#define CLEANER_INTERVAL_MS 5 //the cleaner looks at the shards at least this often
+#define CLEANER_BATCH 8 //most blocks of a shard being cleaned at a time
+#define VICTIM_BUFFER_SIZE 4 //most victims of a shard being written back at a time
+#define MESSAGE_POOL_SLACK_PER_WORKER 4 //pooled buffers for the queued requests, for each service worker
+#define DIRTY_MASK_SIZE 8 //bytes of a dirty sector mask in the write back messages
+#define STORAGE_QUEUE_DEPTH 16 //most asynchronous requests of a thread on the local storage
 
 #include "cpl.h"
 #include <pthread.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 #include <signal.h>
 #include <cstring>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 namespace vlaser {
 
@@ -50,12 +102,165 @@ namespace vlaser {
     return;
   }
 
+  inline void
+  cpl::PackMask(unsigned long long mask, vsbyte* packed)
+  {
+    PackAddr((vsaddr)mask, packed);
+    PackAddr((vsaddr)(mask >> 32), packed + sizeof(vsaddr));
+    return;
+  }
+
+  inline void
+  cpl::UnpackMask(vsbyte* packed, unsigned long long& mask)
+  {
+    vsaddr lo, hi;
+
+    UnpackAddr(packed, lo);
+    UnpackAddr(packed + sizeof(vsaddr), hi);
+    mask = ((unsigned long long)hi << 32) | lo;
+    return;
+  }
+
+  int
+  cpl::PackSectors(vsbyte* data, unsigned long long mask, vsbyte* mes)
+  {
+    const int sectors = vscache::DIRTY_SECTORS;
+    int sector = block_size / sectors;
+    vsbyte* p = mes;
+    int i, j;
+
+    /* each run of the sectors at once */
+    for(i = 0; i < sectors; i = j) {
+      while(i < sectors && !((mask >> i) & 1))
+        ++i;
+      for(j = i; j < sectors && ((mask >> j) & 1); ++j)
+        ;
+      memcpy(p, data + i * sector, (j - i) * sector);
+      p += (j - i) * sector;
+    }
+    return (p - mes);
+  }
+
+  int
+  cpl::UnpackSectors(vsbyte* mes, unsigned long long mask, vsbyte* data)
+  {
+    const int sectors = vscache::DIRTY_SECTORS;
+    int sector = block_size / sectors;
+    vsbyte* p = mes;
+    int i, j;
+
+    for(i = 0; i < sectors; i = j) {
+      while(i < sectors && !((mask >> i) & 1))
+        ++i;
+      for(j = i; j < sectors && ((mask >> j) & 1); ++j)
+        ;
+      memcpy(data + i * sector, p, (j - i) * sector);
+      p += (j - i) * sector;
+    }
+    return (p - mes);
+  }
+
+  int
+  cpl::PackDirty(vscache* pcache, vsaddr addr, vsbyte* data, vsbyte* mes)
+  {
+    const int sectors = vscache::DIRTY_SECTORS;
+    int sector = block_size / sectors;
+    unsigned long long mask = pcache->GetDirtyMask(addr);
+    blockoffset start[vscache::DIRTY_RANGES], len[vscache::DIRTY_RANGES];
+    vsbyte* p = mes + DIRTY_MASK_SIZE;
+    int i, j, n, bytes;
+
+    /* a block set MODIFIED but not marked is written back as the
+     * sectors it has, whole if it has all of them
+     */
+    if(mask == 0)
+      mask = pcache->GetValidSectors(addr);
+    if((n = pcache->GetDirtyRanges(addr, start, len)) > 0) {
+      /* the ranges, each with its offset and length, if they are shorter
+       * than the dirty sectors, or the whole block
+       */
+      for(bytes = sizeof(vsaddr), i = 0; i < n; ++i)
+        bytes += 2 * sizeof(vsaddr) + len[i];
+      for(j = 0, i = 0; i < sectors; ++i)
+        j += (mask >> i) & 1;
+      if(bytes < j * sector) {
+        memset(mes, 0, DIRTY_MASK_SIZE);
+        PackAddr(n, p);
+        p += sizeof(vsaddr);
+        for(i = 0; i < n; ++i) {
+          PackAddr(start[i], p);
+          PackAddr(len[i], p + sizeof(vsaddr));
+          memcpy(p + 2 * sizeof(vsaddr), data + start[i], len[i]);
+          p += 2 * sizeof(vsaddr) + len[i];
+        }
+        return (p - mes);
+      }
+    }
+    PackMask(mask, mes);
+    p += PackSectors(data, mask, p);
+    return (p - mes);
+  }
+
+  void
+  cpl::WriteDirty(vsaddr localaddr, vsbyte* mes)
+  {
+    const int sectors = vscache::DIRTY_SECTORS;
+    int sector = block_size / sectors;
+    unsigned long long mask;
+    vsbyte* p = mes + DIRTY_MASK_SIZE;
+    vsaddr n, k, start, len;
+    int i, j;
+
+    UnpackMask(mes, mask);
+    if(mask == ~0ULL) {
+      plocal_storage->WrBlock(localaddr, p);
+      return;
+    }
+    if(mask == 0) {
+      /* byte ranges */
+      UnpackAddr(p, n);
+      p += sizeof(vsaddr);
+      for(k = 0; k < n; ++k) {
+        UnpackAddr(p, start);
+        UnpackAddr(p + sizeof(vsaddr), len);
+        plocal_storage->Wr(localaddr, start, p + 2 * sizeof(vsaddr), len);
+        p += 2 * sizeof(vsaddr) + len;
+      }
+      return;
+    }
+    /* write each run of the dirty sectors at once */
+    for(i = 0; i < sectors; i = j) {
+      while(i < sectors && !((mask >> i) & 1))
+        ++i;
+      for(j = i; j < sectors && ((mask >> j) & 1); ++j)
+        ;
+      if(j > i) {
+        plocal_storage->Wr(localaddr, i * sector, p, (j - i) * sector);
+        p += (j - i) * sector;
+      }
+    }
+    return;
+  }
+
+  inline void
+  cpl::ReadStorage(vsaddr localaddr, vsbyte* buf)
+  {
+    if(plocal_storage->ConcurrentRead())
+      plocal_storage->RdBlock(localaddr, buf);
+    else {
+      storage_mutex.lock();
+      plocal_storage->RdBlock(localaddr, buf);
+      storage_mutex.unlock();
+    }
+    return;
+  }
+
   inline int
-  cpl::AdviseCacheHolder(vsaddr localaddr, vsbyte* mes)
+  cpl::AdviseCacheHolder(ServiceBuffers& sb, vsaddr localaddr, vsbyte* mes)
   {
-    int i;
-    int j = local_dir[localaddr].holders.size();
-    TypeOfHolderList::iterator tmp = local_dir[localaddr].holders.begin();
+    int i, k;
+    int n = local_dir->List(localaddr, sb.ser_dests);
+    int j = n;
     vsbyte* my_check = mes;
 
     /* if this cache block is being held by more vlaser
@@ -74,14 +279,12 @@ namespace vlaser {
     PackAddr(j, mes);
     mes += sizeof(vsaddr);
     i = j;
-    while(i > 0) {
-      if(*tmp != my_id) {
-        PackAddr(*tmp, mes);
+    for(k = 0; i > 0 && k < n; ++k)
+      if(sb.ser_dests[k] != my_id) {
+        PackAddr(sb.ser_dests[k], mes);
         mes += sizeof(vsaddr);
         --i;
       }
-      ++tmp;
-    }
     if((my_check + (j + 1) * sizeof(vsaddr)) != mes)
       throw cpl_logic_error("local storage directory entry contain duplicate VLASER node id: from cpl::AdviseCacheHolder()");
     VLASER_DEB("making advice of cache holders ok");
@@ -90,14 +293,18 @@ namespace vlaser {
   }
 
   int
-  cpl::UpdateDirectory(vsaddr globaladdr, vsaddr localaddr, cpl::StorageDirectoryStatus st, vsnodeid source_id)
+  cpl::UpdateDirectory(ServiceBuffers& sb, vsaddr globaladdr, vsaddr localaddr, cpl::StorageDirectoryStatus st, vsnodeid source_id,
+    unsigned long long want)
   {
-    TypeOfHolderList::iterator tmp;
+    vscache* pcache = CacheOf(globaladdr);
+    vlamutex& cmutex = CacheMutex(globaladdr);
+    vsnodeid holder;
     int tag;
     vscache::BlockStatus cache_tag;
     vscache::BlockStatus cst;
     vsbyte* pbuf;
-    int i, s;
+    int i, k, n;
+    int granted = 0; /* source_id is given the block as exclusive */
 
     /*
      * 1) if new status is DIR_EXCLUSIVE, it means that source_id node wants
@@ -108,75 +315,76 @@ namespace vlaser {
      */
     if((st != DIR_EXCLUSIVE) && (st != DIR_SHARED))
       throw cpl_logic_error("given wrong new status for the local storage block: from cpl::UpdateDirectory");
+    if(sectored)
+      return UpdateSectored(sb, globaladdr, localaddr, st, source_id, want);
 
     VLASER_DEB("|UPDIR|updating global block "<<globaladdr<<" which local address is "<<localaddr<<" with new status "<<st<<" and source id "<<source_id);
-    VLASER_DEB("|UPDIR|original status is "<<local_dir[localaddr].status);
-    switch(local_dir[localaddr].status) {
+    VLASER_DEB("|UPDIR|original status is "<<local_dir->GetStatus(localaddr));
+    switch(local_dir->GetStatus(localaddr)) {
       case DIR_NONCACHED:
-        local_dir[localaddr].status = DIR_EXCLUSIVE;
-        local_dir[localaddr].holders.insert(source_id);
+        local_dir->SetStatus(localaddr, DIR_EXCLUSIVE);
+        local_dir->Insert(localaddr, source_id);
+        granted = 1;
         break;
 
       case DIR_SHARED:
         if(st == DIR_EXCLUSIVE) {
           /* source_id node needs a exclusive cache block copy */
-          tmp = local_dir[localaddr].holders.begin();
-          PackAddr(globaladdr, send_buf);
-          s = 0;
-          VLASER_DEB("|UPDIR|now block "<<globaladdr<<" has "<<local_dir[localaddr].holders.size()<<" holders");
-          while(tmp != local_dir[localaddr].holders.end()) { /* scan all the block's holders */
-            VLASER_DEB("|UPDIR|process node "<<*tmp<<" for ser");
-            if(*tmp != source_id) { /* neglect source_id in the holders set */
-              if(*tmp == my_id) {
-                /* if this node has a copy in local cache, set it as invalid */
-                cache_mutex.lock();
-                if(plocal_cache->IsCached(globaladdr, cst)) {
-                  if(cst == MODIFIED)
-                    throw cpl_logic_error("local cache does not agree with local storage directory: from cpl::UpdateDirectory()");
-                  plocal_cache->SetBlockStatus(globaladdr, INVALID);
-                  VLASER_DEB("|UDIR|set the block as invalid in my cache");
-                }
-                cache_mutex.unlock();
-              }
-              else {
-                /* if some remote nodes have cache copys of the block, tell them to set invalid */
-                VLASER_DEB("|UPDIR|sending TAG_SET_INVALID to "<<*tmp);
-                i = pmessage_passing->TrySerReqSend(*tmp, TAG_SET_INVALID, send_buf, sizeof(vsaddr));
-                if(i == -1) {
-                  VLASER_DEB("|UPDIR|message passing send timeout detected, now return -1 without change the dir status");
-                  if(s) {
-                    VLASER_DEB("|UPDIR|put source node "<<source_id<<" back to block "<<globaladdr<<"'s dir");
-                    local_dir[localaddr].holders.insert(source_id);
-                  }
-                  return -1;
-                }
-                /* wait for nodes confirming the block has been set as invalid */
-                pmessage_passing->WaitSer(*tmp, tag, recv_buf, message_buf_size);
-                if(tag != TAG_SER_SET_CONFIRM)
-                  throw cpl_logic_error("remote cache status does not agree with local storage directory: from cpl::UpdateDirectory()");
-                VLASER_DEB("|UPDIR|received TAG_SER_SET_CONFIRM from "<<*tmp);
+          k = local_dir->List(localaddr, sb.ser_dests);
+          VLASER_DEB("|UPDIR|now block "<<globaladdr<<" has "<<k<<" holders");
+          /* keep the remote holders in sb.ser_dests */
+          n = 0;
+          for(i = 0; i < k; ++i) {
+            holder = sb.ser_dests[i];
+            if(holder == source_id) /* neglect source_id in the holders set */
+              continue;
+            if(holder == my_id) {
+              /* if this node has a copy in local cache, set it as invalid */
+              cmutex.lock();
+              if(pcache->IsCached(globaladdr, cst)) {
+                if(cst == MODIFIED)
+                  throw cpl_logic_error("local cache does not agree with local storage directory: from cpl::UpdateDirectory()");
+                pcache->SetBlockStatus(globaladdr, INVALID);
+                VLASER_DEB("|UDIR|set the block as invalid in my cache");
               }
+              cmutex.unlock();
             }
             else
-              s = 1;
-            local_dir[localaddr].holders.erase(tmp);
-            VLASER_DEB("|UPDIR|holders' number changed to "<<local_dir[localaddr].holders.size());
-            tmp = local_dir[localaddr].holders.begin();
+              sb.ser_dests[n++] = holder;
+          }
+          if(n > 0) {
+            /* if some remote nodes have cache copys of the block, tell them all to set invalid at once */
+            VLASER_DEB("|UPDIR|sending TAG_SET_INVALID to "<<n<<" nodes");
+            /* sb.ser_dests is ascending as the holder list is */
+            for(i = 0; i < n; ++i)
+              ser_mutex[sb.ser_dests[i]].lock();
+            PackAddr(globaladdr, sb.send_buf);
+            for(i = 0; i < n; ++i)
+              pmessage_passing->ReqSend(sb.ser_dests[i], TAG_SET_INVALID, sb.send_buf, sizeof(vsaddr));
+            /* wait for nodes confirming the block has been set as invalid */
+            for(i = 0; i < n; ++i) {
+              pmessage_passing->WaitSer(sb.ser_dests[i], tag, sb.recv_buf, message_buf_size);
+              ser_mutex[sb.ser_dests[i]].unlock();
+              if(tag != TAG_SER_SET_CONFIRM)
+                throw cpl_logic_error("remote cache status does not agree with local storage directory: from cpl::UpdateDirectory()");
+              VLASER_DEB("|UPDIR|received TAG_SER_SET_CONFIRM from "<<sb.ser_dests[i]);
+            }
           }
           /* clean the holder list */
-          local_dir[localaddr].status = st;
-          local_dir[localaddr].holders.clear();
-          local_dir[localaddr].holders.insert(source_id);
+          local_dir->SetStatus(localaddr, st);
+          local_dir->Clear(localaddr);
+          local_dir->Insert(localaddr, source_id);
+          granted = 1;
         }
         else /* source_id node only wants a read only cache copy, than just add source_id to the holder list */
-          local_dir[localaddr].holders.insert(source_id);
+          local_dir->Insert(localaddr, source_id);
         break;
 
       case DIR_EXCLUSIVE: /* if updating an exclusive block */
-        if(local_dir[localaddr].holders.size() != 1)
-          cpl_logic_error("the exclusive block's holder list is broken: from cpl::UpdateDirectory()");
-        tmp = local_dir[localaddr].holders.begin();
-        if(*tmp != source_id) {
+        if(local_dir->List(localaddr, sb.ser_dests) != 1)
+          throw cpl_logic_error("the exclusive block's holder list is broken: from cpl::UpdateDirectory()");
+        holder = sb.ser_dests[0];
+        if(holder != source_id) {
           if(st == DIR_SHARED) { /* source_id wants a read only cache copy */
             tag = TAG_SET_SHARED;
             cache_tag = SHARED;
@@ -185,11 +393,11 @@ namespace vlaser {
             tag = TAG_SET_INVALID;
             cache_tag = INVALID;
           }
-          if(*tmp == my_id) { /* if the block is currently being held by this node */
-            cache_mutex.lock();
-            if(plocal_cache->IsCached(globaladdr, cst)) {
+          if(holder == my_id) { /* if the block is currently being held by this node */
+            cmutex.lock();
+            if(pcache->IsCached(globaladdr, cst)) {
               if(cst == MODIFIED) { /* if modified, write it back */
-                pbuf = plocal_cache->AccessBlock(globaladdr, 0);
+                pbuf = pcache->AccessBlock(globaladdr, 0);
                 storage_mutex.lock();
                 plocal_storage->WrBlock(localaddr, pbuf);
                 storage_mutex.unlock();
@@ -198,25 +406,23 @@ namespace vlaser {
               /*
                * set the correct cache status
                */
-              plocal_cache->SetBlockStatus(globaladdr, cache_tag);
+              pcache->SetBlockStatus(globaladdr, cache_tag);
             }
-            cache_mutex.unlock();
+            cmutex.unlock();
           }
           else { /* if the block is being held by a remote node */
-            PackAddr(globaladdr, send_buf);
+            PackAddr(globaladdr, sb.send_buf);
             /* ask the remote node to set invalid or set shared */
-            VLASER_DEB("|UPDIR|sending TAG_SET_INVALID or TAG_SET_SHARED to "<<*tmp);
-            i = pmessage_passing->TrySerReqSend(*tmp, tag, send_buf, sizeof(vsaddr));
-            if(i == -1) {
-              VLASER_DEB("|UPDIR|message passing send timeout detected, now return -1 without change the dir status");
-              return -1;
-            }
-            pmessage_passing->WaitSer(*tmp, tag, recv_buf, message_buf_size);
-            VLASER_DEB("|UPDIR|got SER ACK tagged as "<<tag<<" from "<<*tmp);
+            VLASER_DEB("|UPDIR|sending TAG_SET_INVALID or TAG_SET_SHARED to "<<holder);
+            ser_mutex[holder].lock();
+            pmessage_passing->ReqSend(holder, tag, sb.send_buf, sizeof(vsaddr));
+            pmessage_passing->WaitSer(holder, tag, sb.recv_buf, message_buf_size);
+            ser_mutex[holder].unlock();
+            VLASER_DEB("|UPDIR|got SER ACK tagged as "<<tag<<" from "<<holder);
             if(tag == TAG_SER_SET_WRITEBACK) {
               /* if write back tag is returned, write it back to local storage */
               storage_mutex.lock();
-              plocal_storage->WrBlock(localaddr, recv_buf);
+              WriteDirty(localaddr, sb.recv_buf);
               storage_mutex.unlock();
               VLASER_DEB("|UPDIR|write back the block to local storage");
             }
@@ -224,24 +430,189 @@ namespace vlaser {
               throw cpl_logic_error("remote cache return error tag: from cpl::UpdateDirectory()");
           }
           if(st == DIR_SHARED)
-            local_dir[localaddr].holders.insert(source_id);
+            local_dir->Insert(localaddr, source_id);
           else {
-            local_dir[localaddr].holders.clear();
-            local_dir[localaddr].holders.insert(source_id);
+            local_dir->Clear(localaddr);
+            local_dir->Insert(localaddr, source_id);
+            granted = 1;
           }
         }
-        local_dir[localaddr].status = st;
+        local_dir->SetStatus(localaddr, st);
         break;
     }
+    /* the new exclusive holder may change the data, which is a new version */
+    if(granted)
+      ++block_version[localaddr];
     /* return the actual status that has been set to the directory */
     VLASER_DEB("|UPDIR|update block "<< globaladdr << " directory status to "
-      <<local_dir[localaddr].status<<" ok, now block globaladdr has "<<local_dir[localaddr].holders.size()<<" holders");
-    return (local_dir[localaddr].status);
+      <<local_dir->GetStatus(localaddr)<<" ok, now block globaladdr has "<<local_dir->Count(localaddr)<<" holders");
+    return (local_dir->GetStatus(localaddr));
   } /* cpl::UpdateDirectory method definition end */
 
+  int
+  cpl::UpdateSectored(ServiceBuffers& sb, vsaddr globaladdr, vsaddr localaddr, cpl::StorageDirectoryStatus st, vsnodeid source_id,
+    unsigned long long want)
+  {
+    vscache* pcache = CacheOf(globaladdr);
+    vlamutex& cmutex = CacheMutex(globaladdr);
+    vsnodeid owner = dir_owner[localaddr];
+    vsnodeid holder;
+    vscache::BlockStatus cst;
+    int i, k, n, tag;
+    int granted = 0; /* source_id becomes the owner */
+
+    VLASER_DEB("|UPDIR|updating sectors "<<want<<" of global block "<<globaladdr<<" with new status "<<st<<" and source id "<<source_id);
+    VLASER_DEB("|UPDIR|original status is "<<local_dir->GetStatus(localaddr)<<" and owner is "<<owner);
+    if(local_dir->GetStatus(localaddr) == DIR_NONCACHED) {
+      /* the only holder is given the whole block as exclusive */
+      local_dir->SetStatus(localaddr, DIR_EXCLUSIVE);
+      local_dir->Insert(localaddr, source_id);
+      dir_owner[localaddr] = source_id;
+      granted = 1;
+    }
+    else if(st == DIR_SHARED) {
+      if(local_dir->GetStatus(localaddr) == DIR_EXCLUSIVE) {
+        /* the owner shares its copy, the other holders keep their sectors */
+        if(owner == my_id) {
+          cmutex.lock();
+          if(pcache->IsCached(globaladdr, cst)) {
+            if(cst == MODIFIED) {
+              storage_mutex.lock();
+              plocal_storage->WrBlock(localaddr, pcache->AccessBlock(globaladdr, 0));
+              storage_mutex.unlock();
+              VLASER_DEB("|UPDIR|write back the block to local storage");
+            }
+            pcache->SetBlockStatus(globaladdr, SHARED);
+          }
+          cmutex.unlock();
+        }
+        else if(owner != source_id) {
+          PackAddr(globaladdr, sb.send_buf);
+          VLASER_DEB("|UPDIR|sending TAG_SET_SHARED to "<<owner);
+          ser_mutex[owner].lock();
+          pmessage_passing->ReqSend(owner, TAG_SET_SHARED, sb.send_buf, sizeof(vsaddr));
+          pmessage_passing->WaitSer(owner, tag, sb.recv_buf, message_buf_size);
+          ser_mutex[owner].unlock();
+          if(tag == TAG_SER_SET_WRITEBACK) {
+            storage_mutex.lock();
+            WriteDirty(localaddr, sb.recv_buf);
+            storage_mutex.unlock();
+            VLASER_DEB("|UPDIR|write back the block to local storage");
+          }
+          else if(tag != TAG_SER_SET_CONFIRM)
+            throw cpl_logic_error("remote cache return error tag: from cpl::UpdateSectored()");
+        }
+        local_dir->SetStatus(localaddr, DIR_SHARED);
+        dir_owner[localaddr] = node_num;
+      }
+      local_dir->Insert(localaddr, source_id);
+    }
+    else {
+      /* the owner drops its whole copy, the other holders the sectors wanted */
+      k = local_dir->List(localaddr, sb.ser_dests);
+      n = 0;
+      for(i = 0; i < k; ++i) {
+        holder = sb.ser_dests[i];
+        if(holder == source_id)
+          continue;
+        if(holder == my_id) {
+          /* the home's own copy is whole, drop it */
+          cmutex.lock();
+          if(pcache->IsCached(globaladdr, cst)) {
+            if(cst == MODIFIED) {
+              storage_mutex.lock();
+              plocal_storage->WrBlock(localaddr, pcache->AccessBlock(globaladdr, 0));
+              storage_mutex.unlock();
+              VLASER_DEB("|UPDIR|write back the block to local storage");
+            }
+            pcache->SetBlockStatus(globaladdr, INVALID);
+          }
+          cmutex.unlock();
+        }
+        else
+          sb.ser_dests[n++] = holder;
+      }
+      /* sb.ser_dests is ascending as the holder list is */
+      for(i = 0; i < n; ++i)
+        ser_mutex[sb.ser_dests[i]].lock();
+      PackAddr(globaladdr, sb.send_buf);
+      PackMask(want, sb.send_buf + sizeof(vsaddr));
+      VLASER_DEB("|UPDIR|sending TAG_SET_INVALID to "<<n<<" nodes");
+      for(i = 0; i < n; ++i)
+        pmessage_passing->ReqSend(sb.ser_dests[i], TAG_SET_INVALID, sb.send_buf, sizeof(vsaddr) + DIRTY_MASK_SIZE);
+      /* the holders keeping some sectors stay in the list */
+      local_dir->Clear(localaddr);
+      for(i = 0; i < n; ++i) {
+        pmessage_passing->WaitSer(sb.ser_dests[i], tag, sb.recv_buf, message_buf_size);
+        ser_mutex[sb.ser_dests[i]].unlock();
+        if(tag == TAG_SER_SET_WRITEBACK) {
+          storage_mutex.lock();
+          WriteDirty(localaddr, sb.recv_buf);
+          storage_mutex.unlock();
+          VLASER_DEB("|UPDIR|write back the block to local storage");
+        }
+        else if(tag == TAG_SER_SET_KEPT)
+          local_dir->Insert(localaddr, sb.ser_dests[i]);
+        else if(tag != TAG_SER_SET_CONFIRM)
+          throw cpl_logic_error("remote cache return error tag: from cpl::UpdateSectored()");
+      }
+      local_dir->Insert(localaddr, source_id);
+      if(local_dir->GetStatus(localaddr) != DIR_EXCLUSIVE || owner != source_id)
+        granted = 1;
+      local_dir->SetStatus(localaddr, DIR_EXCLUSIVE);
+      dir_owner[localaddr] = source_id;
+    }
+    if(granted)
+      ++block_version[localaddr];
+    VLASER_DEB("|UPDIR|update block "<< globaladdr << " directory status to "
+      <<local_dir->GetStatus(localaddr)<<" ok, now block globaladdr has "<<local_dir->Count(localaddr)<<" holders");
+    return (local_dir->GetStatus(localaddr));
+  }
+
+  inline int
+  cpl::IsOwner(vsaddr localaddr, vsnodeid source)
+  {
+    if(local_dir->GetStatus(localaddr) != DIR_EXCLUSIVE)
+      return 0;
+    if(sectored)
+      return (dir_owner[localaddr] == source);
+    return local_dir->Has(localaddr, source);
+  }
+
+  inline void
+  cpl::DropOwner(vsaddr localaddr)
+  {
+    if(sectored) {
+      /* the holders of the other sectors keep them */
+      local_dir->Erase(localaddr, dir_owner[localaddr]);
+      dir_owner[localaddr] = node_num;
+      local_dir->SetStatus(localaddr, local_dir->Count(localaddr) == 0 ? DIR_NONCACHED : DIR_SHARED);
+    }
+    else {
+      local_dir->SetStatus(localaddr, DIR_NONCACHED);
+      local_dir->Clear(localaddr);
+    }
+    return;
+  }
+
+  inline int
+  cpl::SelfUpdateDirectory(vsaddr globaladdr, cpl::StorageDirectoryStatus st)
+  {
+    vsaddr laddr = globaladdr % local_block_num;
+    int i;
+
+    DirMutex(laddr).lock();
+    VLASER_DEB("self update block "<<globaladdr<<" with new status "<<st);
+    i = UpdateDirectory(self_bufs, globaladdr, laddr, st, my_id);
+    DirMutex(laddr).unlock();
+    return i;
+  }
+
   inline void
   cpl::CopeWithOneReq()
   {
+    std::map<vsaddr, std::deque<ServiceJob> >::iterator p;
+    ServiceJob job;
     vsnodeid source;
     vsaddr gaddr;
     vsaddr laddr;
@@ -249,23 +620,424 @@ namespace vlaser {
 
     VLASER_DEB("waiting a request in CopeWithOnReq()");
     /* wait for a request's incoming */
-    if(pmessage_passing->WaitReq(source, req, recv_buf, message_buf_size) == -1) {
+    if(pmessage_passing->WaitReq(source, req, service_bufs.recv_buf, message_buf_size) == -1) {
       VLASER_DEB("got a false request, now do nothing, just return");
       return;
     }
-    UnpackAddr(recv_buf, gaddr);
+    UnpackAddr(service_bufs.recv_buf, gaddr);
     VLASER_DEB("got a request as "<<req<<" from source "<<source<<" with gaddr is "<<gaddr);
     laddr = gaddr % local_block_num; /* get the local address from global address */
-    if(req < 12 && req >= 0)
-      (this->*resp_table[req])(source, gaddr, laddr);
-    else
+    if(req >= TAG_REQ_NUM || req < 0 || resp_table[req] == NULL)
       throw cpl_runtime_error("got wrong req tag: from cpl::CopeWithOneReq");
+    switch(req) {
+      /* the requests which only touch the local cache or the finish signal
+       * are answered here. TAG_SET_INVALID and TAG_SET_SHARED must not wait
+       * behind the workers, which may be waiting the answers of other nodes.
+       */
+      case TAG_REQ_CACHED_BLOCK:
+      case TAG_SET_INVALID:
+      case TAG_SET_SHARED:
+      case TAG_SHUTDOWN:
+      case TAG_FINISH:
+      case TAG_CLEAN_DONE:
+      case TAG_VICTIM_DONE:
+        (this->*resp_table[req])(service_bufs, source, gaddr, laddr);
+        break;
+
+      default:
+        /* the requests on a directory entry go to the entry's worker */
+        job.source = source;
+        job.tag = req;
+        job.gaddr = gaddr;
+        job.data = NULL;
+        if(req == TAG_REQ_WRITEBACK || req == TAG_REQ_CLEAN || req == TAG_REQ_VICTIM || req == TAG_REQ_BLOCK_VERSION
+          || (sectored && req == TAG_REQ_BLOCK_EXCLUSIVE)) {
+          /* hand the received block, version or sector masks over to the worker */
+          job.data = service_bufs.recv_buf;
+          service_bufs.recv_buf = message_pool->Get();
+        }
+        job_mutex.lock();
+        if((p = pending_jobs.find(laddr)) != pending_jobs.end()) {
+          /* the entry is busy, wait behind its earlier requests */
+          VLASER_DEB("entry "<<laddr<<" is busy, queue the request");
+          p->second.push_back(job);
+        }
+        else {
+          pending_jobs[laddr];
+          runnable_jobs.push_back(job);
+          job_cond.signal();
+        }
+        job_mutex.unlock();
+        break;
+    }
+    return;
+  }
+
+  void
+  cpl::ServiceWorkerThread(ServiceWorker& w)
+  {
+    std::map<vsaddr, std::deque<ServiceJob> >::iterator p;
+    ServiceJob job;
+    vsaddr laddr;
+
+    while(1) {
+      job_mutex.lock();
+      while(runnable_jobs.empty() && !workers_stop)
+        job_cond.wait();
+      if(runnable_jobs.empty()) { /* stopped and nothing left */
+        job_mutex.unlock();
+        break;
+      }
+      job = runnable_jobs.front();
+      runnable_jobs.pop_front();
+      job_mutex.unlock();
+
+      if(job.data != NULL) {
+        message_pool->Put(w.bufs.recv_buf);
+        w.bufs.recv_buf = job.data;
+      }
+      laddr = job.gaddr % local_block_num;
+      (this->*resp_table[job.tag])(w.bufs, job.source, job.gaddr, laddr);
+
+      /* the entry's next request, or the entry is not busy any more */
+      job_mutex.lock();
+      p = pending_jobs.find(laddr);
+      if(p->second.empty())
+        pending_jobs.erase(p);
+      else {
+        runnable_jobs.push_back(p->second.front());
+        p->second.pop_front();
+        job_cond.signal();
+      }
+      job_mutex.unlock();
+    }
+    VLASER_DEB("service worker exit");
+    return;
+  }
+
+  void*
+  cpl::_worker_routine(void* pworker)
+  {
+    ServiceWorker* w = (ServiceWorker*)pworker;
+
+    try {
+      w->owner->ServiceWorkerThread(*w);
+    }
+    /* print the all error messages here and rethrow the exceptions */
+    catch(std::logic_error& except) {
+      std::cout<<"|FATAL| get logic error"<<std::endl<<except.what()<<std::endl
+        <<"catched in cpl::ServiceWorkerThread"<<std::endl
+        <<"will not handle it, now rethrow."<<std::endl;
+      throw;
+    }
+    catch(std::runtime_error& except) {
+      std::cout<<"|FATAL| get runtime error"<<std::endl<<except.what()<<std::endl
+        <<"catched in cpl::ServiceWorkerThread"<<std::endl
+        <<"will not handle it, now rethrow."<<std::endl;
+      throw;
+    }
+    return NULL;
+  }
+
+  void
+  cpl::StartWorkers()
+  {
+    workers_stop = 0;
+    for(int i = 0; i < worker_num; ++i) {
+      workers[i].owner = this;
+      if(pthread_create(&workers[i].thread_id, NULL, &vlaser::cpl::_worker_routine, &workers[i]) != 0)
+        throw cpl_runtime_error("can not create new thread with pthread_create: from cpl::StartWorkers()");
+    }
+    VLASER_DEB(worker_num<<" service workers started");
+    return;
+  }
+
+  void
+  cpl::StopWorkers()
+  {
+    /* the workers finish the queued requests before exiting */
+    job_mutex.lock();
+    workers_stop = 1;
+    job_cond.broadcast();
+    job_mutex.unlock();
+    for(int i = 0; i < worker_num; ++i)
+      pthread_join(workers[i].thread_id, NULL);
+    VLASER_DEB("service workers stopped");
+    return;
+  }
+
+  inline void
+  cpl::WaitWriteBack(vsaddr addr)
+  {
+    std::vector<vsaddr>& list = cleaning[addr % cache_shard_num];
+
+    while(std::find(list.begin(), list.end(), addr) != list.end() || FindVictim(addr) != NULL) {
+      VLASER_DEB("waiting the cleaning of block "<<addr);
+      writeback_cond[addr % cache_shard_num]->wait();
+    }
+    return;
+  }
+
+  inline cpl::VictimBlock*
+  cpl::VictimsOf(vsaddr globaladdr)
+  {
+    return victims + (globaladdr % cache_shard_num) * VICTIM_BUFFER_SIZE;
+  }
+
+  cpl::VictimBlock*
+  cpl::FindVictim(vsaddr addr)
+  {
+    VictimBlock* v = VictimsOf(addr);
+
+    for(int i = 0; i < VICTIM_BUFFER_SIZE; ++i)
+      if(v[i].busy && v[i].addr == addr)
+        return v + i;
+    return NULL;
+  }
+
+  vsbyte*
+  cpl::PutVictim(vsaddr addr, int& len)
+  {
+    VictimBlock* v = VictimsOf(addr);
+    vsbyte* pbuf;
+    int i;
+
+    while(1) {
+      for(i = 0; i < VICTIM_BUFFER_SIZE && v[i].busy; ++i)
+        ;
+      if(i < VICTIM_BUFFER_SIZE)
+        break;
+      VLASER_DEB("victim buffer is full, waiting");
+      writeback_cond[addr % cache_shard_num]->wait();
+    }
+    /* the block may have been set or cleaned while waiting. it is
+     * INVALID from now on, the buffer holds its data
+     */
+    if((pbuf = CacheOf(addr)->CleanBlock(addr)) == NULL)
+      return NULL;
+    v[i].addr = addr;
+    v[i].busy = 1;
+    v[i].dirty = 1;
+    PackAddr(addr, v[i].mes);
+    v[i].len = sizeof(vsaddr) + PackDirty(CacheOf(addr), addr, pbuf, v[i].mes + sizeof(vsaddr));
+    len = v[i].len;
+    __sync_fetch_and_add(&io_busy, 1);
+    return v[i].mes;
+  }
+
+  void
+  cpl::SpillVictim(vscache* pcache, vlamutex& cmutex, vsaddr addr)
+  {
+    vsbyte* pbuf = NULL;
+    vsaddr version;
+    vscache::BlockStatus st;
+
+    if(pdisk_cache == NULL || addr / local_block_num == my_id)
+      return;
+    cmutex.lock();
+    if(pcache->IsCached(addr, st) && st == SHARED && pcache->IsIntegrity(addr)
+      && (version = pcache->GetBlockVersion(addr)) != vscache::NO_VERSION)
+      pbuf = pcache->AccessBlock(addr, 0);
+    cmutex.unlock();
+    /* the block may be set as invalid now, then its version is out of date */
+    if(pbuf != NULL) {
+      VLASER_DEB("put block "<<addr<<" of version "<<version<<" to the disk cache");
+      pdisk_cache->Put(addr, version, pbuf);
+    }
+    return;
+  }
+
+  inline void
+  cpl::WakeCleaner()
+  {
+    if(clean_high > 0) {
+      cleaner_mutex.lock();
+      cleaner_cond.signal();
+      cleaner_mutex.unlock();
+    }
+    return;
+  }
+
+  void
+  cpl::CleanShard(int shard)
+  {
+    vscache* pcache = cache_shards[shard];
+    vlamutex& cmutex = cache_mutex[shard];
+    vsaddr n, high, low, batch;
+    vsaddr gaddr, laddr;
+    vsnodeid home;
+    vsbyte* pbuf;
+    vscache::BlockStatus cst;
+    int len;
+
+    high = pcache->cache_size * clean_high / 100;
+    low = pcache->cache_size * clean_low / 100;
+    batch = pcache->cache_size / 2 < CLEANER_BATCH ? pcache->cache_size / 2 : CLEANER_BATCH;
+    cmutex.lock();
+    n = pcache->GetModifiedNum();
+    if(n > high) /* too many dirty blocks, clean the coldest down to the low watermark */
+      pcache->FindColdModified(n - low, pcache->cache_size, clean_list);
+    else /* keep the low coldest blocks clean */
+      pcache->FindColdModified(low, low, clean_list);
+    cmutex.unlock();
+
+    for(size_t k = 0; k < clean_list.size(); ++k) {
+      gaddr = clean_list[k];
+      home = gaddr / local_block_num;
+      laddr = gaddr % local_block_num;
+      if(home == my_id) {
+        /* a local block is written back here, the directory stays DIR_EXCLUSIVE */
+        DirMutex(laddr).lock();
+        cmutex.lock();
+        /* a victim written back by the main thread is DIR_NONCACHED
+         * but still MODIFIED in cache until it is replaced, leave it
+         */
+        if(pcache->IsCached(gaddr, cst) && cst == MODIFIED && IsOwner(laddr, my_id)) {
+          pbuf = pcache->AccessBlock(gaddr, 0);
+          storage_mutex.lock();
+          plocal_storage->WrBlock(laddr, pbuf);
+          storage_mutex.unlock();
+          pcache->SetBlockStatus(gaddr, EXCLUSIVE);
+          __sync_fetch_and_add(&cleaned_num, 1);
+          VLASER_DEB("|CLEAN|cleaned local block "<<gaddr);
+        }
+        cmutex.unlock();
+        DirMutex(laddr).unlock();
+        continue;
+      }
+      if(batch == 0) /* a one block shard has no block to spare */
+        continue;
+      cmutex.lock();
+      /* wait for some of the blocks being cleaned, they are pinned, so
+       * at most half of a small shard is, leaving victims for a miss
+       */
+      while(cleaning[shard].size() >= batch)
+        writeback_cond[shard]->wait();
+      if((pbuf = pcache->BeginClean(gaddr)) != NULL) {
+        PackAddr(gaddr, clean_buf);
+        len = sizeof(vsaddr) + PackDirty(pcache, gaddr, pbuf, clean_buf + sizeof(vsaddr));
+        cleaning[shard].push_back(gaddr);
+      }
+      cmutex.unlock();
+      if(pbuf != NULL) {
+        VLASER_DEB("|CLEAN|request cleaning block "<<gaddr<<" to node "<<home);
+        pmessage_passing->ReqSend(home, TAG_REQ_CLEAN, clean_buf, len);
+      }
+    }
+    /* the TAG_CLEAN_DONE messages are answered by the service thread */
+    cmutex.lock();
+    while(!cleaning[shard].empty())
+      writeback_cond[shard]->wait();
+    cmutex.unlock();
+    return;
+  }
+
+  void
+  cpl::CleanerThread()
+  {
+    struct timespec ts;
+
+    cleaner_mutex.lock();
+    while(!cleaner_stop) {
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += CLEANER_INTERVAL_MS * 1000000L;
+      if(ts.tv_nsec >= 1000000000L) {
+        ++ts.tv_sec;
+        ts.tv_nsec -= 1000000000L;
+      }
+      cleaner_cond.timedwait(&ts);
+      if(cleaner_stop)
+        break;
+      cleaner_mutex.unlock();
+      /* the cleaning is an IO method, so the shutdown sequence waits it */
+      if(!BeginIO()) {
+        cleaner_mutex.lock();
+        break;
+      }
+      for(int i = 0; i < cache_shard_num; ++i)
+        CleanShard(i);
+      EndIO();
+      cleaner_mutex.lock();
+    }
+    cleaner_mutex.unlock();
+    VLASER_DEB("cleaner exit");
+    return;
+  }
+
+  void*
+  cpl::_cleaner_routine(void* pclass)
+  {
+    cpl* p = (cpl*)pclass;
+
+    try {
+      p->CleanerThread();
+    }
+    /* print the all error messages here and rethrow the exceptions */
+    catch(std::logic_error& except) {
+      std::cout<<"|FATAL| get logic error"<<std::endl<<except.what()<<std::endl
+        <<"catched in cpl::CleanerThread"<<std::endl
+        <<"will not handle it, now rethrow."<<std::endl;
+      throw;
+    }
+    catch(std::runtime_error& except) {
+      std::cout<<"|FATAL| get runtime error"<<std::endl<<except.what()<<std::endl
+        <<"catched in cpl::CleanerThread"<<std::endl
+        <<"will not handle it, now rethrow."<<std::endl;
+      throw;
+    }
+    return NULL;
+  }
+
+  void
+  cpl::StartCleaner()
+  {
+    cleaner_stop = 0;
+    if(pthread_create(&cleaner_thread_id, NULL, &vlaser::cpl::_cleaner_routine, this) != 0)
+      throw cpl_runtime_error("can not create new thread with pthread_create: from cpl::StartCleaner()");
+    VLASER_DEB("cleaner started");
+    return;
+  }
+
+  void
+  cpl::StopCleaner()
+  {
+    cleaner_mutex.lock();
+    cleaner_stop = 1;
+    cleaner_cond.signal();
+    cleaner_mutex.unlock();
+    pthread_join(cleaner_thread_id, NULL);
+    VLASER_DEB("cleaner stopped");
+    return;
+  }
+
+  void
+  cpl::NewServiceBuffers(ServiceBuffers& sb)
+  {
+    sb.send_buf = message_pool->Get();
+    sb.recv_buf = message_pool->Get();
+    sb.ser_dests = new vsnodeid[node_num];
+    sb.io_queue = plocal_storage->NewQueue(STORAGE_QUEUE_DEPTH);
+    sb.io_buf = message_pool->Get();
+    return;
+  }
+
+  void
+  cpl::FreeServiceBuffers(ServiceBuffers& sb)
+  {
+    message_pool->Put(sb.send_buf);
+    message_pool->Put(sb.recv_buf);
+    delete[] sb.ser_dests;
+    delete sb.io_queue;
+    message_pool->Put(sb.io_buf);
     return;
   }
 
   void
   cpl::MakeRespTable()
   {
+    /* tag 10 and 11 were the self requests, a local block never sends them */
+    for(int i = 0; i < TAG_REQ_NUM; ++i)
+      resp_table[i] = NULL;
     resp_table[TAG_REQ_BLOCK] = &cpl::Resp_req_block;
     resp_table[TAG_REQ_CACHED_BLOCK] = &cpl::Resp_req_cached_block;
     resp_table[TAG_REQ_BLOCK_THIS_NODE] = &cpl::Resp_req_block_this_node;
@@ -276,14 +1048,19 @@ namespace vlaser {
     resp_table[TAG_SET_SHARED] = &cpl::Resp_set_shared;
     resp_table[TAG_SHUTDOWN] = &cpl::Resp_shutdown;
     resp_table[TAG_FINISH] = &cpl::Resp_finish;
-    resp_table[TAG_SELF_REQ_BLOCK] = &cpl::Resp_self_req_block;
-    resp_table[TAG_SELF_REQ_BLOCK_EXCLUSIVE] = &cpl::Resp_self_req_block_exclusive;
+    resp_table[TAG_REQ_CLEAN] = &cpl::Resp_req_clean;
+    resp_table[TAG_CLEAN_DONE] = &cpl::Resp_clean_done;
+    resp_table[TAG_REQ_VICTIM] = &cpl::Resp_req_victim;
+    resp_table[TAG_VICTIM_DONE] = &cpl::Resp_victim_done;
+    resp_table[TAG_REQ_BLOCK_VERSION] = &cpl::Resp_req_block_version;
     return;
   }
 
   void
-  cpl::Resp_req_block(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_req_block(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
   {
+    vscache* pcache = CacheOf(gaddr);
+    vlamutex& cmutex = CacheMutex(gaddr);
     vsbyte* pbuf = NULL;
     int i;
     int flag = 0;
@@ -291,23 +1068,26 @@ namespace vlaser {
     if(gaddr / local_block_num != my_id) {
       /* if the block does not belong to this node, ack as no block */
       VLASER_DEB("ack no such block "<<gaddr);
-      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, send_buf, 0);
+      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, sb.send_buf, 0);
       return;
     }
-    dir_mutex.lock();
-    if(local_dir[laddr].holders.size() > 2) {
+    DirMutex(laddr).lock();
+    /* in the sectored coherence the owner of an exclusive block may have
+     * other holders, UpdateDirectory() shares it
+     */
+    if(local_dir->Count(laddr) > 2 && !(sectored && local_dir->GetStatus(laddr) == DIR_EXCLUSIVE)) {
       /* the block has more than two holders but is not being tagged as shared in directory is impossible */
-      if(local_dir[laddr].status != DIR_SHARED)
+      if(local_dir->GetStatus(laddr) != DIR_SHARED)
         throw cpl_logic_error("local storage directory entry is broken: from cpl::CopeOneReq()");
 
-      cache_mutex.lock();
-      pbuf = plocal_cache->AccessBlock(gaddr, 0);
-      if(pbuf != NULL && plocal_cache->IsIntegrity(gaddr)) { /* if cache hits, ack the block to source node by using local cache directly */
+      cmutex.lock();
+      pbuf = pcache->AccessBlock(gaddr, 0);
+      if(pbuf != NULL && pcache->IsIntegrity(gaddr)) { /* if cache hits, ack the block to source node by using local cache directly */
         VLASER_DEB("ack the block from local cache");
-        pmessage_passing->AckSend(source, TAG_ACK_BLOCK_SHARED, pbuf, block_size);
+        AckBlock(sb, source, TAG_ACK_BLOCK_SHARED, pbuf, laddr);
         flag = 1;
       }
-      cache_mutex.unlock();
+      cmutex.unlock();
       if(!flag) { 
         /* if cache misses, give souce node an advice
          * about which remote nodes may be holding the block
@@ -316,12 +1096,15 @@ namespace vlaser {
          * slower local storage.
          */
         VLASER_DEB("ack a advice cache holder list");
-        i = AdviseCacheHolder(laddr, send_buf);
-        pmessage_passing->AckSend(source, TAG_ACK_ASK_OTHER, send_buf, i); /* use the message tag TAG_ACK_ASK_OTHER */
+        i = AdviseCacheHolder(sb, laddr, sb.send_buf);
+        /* the holders' copies are of the current version, a shared block keeps its version */
+        PackAddr(block_version[laddr], sb.send_buf + i);
+        i += sizeof(vsaddr);
+        pmessage_passing->AckSend(source, TAG_ACK_ASK_OTHER, sb.send_buf, i); /* use the message tag TAG_ACK_ASK_OTHER */
       }
 
-      UpdateDirectory(gaddr, laddr, DIR_SHARED, source);
-      dir_mutex.unlock();
+      UpdateDirectory(sb, gaddr, laddr, DIR_SHARED, source);
+      DirMutex(laddr).unlock();
       return;
     }
     
@@ -330,134 +1113,220 @@ namespace vlaser {
      * just unlock the local directory and run the
      * TAG_REQ_BLOCK_THIS_NODE's response sequence
      */
-    dir_mutex.unlock();
-    Resp_req_block_this_node(source, gaddr, laddr);
+    DirMutex(laddr).unlock();
+    Resp_req_block_this_node(sb, source, gaddr, laddr);
     return;
   }
 
   void
-  cpl::Resp_req_cached_block(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_req_cached_block(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr /* laddr */)
   {
+    vscache* pcache = CacheOf(gaddr);
+    vlamutex& cmutex = CacheMutex(gaddr);
     vsbyte* pbuf = NULL;
 
-    cache_mutex.lock();
+    cmutex.lock();
     /* search it in local cache */
-    pbuf = plocal_cache->AccessBlock(gaddr, 0);
-    if(pbuf != NULL && plocal_cache->IsIntegrity(gaddr))  {
+    pbuf = pcache->AccessBlock(gaddr, 0);
+    if(pbuf != NULL && pcache->IsIntegrity(gaddr))  {
       VLASER_DEB("ack the cached block "<<gaddr<<" from non-owner node");
       pmessage_passing->AckSend(source, TAG_ACK_BLOCK_SHARED, pbuf, block_size);
     }
     else {
       VLASER_DEB("ack no such cached block "<<gaddr<<" from non-owner node");
-      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, send_buf, 0);
+      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, sb.send_buf, 0);
     }
-    cache_mutex.unlock();
+    cmutex.unlock();
     return;
   }
 
   void
-  cpl::Resp_req_block_this_node(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_req_block_this_node(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
   {
-    vsbyte* pbuf = NULL;
-    int i, tag, flag = 0;
+    int i;
 
     if(gaddr / local_block_num != my_id) {
       VLASER_DEB("ack no such block "<<gaddr);
-      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, send_buf, 0);
+      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, sb.send_buf, 0);
       return;
     }
-    dir_mutex.lock();
+    DirMutex(laddr).lock();
     /*
      * update the block as shared in local storage directory
      */
     VLASER_DEB("will force to ack the block "<<gaddr<<" from this node");
-    i = UpdateDirectory(gaddr, laddr, DIR_SHARED, source);
-    if(i == -1) {
-      VLASER_DEB("update block "<<gaddr<<"'s dir fail, now tell node "<<source<<" retry");
-      pmessage_passing->AckSend(source, TAG_ACK_RETRY, send_buf, 0);
-      dir_mutex.unlock();
-      return;
-    }
-    if(i == DIR_SHARED)
+    i = UpdateDirectory(sb, gaddr, laddr, DIR_SHARED, source);
+    AckHomeBlock(sb, source, gaddr, laddr, i);
+    DirMutex(laddr).unlock();
+    return;
+  }
+
+  void
+  cpl::AckHomeBlock(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr, int st)
+  {
+    vscache* pcache = CacheOf(gaddr);
+    vlamutex& cmutex = CacheMutex(gaddr);
+    vsbyte* pbuf = NULL;
+    int tag, flag = 0;
+
+    if(st == DIR_SHARED)
       tag = TAG_ACK_BLOCK_SHARED;
     else
       tag = TAG_ACK_BLOCK_EXCLUSIVE;
     if(tag == TAG_ACK_BLOCK_SHARED) {
       /* if block is being held by several nodes, it may be cached in local cache */
-      cache_mutex.lock();
-      pbuf = plocal_cache->AccessBlock(gaddr, 0);
-      if(pbuf != NULL && plocal_cache->IsIntegrity(gaddr)) {
+      cmutex.lock();
+      pbuf = pcache->AccessBlock(gaddr, 0);
+      if(pbuf != NULL && pcache->IsIntegrity(gaddr)) {
         VLASER_DEB("ack the block from local cache");
-        pmessage_passing->AckSend(source, tag, pbuf, block_size);
+        AckBlock(sb, source, tag, pbuf, laddr);
         flag = 1;
       }
-      cache_mutex.unlock();
+      cmutex.unlock();
     }
     if(!flag) { /* if local cache misses */
       /* read the block from local storage */
-      storage_mutex.lock();
-      plocal_storage->RdBlock(laddr, send_buf);
-      storage_mutex.unlock();
       VLASER_DEB("ack the block "<<gaddr);
-      pmessage_passing->AckSend(source, tag, send_buf, block_size);
+      AckStorageBlock(sb, source, tag, laddr);
+    }
+    return;
+  }
+
+  void
+  cpl::AckBlock(ServiceBuffers& sb, vsnodeid source, int tag, vsbyte* data, vsaddr localaddr)
+  {
+    if(data != sb.send_buf)
+      memcpy(sb.send_buf, data, block_size);
+    PackAddr(block_version[localaddr], sb.send_buf + block_size);
+    pmessage_passing->AckSend(source, tag, sb.send_buf, block_size + sizeof(vsaddr));
+    return;
+  }
+
+  void
+  cpl::AckSectors(ServiceBuffers& sb, vsnodeid source, vsbyte* data, unsigned long long mask, vsaddr localaddr)
+  {
+    int len;
+
+    len = PackSectors(data, mask, sb.send_buf);
+    PackAddr(block_version[localaddr], sb.send_buf + len);
+    pmessage_passing->AckSend(source, TAG_ACK_BLOCK_EXCLUSIVE, sb.send_buf, len + sizeof(vsaddr));
+    return;
+  }
+
+  void
+  cpl::AckStorageBlock(ServiceBuffers& sb, vsnodeid source, int tag, vsaddr localaddr)
+  {
+    vsbyte* pbuf;
+
+    if((pbuf = plocal_storage->BlockPointer(localaddr)) == NULL) {
+      ReadStorage(localaddr, sb.send_buf);
+      pbuf = sb.send_buf;
     }
-    dir_mutex.unlock();
+    AckBlock(sb, source, tag, pbuf, localaddr);
     return;
   }
 
   void
-  cpl::Resp_req_block_exclusive(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_req_block_version(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
   {
+    vsaddr version;
     int i;
 
     if(gaddr / local_block_num != my_id) {
       VLASER_DEB("ack no such block "<<gaddr);
-      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, send_buf, 0);
+      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, sb.send_buf, 0);
       return;
     }
-    dir_mutex.lock();
-    /* update the local storage directory as exclusive */
-    VLASER_DEB("updating directory");
-    i = UpdateDirectory(gaddr, laddr, DIR_EXCLUSIVE, source);
-    if(i == -1) {
-      VLASER_DEB("update block "<<gaddr<<"'s dir fail, now tell node "<<source<<" retry");
-      pmessage_passing->AckSend(source, TAG_ACK_RETRY, send_buf, 0);
-      dir_mutex.unlock();
+    UnpackAddr(sb.recv_buf + sizeof(vsaddr), version);
+    DirMutex(laddr).lock();
+    i = UpdateDirectory(sb, gaddr, laddr, DIR_SHARED, source);
+    if(version == block_version[laddr]) {
+      /* nobody has been given the block as exclusive since the source read
+       * this version, so the source's copy is the data in local storage
+       */
+      VLASER_DEB("ack the version of block "<<gaddr<<" is current");
+      PackAddr(i, sb.send_buf);
+      pmessage_passing->AckSend(source, TAG_ACK_VERSION_VALID, sb.send_buf, sizeof(vsaddr));
+    }
+    else {
+      /* do not advise the holders, the source is waiting for this node only */
+      VLASER_DEB("the version of block "<<gaddr<<" is out of date");
+      AckHomeBlock(sb, source, gaddr, laddr, i);
+    }
+    DirMutex(laddr).unlock();
+    return;
+  }
+
+  void
+  cpl::Resp_req_block_exclusive(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  {
+    unsigned long long want = ~0ULL, ship = ~0ULL;
+    vsbyte* pbuf;
+    int early;
+    void* tag;
+
+    if(gaddr / local_block_num != my_id) {
+      VLASER_DEB("ack no such block "<<gaddr);
+      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, sb.send_buf, 0);
       return;
     }
+    if(sectored) {
+      /* the sectors wanted, and the ones of them to be shipped */
+      UnpackMask(sb.recv_buf + sizeof(vsaddr), want);
+      UnpackMask(sb.recv_buf + sizeof(vsaddr) + DIRTY_MASK_SIZE, ship);
+    }
+    DirMutex(laddr).lock();
+    /* a shared or noncached block is current in the local storage, and
+     * UpdateDirectory() does not write it, so read it while the holders
+     * are being invalidated. a mapped storage is not read at all
+     */
+    early = ship != 0 && plocal_storage->ConcurrentRead() && plocal_storage->BlockPointer(laddr) == NULL
+      && local_dir->GetStatus(laddr) != DIR_EXCLUSIVE;
+    if(early) {
+      sb.io_queue->RdBlockAsync(laddr, sb.io_buf, NULL);
+      sb.io_queue->Submit();
+    }
+    /* update the local storage directory as exclusive */
+    VLASER_DEB("updating directory");
+    UpdateDirectory(sb, gaddr, laddr, DIR_EXCLUSIVE, source, want);
 
-    storage_mutex.lock();
-    plocal_storage->RdBlock(laddr, send_buf);
-    storage_mutex.unlock();
     VLASER_DEB("ack block as exclusive");
-    pmessage_passing->AckSend(source, TAG_ACK_BLOCK_EXCLUSIVE, send_buf, block_size);
-    dir_mutex.unlock();
+    if(sectored) {
+      pbuf = sb.io_buf;
+      if(early)
+        sb.io_queue->Complete(tag);
+      else if(ship != 0 && (pbuf = plocal_storage->BlockPointer(laddr)) == NULL) {
+        ReadStorage(laddr, sb.io_buf);
+        pbuf = sb.io_buf;
+      }
+      AckSectors(sb, source, pbuf, ship, laddr);
+    }
+    else if(early) {
+      sb.io_queue->Complete(tag);
+      std::swap(sb.send_buf, sb.io_buf);
+      AckBlock(sb, source, TAG_ACK_BLOCK_EXCLUSIVE, sb.send_buf, laddr);
+    }
+    else
+      AckStorageBlock(sb, source, TAG_ACK_BLOCK_EXCLUSIVE, laddr);
+    DirMutex(laddr).unlock();
     return;
   }
 
   void
-  cpl::Resp_req_exclusive(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_req_exclusive(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
   {
-    int i;
-
     if(gaddr / local_block_num != my_id) {
       VLASER_DEB("ack no such block "<<gaddr);
-      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, send_buf, 0);
+      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, sb.send_buf, 0);
       return;
     }
-    dir_mutex.lock();
-    if(local_dir[laddr].holders.find(source) != local_dir[laddr].holders.end()) {
+    DirMutex(laddr).lock();
+    if(local_dir->Has(laddr, source)) {
       /* if the source node is a holder, set it as exclusive */
       VLASER_DEB("update directory");
-      i = UpdateDirectory(gaddr, laddr, DIR_EXCLUSIVE, source);
-      if(i == -1) {
-        VLASER_DEB("update block "<<gaddr<<"'s dir fail, now tell node "<<source<<" retry");
-        pmessage_passing->AckSend(source, TAG_ACK_RETRY, send_buf, 0);
-        dir_mutex.unlock();
-        return;
-      }
+      UpdateDirectory(sb, gaddr, laddr, DIR_EXCLUSIVE, source);
       VLASER_DEB("ack confirm");
-      pmessage_passing->AckSend(source, TAG_ACK_CONFIRM, send_buf, 0); /* ack confirm*/
+      pmessage_passing->AckSend(source, TAG_ACK_CONFIRM, sb.send_buf, 0); /* ack confirm*/
     }
     else {
       /* if source node is not in the holder list, it indicates that this
@@ -465,33 +1334,41 @@ namespace vlaser {
        * before this request being answered. tell the source the failure.
        */
       VLASER_DEB("ack overdue request");
-      pmessage_passing->AckSend(source, TAG_ACK_NOT_HOLDER, send_buf, 0);
+      pmessage_passing->AckSend(source, TAG_ACK_NOT_HOLDER, sb.send_buf, 0);
     }
-    dir_mutex.unlock();
+    DirMutex(laddr).unlock();
     return;
   }
 
   void
-  cpl::Resp_req_writeback(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_req_writeback(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
   {
     if(gaddr / local_block_num != my_id) {
       VLASER_DEB("ack no such block "<<gaddr);
-      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, send_buf, 0);
+      pmessage_passing->AckSend(source, TAG_ACK_NOBLOCK, sb.send_buf, 0);
       return;
     }
-    dir_mutex.lock();
-    if(local_dir[laddr].holders.find(source) != local_dir[laddr].holders.end()) {
-      if(local_dir[laddr].status == DIR_EXCLUSIVE) {
-        /* empty the holder list, and tag the block as uncached */
-        VLASER_DEB("clean the holder list of block "<<gaddr);
-        local_dir[laddr].status = DIR_NONCACHED;
-        local_dir[laddr].holders.clear();
-        storage_mutex.lock();
-        /* write back to local storage */
-        VLASER_DEB("write back block "<<gaddr);
-        plocal_storage->WrBlock(laddr, (recv_buf + sizeof(vsaddr)));
-        storage_mutex.unlock();
-        }
+    DirMutex(laddr).lock();
+    AcceptWriteBack(source, laddr, sb.recv_buf + sizeof(vsaddr));
+    VLASER_DEB("ack confirm");
+    pmessage_passing->AckSend(source, TAG_ACK_CONFIRM, sb.send_buf, 0); /* ack confirm in all condition */
+    DirMutex(laddr).unlock();
+    return;
+  }
+
+  int
+  cpl::AcceptWriteBack(vsnodeid source, vsaddr laddr, vsbyte* data)
+  {
+    if(IsOwner(laddr, source)) {
+      /* drop the owner from the holder list, and tag the block as uncached */
+      VLASER_DEB("clean the holder list of block "<<laddr);
+      DropOwner(laddr);
+      storage_mutex.lock();
+      /* write back to local storage */
+      VLASER_DEB("write back block "<<laddr);
+      WriteDirty(laddr, data);
+      storage_mutex.unlock();
+      return 1;
     }
     /* if source node id is not in the holder list, or it is in holder list but 
      * the block status is not DIR_EXCLUSIVE, this indicates that
@@ -499,71 +1376,138 @@ namespace vlaser {
      * answered a TAG_SET_INVALID or TAG_SET_SHARED request before sending the
      * write back message, just neglect this writeback request.
      */
-    VLASER_DEB("ack confirm");
-    pmessage_passing->AckSend(source, TAG_ACK_CONFIRM, send_buf, 0); /* ack confirm in all condition */
-    dir_mutex.unlock();
+    return 0;
+  }
+
+  void
+  cpl::Resp_req_victim(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  {
+    if(gaddr / local_block_num != my_id)
+      throw cpl_logic_error("writing back a block of other node: from cpl::Resp_req_victim()");
+    DirMutex(laddr).lock();
+    AcceptWriteBack(source, laddr, sb.recv_buf + sizeof(vsaddr));
+    /* answered as a request, so the source need not wait it on the ACK channel */
+    PackAddr(gaddr, sb.send_buf);
+    pmessage_passing->ReqSend(source, TAG_VICTIM_DONE, sb.send_buf, sizeof(vsaddr));
+    DirMutex(laddr).unlock();
+    return;
+  }
+
+  void
+  cpl::Resp_victim_done(ServiceBuffers& /* sb */, vsnodeid source, vsaddr gaddr, vsaddr /* laddr */)
+  {
+    vlamutex& cmutex = CacheMutex(gaddr);
+    VictimBlock* v;
+
+    cmutex.lock();
+    if((v = FindVictim(gaddr)) == NULL)
+      throw cpl_logic_error("got TAG_VICTIM_DONE of a block not in victim buffer: from cpl::Resp_victim_done()");
+    VLASER_DEB("victim "<<gaddr<<" written back by node "<<source);
+    v->busy = 0;
+    writeback_cond[gaddr % cache_shard_num]->broadcast();
+    cmutex.unlock();
+    EndIO();
     return;
   }
 
   void
-  cpl::Resp_set_invalid(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_set_invalid(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr /* laddr */)
   {
+    vscache* pcache = CacheOf(gaddr);
+    vlamutex& cmutex = CacheMutex(gaddr);
     vsbyte* pbuf = NULL;
     vscache::BlockStatus cst;
-
-    cache_mutex.lock();
-    if(plocal_cache->IsCached(gaddr, cst)) { /* if local cache hits */
+    VictimBlock* v;
+    unsigned long long want = ~0ULL, kept;
+    int len;
+
+    if(sectored)
+      UnpackMask(sb.recv_buf + sizeof(vsaddr), want);
+    cmutex.lock();
+    if(pcache->IsCached(gaddr, cst)) { /* if local cache hits */
+      if(cst == SHARED && want != ~0ULL && (kept = pcache->GetValidSectors(gaddr) & ~want) != 0) {
+        /* a shared copy drops the sectors wanted only */
+        VLASER_DEB("keep sectors "<<kept<<" of block "<<gaddr);
+        pcache->SetValidSectors(gaddr, kept);
+        pmessage_passing->SerSend(source, TAG_SER_SET_KEPT, sb.send_buf, 0);
+        cmutex.unlock();
+        return;
+      }
       if(cst == MODIFIED) {/* if it is a dirty cache block, write it back */
         VLASER_DEB("ack write back block "<<gaddr<<" first");
-        pbuf = plocal_cache->AccessBlock(gaddr, 0);
-        pmessage_passing->SerSend(source, TAG_SER_SET_WRITEBACK, pbuf, block_size);
-        plocal_cache->SetBlockStatus(gaddr, INVALID);
-        cache_mutex.unlock();
+        pbuf = pcache->AccessBlock(gaddr, 0);
+        len = PackDirty(pcache, gaddr, pbuf, sb.send_buf);
+        pmessage_passing->SerSend(source, TAG_SER_SET_WRITEBACK, sb.send_buf, len);
+        pcache->SetBlockStatus(gaddr, INVALID);
+        cmutex.unlock();
         return;
       }
       VLASER_DEB("set block "<<gaddr<<" invalid");
-      plocal_cache->SetBlockStatus(gaddr, INVALID);
+      pcache->SetBlockStatus(gaddr, INVALID);
+    }
+    else if((v = FindVictim(gaddr)) != NULL && v->dirty) {
+      /* evicted but its TAG_REQ_VICTIM is not done, the home neglects that one */
+      VLASER_DEB("ack write back victim "<<gaddr);
+      pmessage_passing->SerSend(source, TAG_SER_SET_WRITEBACK, v->mes + sizeof(vsaddr), v->len - sizeof(vsaddr));
+      v->dirty = 0;
+      cmutex.unlock();
+      return;
     }
 
     VLASER_DEB("ack set confirm without writing back");
-    pmessage_passing->SerSend(source, TAG_SER_SET_CONFIRM, send_buf, 0);
-    cache_mutex.unlock();
+    pmessage_passing->SerSend(source, TAG_SER_SET_CONFIRM, sb.send_buf, 0);
+    cmutex.unlock();
     return;
   }
 
   void
-  cpl::Resp_set_shared(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_set_shared(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr /* laddr */)
   {
+    vscache* pcache = CacheOf(gaddr);
+    vlamutex& cmutex = CacheMutex(gaddr);
     vsbyte* pbuf = NULL;
     vscache::BlockStatus cst;
+    VictimBlock* v;
+    int len;
 
-    cache_mutex.lock();
-    if(plocal_cache->IsCached(gaddr, cst)) { /* if local cache hits */
+    cmutex.lock();
+    if(pcache->IsCached(gaddr, cst)) { /* if local cache hits */
       /* !!! Sharing a shared cache block is not a logic error.
       if(cst == SHARED)
         throw cpl_logic_error("sharing a shared cache block: from cpl::Resp_set_shared()");
        */
       if(cst == MODIFIED){ /* if modified, write back */
         VLASER_DEB("ack write back block "<<gaddr);
-        pbuf = plocal_cache->AccessBlock(gaddr, 0);
-        pmessage_passing->SerSend(source, TAG_SER_SET_WRITEBACK, pbuf, block_size);
+        pbuf = pcache->AccessBlock(gaddr, 0);
+        len = PackDirty(pcache, gaddr, pbuf, sb.send_buf);
+        pmessage_passing->SerSend(source, TAG_SER_SET_WRITEBACK, sb.send_buf, len);
         VLASER_DEB("set block "<<gaddr<<" shared");
-        plocal_cache->SetBlockStatus(gaddr, SHARED); /* set it as shared */
-        cache_mutex.unlock();
+        pcache->SetBlockStatus(gaddr, SHARED); /* set it as shared */
+        cmutex.unlock();
         return;
       }
       VLASER_DEB("set block "<<gaddr<<" shared");
-      plocal_cache->SetBlockStatus(gaddr, SHARED);
+      pcache->SetBlockStatus(gaddr, SHARED);
+    }
+    else if((v = FindVictim(gaddr)) != NULL && v->dirty) {
+      /* this node is left in the holder list without the block, as after
+       * replacing a clean block
+       */
+      VLASER_DEB("ack write back victim "<<gaddr);
+      pmessage_passing->SerSend(source, TAG_SER_SET_WRITEBACK, v->mes + sizeof(vsaddr), v->len - sizeof(vsaddr));
+      v->dirty = 0;
+      cmutex.unlock();
+      return;
     }
 
     VLASER_DEB("ack set confirm without writing back");
-    pmessage_passing->SerSend(source, TAG_SER_SET_CONFIRM, send_buf, 0);
-    cache_mutex.unlock();
+    pmessage_passing->SerSend(source, TAG_SER_SET_CONFIRM, sb.send_buf, 0);
+    cmutex.unlock();
     return;  
   }
 
   void
-  cpl::Resp_shutdown(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_shutdown(ServiceBuffers& /* sb */, vsnodeid /* source */, vsaddr /* gaddr */, vsaddr /* laddr */)
   {
 
     if((my_id == 0) && (finish_signal == 0)) {
@@ -575,7 +1519,7 @@ namespace vlaser {
   }
 
   void
-  cpl::Resp_finish(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_finish(ServiceBuffers& /* sb */, vsnodeid /* source */, vsaddr gaddr, vsaddr /* laddr */)
   {
     ++finish_signal;
     VLASER_DEB("finish signal grows to "<<finish_signal);
@@ -587,42 +1531,52 @@ namespace vlaser {
   }
 
   void
-  cpl::Resp_self_req_block(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_req_clean(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr laddr)
   {
-    int i, tag;
-
-    dir_mutex.lock();
-    VLASER_DEB("self request block "<<gaddr<<" from local node");
-    i = UpdateDirectory(gaddr, laddr, DIR_SHARED, source);
-    if(i == DIR_SHARED)
-      tag = TAG_ACK_BLOCK_SHARED;
-    else
-      tag = TAG_ACK_BLOCK_EXCLUSIVE;
-    if(i == -1) {
-      VLASER_DEB("update block "<<gaddr<<"'s dir fail, now tell node "<<source<<" retry");
-      tag = TAG_ACK_RETRY;
+    vsaddr written = 0;
+
+    if(gaddr / local_block_num != my_id)
+      throw cpl_logic_error("cleaning a block of other node: from cpl::Resp_req_clean()");
+    DirMutex(laddr).lock();
+    /* unlike TAG_REQ_WRITEBACK the source keeps the block, so the
+     * directory is not changed. if the source is not the exclusive
+     * holder any more, it has written the block back when answering
+     * TAG_SET_INVALID or TAG_SET_SHARED, neglect this request
+     */
+    if(IsOwner(laddr, source)) {
+      VLASER_DEB("clean block "<<gaddr<<" for node "<<source);
+      storage_mutex.lock();
+      WriteDirty(laddr, sb.recv_buf + sizeof(vsaddr));
+      storage_mutex.unlock();
+      written = 1;
     }
-    pmessage_passing->AckSend(source, tag, send_buf, 0);
-    dir_mutex.unlock();
+    PackAddr(gaddr, sb.send_buf);
+    PackAddr(written, sb.send_buf + sizeof(vsaddr));
+    pmessage_passing->ReqSend(source, TAG_CLEAN_DONE, sb.send_buf, 2 * sizeof(vsaddr));
+    DirMutex(laddr).unlock();
     return;
   }
 
   void
-  cpl::Resp_self_req_block_exclusive(vsnodeid source, vsaddr gaddr, vsaddr laddr)
+  cpl::Resp_clean_done(ServiceBuffers& sb, vsnodeid source, vsaddr gaddr, vsaddr /* laddr */)
   {
-    int i;
-
-    dir_mutex.lock();
-    VLASER_DEB("self request block "<<gaddr<<" exclusive from local node");
-    i = UpdateDirectory(gaddr, laddr, DIR_EXCLUSIVE, source);
-    if(i == -1) {
-      VLASER_DEB("update block "<<gaddr<<"'s dir fail, now tell node "<<source<<" retry");
-      pmessage_passing->AckSend(source, TAG_ACK_RETRY, send_buf, 0);
-      dir_mutex.unlock();
-      return;
-    }
-    pmessage_passing->AckSend(source, TAG_ACK_BLOCK_EXCLUSIVE, send_buf, 0);
-    dir_mutex.unlock();
+    vscache* pcache = CacheOf(gaddr);
+    vlamutex& cmutex = CacheMutex(gaddr);
+    std::vector<vsaddr>& list = cleaning[gaddr % cache_shard_num];
+    std::vector<vsaddr>::iterator it;
+    vsaddr written;
+
+    UnpackAddr(sb.recv_buf + sizeof(vsaddr), written);
+    cmutex.lock();
+    /* the block is EXCLUSIVE now, unless it has been written or set since the cleaning began */
+    if(pcache->EndClean(gaddr, written))
+      __sync_fetch_and_add(&cleaned_num, 1);
+    VLASER_DEB("block "<<gaddr<<" cleaned by node "<<source<<", written "<<written);
+    if((it = std::find(list.begin(), list.end(), gaddr)) == list.end())
+      throw cpl_logic_error("got TAG_CLEAN_DONE of a block not being cleaned: from cpl::Resp_clean_done()");
+    list.erase(it);
+    writeback_cond[gaddr % cache_shard_num]->broadcast();
+    cmutex.unlock();
     return;
   }
 
@@ -638,34 +1592,8 @@ namespace vlaser {
     srandom(s);
   }
 
-  inline void
-  cpl::Backoff()
-  {
-    unsigned int t;
-
-    /* the binary exponential backoff */
-    if(backoff_counter != 0) {
-      t = 1 << backoff_counter - 1;
-      t = random() % t;
-      VLASER_DEB("backoff for "<<t * BACKOFF_INTERVAL_UNIT<<" microsecond");
-      usleep(t * BACKOFF_INTERVAL_UNIT);
-      if(backoff_counter < BACKOFF_COUNTER_MAX) {
-        ++backoff_counter;
-      }
-    }
-    else
-      ++backoff_counter;
-    return;
-  }
-
-  inline void
-  cpl::CleanBackoffCounter()
-  {
-    backoff_counter = 0;
-    return;
-  }
-
-  cpl::cpl(BlockSize bsize, vsaddr csize, vsaddr lvolume, vsnodeid thisid, vsnodeid nm, mpal* pmp, lsal* pls) :
+  cpl::cpl(BlockSize bsize, vsaddr csize, vsaddr lvolume, vsnodeid thisid, vsnodeid nm, mpal* pmp, lsal* pls, int wnum,
+    ReplacementPolicy policy) :
   block_size(bsize),
   cache_block_num(csize),
   local_block_num(lvolume),
@@ -674,20 +1602,68 @@ namespace vlaser {
   plocal_storage(pls),
   pmessage_passing(pmp),
   cache_holder_advice_num(4),
-  message_buf_size(bsize + sizeof(vsaddr)) /* largest size of message is block size + one VLASER global address' size */
+  worker_num((wnum > 0) ? wnum : 1),
+  message_buf_size(bsize + sizeof(vsaddr) + DIRTY_MASK_SIZE), /* largest message is a block written back, with its address and dirty mask */
+  job_cond(job_mutex),
+  cleaner_cond(cleaner_mutex)
   {
-    plocal_cache = new vscache(bsize, csize);
+    /* blocks are dealt to the shards by global address */
+    cache_shard_num = csize / CACHE_SHARD_MIN_BLOCKS;
+    if(cache_shard_num > CACHE_SHARD_NUM)
+      cache_shard_num = CACHE_SHARD_NUM;
+    if(cache_shard_num < 1)
+      cache_shard_num = 1;
+    /* the buffers of the threads, the victims, and some for the queued requests.
+     * aligned for the local storage, so a block is read to send_buf directly
+     */
+    message_pool = new vsbufpool(message_buf_size, 3 * (worker_num + 3) + cache_shard_num * VICTIM_BUFFER_SIZE
+      + worker_num * MESSAGE_POOL_SLACK_PER_WORKER, vsarena::ARENA_HUGE_PAGES | vsarena::ARENA_NUMA_LOCAL,
+      pls->Alignment());
+    cache_shards = new vscache*[cache_shard_num];
+    for(int i = 0; i < cache_shard_num; ++i)
+      cache_shards[i] = new vscache(bsize, csize / cache_shard_num + ((vsaddr)i < csize % cache_shard_num), policy);
+    cache_mutex = new vlamutex[cache_shard_num];
+    cleaning = new std::vector<vsaddr>[cache_shard_num];
+    writeback_cond = new vlacond*[cache_shard_num];
+    for(int i = 0; i < cache_shard_num; ++i)
+      writeback_cond[i] = new vlacond(cache_mutex[i]);
+    victims = new VictimBlock[cache_shard_num * VICTIM_BUFFER_SIZE];
+    for(int i = 0; i < cache_shard_num * VICTIM_BUFFER_SIZE; ++i) {
+      victims[i].busy = 0;
+      victims[i].dirty = 0;
+      victims[i].mes = message_pool->Get();
+    }
 
-    local_dir = new StorageDirectory[lvolume];
-    for(int i = 0; i < lvolume; ++i)
-      local_dir[i].status = DIR_NONCACHED; /* initialize all directory entries as noncached */
-    send_buf = new vsbyte[message_buf_size];
-    recv_buf = new vsbyte[message_buf_size];
-    message_buf = new vsbyte[message_buf_size];
+    local_dir = new vsdirectory(lvolume, nm);
+    for(vsaddr i = 0; i < lvolume; ++i)
+      local_dir->SetStatus(i, DIR_NONCACHED); /* initialize all directory entries as noncached */
+    block_version = new vsaddr[lvolume];
+    memset(block_version, 0, sizeof(vsaddr) * lvolume);
+    message_buf = message_pool->Get();
+    NewServiceBuffers(service_bufs);
+    NewServiceBuffers(self_bufs);
+    dir_mutex_num = worker_num * DIR_LOCKS_PER_WORKER;
+    dir_mutex = new vlamutex[dir_mutex_num];
+    ser_mutex = new vlamutex[nm];
+    workers = new ServiceWorker[worker_num];
+    for(int i = 0; i < worker_num; ++i)
+      NewServiceBuffers(workers[i].bufs);
     vsaddr_tag_only_buf = new vsbyte[sizeof(vsaddr)];
     finish_signal = 0;
     is_message_service_ready = 0;
     io_busy = 0;
+    io_waiting = 0;
+    clean_high = CLEANER_HIGH_WATERMARK;
+    clean_low = CLEANER_LOW_WATERMARK;
+    clean_buf = message_pool->Get();
+    cleaner_stop = 0;
+    cleaned_num = 0;
+    pdisk_cache = NULL;
+    disk_buf = NULL;
+    disk_hits = 0;
+    disk_stales = 0;
+    sectored = 0;
+    dir_owner = NULL;
   }
 
   cpl::~cpl()
@@ -695,12 +1671,34 @@ namespace vlaser {
     /*
      * class cpl owns local cache and local storage directory, free them.
      */
-    delete plocal_cache;
-    delete[] local_dir;
-    delete[] send_buf;
-    delete[] recv_buf;
-    delete[] message_buf;
+    for(int i = 0; i < cache_shard_num; ++i)
+      delete cache_shards[i];
+    delete[] cache_shards;
+    for(int i = 0; i < cache_shard_num; ++i)
+      delete writeback_cond[i];
+    delete[] writeback_cond;
+    for(int i = 0; i < cache_shard_num * VICTIM_BUFFER_SIZE; ++i)
+      message_pool->Put(victims[i].mes);
+    delete[] victims;
+    delete[] cleaning;
+    delete[] cache_mutex;
+    delete local_dir;
+    delete[] block_version;
+    delete[] dir_owner;
+    delete pdisk_cache;
+    if(disk_buf != NULL)
+      message_pool->Put(disk_buf);
+    message_pool->Put(message_buf);
+    FreeServiceBuffers(service_bufs);
+    FreeServiceBuffers(self_bufs);
+    for(int i = 0; i < worker_num; ++i)
+      FreeServiceBuffers(workers[i].bufs);
+    delete[] workers;
+    delete[] dir_mutex;
+    delete[] ser_mutex;
     delete[] vsaddr_tag_only_buf;
+    message_pool->Put(clean_buf);
+    delete message_pool;
   }
 
   void
@@ -709,8 +1707,11 @@ namespace vlaser {
     vsaddr gaddr;
     vsbyte* pbuf;
     vsbyte* ptmp;
+    void* ptag;
     vsnodeid nextid, tmpid;
-    int tag;
+    int tag, len;
+    vscache::Statistics cst;
+    std::vector<vsaddr> dirty, part;
 
     VLASER_DEB("enter MessageServiceThread()");
     VLASER_DEB("make the request response methods table");
@@ -725,8 +1726,12 @@ namespace vlaser {
 
       VLASER_DEB("initialize local storage");
       plocal_storage->Initialize();
+      VLASER_DEB("start service workers");
+      StartWorkers();
       VLASER_DEB("message service is ready");
       is_message_service_ready = 1;
+      if(clean_high > 0)
+        StartCleaner();
 
       /* wait and handle every request until TAG_FINISH message arrives,
        * once TAG_FINISH message arrives, finish_signal will be set to 1
@@ -742,8 +1747,8 @@ namespace vlaser {
         nextid = my_id + 1;
       /* pass on the TAG_FINISH signal to next node */
       VLASER_DEB("passing TAG_FINISH signal to node "<<nextid);
-      PackAddr(finish_signal_source, send_buf);
-      pmessage_passing->ReqSend(nextid, TAG_FINISH, send_buf, sizeof(vsaddr));
+      PackAddr(finish_signal_source, service_bufs.send_buf);
+      pmessage_passing->ReqSend(nextid, TAG_FINISH, service_bufs.send_buf, sizeof(vsaddr));
       /* continue to answer the requests, until the TAG_FINISH
        * signal arrives for the second time
        */
@@ -752,56 +1757,105 @@ namespace vlaser {
       /* once gets the TAG_FINISH message second time,
        * it indicates that all nodes will no longer accept new
        * reading/writing requests.
-       * however, here may still have unfinished requests in main thread.
-       * so, wait the io_busy changing to 0.
+       * however, here may still have unfinished requests in main thread,
+       * and they may need this node's answers. so keep answering the
+       * requests until io_busy changes to 0, EndIO() sends a request
+       * to this node to wake the service thread up.
+       */
+      while(1) {
+        io_waiting = 1;
+        __sync_synchronize();
+        if(!io_busy)
+          break;
+        CopeWithOneReq();
+      }
+      io_waiting = 0;
+      /* the cleaner does not begin any more, and all its blocks are done */
+      if(clean_high > 0)
+        StopCleaner();
+      /* pass on the TAG_FINISH signal second time, when it comes back
+       * to the source node, no node has unfinished requests
        */
-      while(io_busy)
-        usleep(BACKOFF_INTERVAL_UNIT);
-      dir_mutex.lock();
-      cache_mutex.lock();
+      VLASER_DEB("passing TAG_FINISH signal second time to node "<<nextid);
+      pmessage_passing->ReqSend(nextid, TAG_FINISH, service_bufs.send_buf, 0);
+      while(finish_signal < 3)
+        CopeWithOneReq();
+      GetCacheStatistics(cst);
+      std::cout<<"|STD| Node "<<my_id<<" cache "<<cache_shards[0]->PolicyName()<<" : "<<cst.hits<<" hits, "<<cst.misses
+        <<" misses, hit ratio "<<((cst.hits + cst.misses) ? (double)cst.hits / (cst.hits + cst.misses) : 0.0)
+        <<", "<<cst.evictions<<" evictions, "<<cst.dirty_evictions<<" dirty, "<<cleaned_num<<" cleaned ahead."<<std::endl;
+      if(pdisk_cache != NULL)
+        std::cout<<"|STD| Node "<<my_id<<" disk cache : "<<disk_hits<<" hits, "<<disk_stales<<" out of date."<<std::endl;
+      /* the cache cleaning sequence runs one node at a time */
+      for(int i = 0; i < dir_mutex_num; ++i)
+        dir_mutex[i].lock();
+      for(int i = 0; i < cache_shard_num; ++i)
+        cache_mutex[i].lock();
       storage_mutex.lock();
-      /* write back all modified cache block */
+      /* write back all modified cache block, in address order */
       VLASER_DEB("begin local cache cleaning sequence");
-      while(plocal_cache->CleanCache(gaddr, &pbuf)) {
-        VLASER_DEB("write back cache block "<<gaddr);
-        tmpid = gaddr / local_block_num;
-        if(tmpid == my_id) 
-          /* if it's a local block, just write back to local storage,
-           * as no node will acquire any new cache block, so it is
-           * unnecessary to update local storage directory.
-           */
-          plocal_storage->WrBlock(gaddr % local_block_num, pbuf);
-        else {/* write back to remote node */
-          PackAddr(gaddr, send_buf);
-          ptmp = send_buf + sizeof(vsaddr);
-          memcpy(ptmp, pbuf, block_size);
-          pmessage_passing->ReqSend(tmpid, TAG_REQ_WRITEBACK, send_buf, message_buf_size);
-          pmessage_passing->WaitAck(tmpid, tag, recv_buf, message_buf_size);
+      dirty.clear();
+      for(int i = 0; i < cache_shard_num; ++i) {
+        cache_shards[i]->GetModifiedBlocks(part);
+        dirty.insert(dirty.end(), part.begin(), part.end());
+      }
+      std::sort(dirty.begin(), dirty.end());
+      for(size_t k = 0; k < dirty.size(); ++k) {
+        gaddr = dirty[k];
+        if((pbuf = CacheOf(gaddr)->CleanBlock(gaddr)) != NULL) {
+          VLASER_DEB("write back cache block "<<gaddr);
+          tmpid = gaddr / local_block_num;
+          if(tmpid == my_id) {
+            /* if it's a local block, just write back to local storage,
+             * as no node will acquire any new cache block, so it is
+             * unnecessary to update local storage directory. the
+             * writes are queued and submitted in batches, the cache
+             * data stays until they finish.
+             */
+            if(service_bufs.io_queue->Pending() == service_bufs.io_queue->depth)
+              service_bufs.io_queue->Complete(ptag);
+            service_bufs.io_queue->WrBlockAsync(gaddr % local_block_num, pbuf, NULL);
+          }
+          else {/* write back to remote node */
+            /* the queued local writes go on during the remote one */
+            service_bufs.io_queue->Submit();
+            PackAddr(gaddr, service_bufs.send_buf);
+            ptmp = service_bufs.send_buf + sizeof(vsaddr);
+            len = sizeof(vsaddr) + PackDirty(CacheOf(gaddr), gaddr, pbuf, ptmp);
+            pmessage_passing->ReqSend(tmpid, TAG_REQ_WRITEBACK, service_bufs.send_buf, len);
+            pmessage_passing->WaitAck(tmpid, tag, service_bufs.recv_buf, message_buf_size);
+          }
+          VLASER_DEB("write back cache block "<<gaddr<<" ok");
         }
-        VLASER_DEB("write back cache block "<<gaddr<<" ok");
       }
+      while(service_bufs.io_queue->Complete(ptag))
+        ;
       storage_mutex.unlock();
-      cache_mutex.unlock();
-      dir_mutex.unlock();
+      for(int i = cache_shard_num - 1; i >= 0; --i)
+        cache_mutex[i].unlock();
+      for(int i = dir_mutex_num - 1; i >= 0; --i)
+        dir_mutex[i].unlock();
       /* after cleaning local cache, pass on the TAG_FINISH signal
-       * second time to start next node's cache cleaning sequence
+       * third time to start next node's cache cleaning sequence
        */
-      VLASER_DEB("passing TAG_FINISH signal second time to node "<<nextid);
-      pmessage_passing->ReqSend(nextid, TAG_FINISH, send_buf, 0);
+      VLASER_DEB("passing TAG_FINISH signal third time to node "<<nextid);
+      pmessage_passing->ReqSend(nextid, TAG_FINISH, service_bufs.send_buf, 0);
       /* continue to answer the write back request from other nodes
-       * until the finish signal arrives for the third time
+       * until the finish signal arrives for the fourth time
        */
-      while(finish_signal < 3)
+      while(finish_signal < 4)
         CopeWithOneReq();
-      /* once the node recives finish signal for the third time,
+      /* once the node recives finish signal for the fourth time,
        * it says that all nodes' caches are clean, so pass on the
        * signal if next node is not the finish signal's source node,
        * and terminate
        */
       if(nextid != finish_signal_source) {
-        VLASER_DEB("passing TAG_FINISH signal third time to node "<<nextid);
-        pmessage_passing->ReqSend(nextid, TAG_FINISH, send_buf, 0);
+        VLASER_DEB("passing TAG_FINISH signal fourth time to node "<<nextid);
+        pmessage_passing->ReqSend(nextid, TAG_FINISH, service_bufs.send_buf, 0);
       }
+      VLASER_DEB("stop service workers");
+      StopWorkers();
     }
     /* print the all error messages here and rethrow the exceptions */
     catch(std::logic_error& except) {
@@ -818,13 +1872,39 @@ namespace vlaser {
     }
     /* finalize the message passing environment */
     is_message_service_ready = 0;
+    storage_mutex.lock();
     plocal_storage->Finalize();
+    storage_mutex.unlock();
     VLASER_DEB("local storage finialized");
     pmessage_passing->Finalize();
     VLASER_DEB("message passing environment finialized, and service thread exit");
     return;
   }
 
+  inline int
+  cpl::BeginIO()
+  {
+    __sync_fetch_and_add(&io_busy, 1);
+    /* if this node has been told to terminate, do nothing */
+    if(finish_signal || !is_message_service_ready) {
+      EndIO();
+      return 0;
+    }
+    return 1;
+  }
+
+  inline void
+  cpl::EndIO()
+  {
+    __sync_fetch_and_sub(&io_busy, 1);
+    /* wake the service thread up if it is waiting, TAG_SHUTDOWN
+     * does nothing once the shutdown sequence has started
+     */
+    if(__sync_lock_test_and_set(&io_waiting, 0))
+      pmessage_passing->ReqSend(my_id, TAG_SHUTDOWN, vsaddr_tag_only_buf, 0);
+    return;
+  }
+
   int
   cpl::Read(globaladdress gd, vsbyte* buf, int count)
   {
@@ -834,10 +1914,9 @@ namespace vlaser {
     int i;
 
     /* if this node has been told to terminate, do nothing, just return */
-    if(finish_signal || !is_message_service_ready)
+    if(!BeginIO())
       return 0;
     try{
-      io_busy = 1;
       VLASER_DEB("begin global random read()");
       endaddr = (gd + count - 1) / block_size;
       startaddr = gd / block_size;
@@ -859,7 +1938,7 @@ namespace vlaser {
         }
         ReadWithinBlock(startaddr, 0, (gd + count) % block_size, buf);
       }
-      io_busy = 0;
+      EndIO();
     }
     catch(std::logic_error& except) {
       std::cout<<"|FATAL| get logic error"<<std::endl<<except.what()<<std::endl<<"catched in cpl::Read"
@@ -878,48 +1957,79 @@ namespace vlaser {
   void
   cpl::ReadWithinBlock(vsaddr addr, int startpoint, int count, vsbyte* buf)
   {
+    /* the shard holding the block, a victim for the block is chosen in the same shard */
+    vscache* pcache = CacheOf(addr);
+    vlamutex& cmutex = CacheMutex(addr);
     vsbyte* ptmp;
     vsbyte* pmes;
     int swap_flag;
     int wb_flag;
+    int len;
     int holders_flag;
+    vsbyte* pdata;
     vsaddr i, n;
     vsaddr swap_addr;
+    vsaddr version;
     vsnodeid tmpid;
     int tag;
     vscache::BlockStatus bs;
 
     VLASER_DEB("|RD|reading "<<count<<" bytes in block "<<addr<<" start at "<<startpoint);
-    cache_mutex.lock();
+    /* try the hit without the lock first. the data of cache blocks is only
+     * written by the main thread, the service thread and workers only
+     * change the blocks' status, which TryRead() finds out
+     */
+    if(pcache->TryRead(addr, startpoint, count, buf)) {
+      VLASER_DEB("|RD|local cache hit without lock, return the data directly");
+      return;
+    }
+    cmutex.lock();
 
-    ptmp = plocal_cache->AccessBlock(addr, 1);
+    ptmp = pcache->AccessBlock(addr, 1);
+    if(sectored && ptmp != NULL && !pcache->HasSectors(addr, startpoint, count)) {
+      /* the sectored coherence left some of the sectors out, the owner
+       * gets them, a shared copy is dropped and read again whole
+       */
+      if(pcache->GetBlockStatus(addr) != SHARED) {
+        cmutex.unlock();
+        if((ptmp = SectoredRequest(addr, startpoint, count, 0)) != NULL) {
+          memcpy(buf, ptmp + startpoint, count);
+          cmutex.unlock();
+          VLASER_DEB("|RD|read block "<<addr<<" with its sectors got ok");
+          return;
+        }
+        cmutex.lock();
+      }
+      if(pcache->IsCached(addr, bs))
+        pcache->SetBlockStatus(addr, INVALID);
+      ptmp = NULL;
+    }
     if(ptmp != NULL) { /* if local cache hits */
       VLASER_DEB("|RD|local cache hit, return the data directly");
       memcpy(buf, ptmp + startpoint, count);
-      cache_mutex.unlock();
+      cmutex.unlock();
       VLASER_DEB("|RD|read block "<<addr<<" from cache ok");
       return;
     }
     /* if cache misses */
     wb_flag = 0;
     /* find a cache line to store this new block */
-    swap_flag = plocal_cache->FindReplacingBlock(swap_addr, wb_flag);
+    swap_flag = pcache->FindReplacingBlock(addr, swap_addr, wb_flag);
     if(wb_flag) {
       VLASER_DEB("|RD|write back block "<<swap_addr<<" first");
-
-      ptmp = plocal_cache->AccessBlock(swap_addr, 0);
-      /* unlock the local cache before we send the write back message
-       * to avoid deadlock
-       * notice that call pmessage_passing->ReqSend() method with holding
-       * the local cache lock will inevitably lead to deadlock. 
-       */
-      cache_mutex.unlock();
+      /* the cleaner is behind */
+      WakeCleaner();
 
       tmpid = swap_addr / local_block_num;
       if(tmpid != my_id) { /* if a remote block */
-        PackAddr(swap_addr, message_buf); 
-        pmes = message_buf + sizeof(vsaddr);
-        memcpy(pmes, ptmp, block_size);
+        /* move it to the victim buffer, and do not wait the write back */
+        pmes = PutVictim(swap_addr, len);
+        /* unlock the local cache before we send the write back message
+         * to avoid deadlock
+         * notice that call pmessage_passing->ReqSend() method with holding
+         * the local cache lock will inevitably lead to deadlock. 
+         */
+        cmutex.unlock();
         /* before we send this writeback message, the block may already been
          * writed back.
          * because we are not holding the local cache's lock, other nodes may
@@ -927,128 +2037,141 @@ namespace vlaser {
          * from them has already arrived and been answered.
          * the block's owner node will handle this correctly.
          */
-        VLASER_DEB("|RD|request writing back to node "<<tmpid);
-        pmessage_passing->ReqSend(tmpid, TAG_REQ_WRITEBACK, message_buf, message_buf_size);
-        pmessage_passing->WaitAck(tmpid, tag, message_buf, message_buf_size);
+        if(pmes != NULL) {
+          VLASER_DEB("|RD|request writing back to node "<<tmpid);
+          pmessage_passing->ReqSend(tmpid, TAG_REQ_VICTIM, pmes, len);
+        }
       }
       else { /* if the writeback block is a local storage block */
         VLASER_DEB("|RD|writing back to local storage");
+        cmutex.unlock();
 
-        dir_mutex.lock();
+        DirMutex(swap_addr % local_block_num).lock();
         /* lock the local cache again
          * notice that when using these locks, we must follow the order,
          * locking order: dir_mutex, cache_mutex, storage_mutex
          * unlocking order: storage_mutex, cache_mutex, dir_mutex
+         * the shard of swap_addr is the shard of addr
          */
-        cache_mutex.lock();
-        if((ptmp = plocal_cache->AccessBlock(swap_addr,0)) != NULL) /* if the block is still in cache */
-          if(plocal_cache->GetBlockStatus(swap_addr) == MODIFIED) { /* and if the block is modified */
+        cmutex.lock();
+        if((ptmp = pcache->AccessBlock(swap_addr,0)) != NULL) /* if the block is still in cache */
+          if(pcache->GetBlockStatus(swap_addr) == MODIFIED) { /* and if the block is modified */
             n = swap_addr % local_block_num;
-            if(local_dir[n].status != DIR_EXCLUSIVE)
+            if(local_dir->GetStatus(n) != DIR_EXCLUSIVE)
               throw cpl_logic_error("find discord between local cache and local dir when local writeback: from cpl::ReadWithinBlock()");
             storage_mutex.lock();
             /* write back to local storage */
             plocal_storage->WrBlock(n, ptmp);
             storage_mutex.unlock();
-            local_dir[n].status = DIR_NONCACHED;
-            local_dir[n].holders.clear();
+            DropOwner(n);
           }
-        cache_mutex.unlock();
-        dir_mutex.unlock();
+        cmutex.unlock();
+        DirMutex(swap_addr % local_block_num).unlock();
       }
       VLASER_DEB("|RD|write back block "<<swap_addr<<" ok");
     }
-    else
-      cache_mutex.unlock();
+    else {
+      cmutex.unlock();
+      if(swap_flag)
+        SpillVictim(pcache, cmutex, swap_addr);
+    }
       
     tmpid = addr / local_block_num;
     VLASER_DEB("|RD|try to get new block "<<addr<<" to cache");
-    VLASER_DEB("clean the backoff counter");
-    CleanBackoffCounter();
     /* try to obtain the new block */
     if(tmpid == my_id) { /* if it is a local block */
       while(1) { /* keep running this sequence until we get the block */
-        /*
-         * !!! finish sequence may not answer the self-node-requests,
-         * continue retrying may lead to deadlock
-         * so if the finish sequence in service thread has already being
-         * started, just return here.
-         * notice that this will lead the read/write method failure without
-         * warning the user.
-         *
-         */
-        if(finish_signal)
-          return;
-        Backoff();
-        cache_mutex.lock();
+        cmutex.lock();
 
-        ptmp = plocal_cache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);        
-        cache_mutex.unlock();
+        ptmp = pcache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);        
+        cmutex.unlock();
         swap_flag = 0;
 
-        PackAddr(addr, vsaddr_tag_only_buf); 
-        VLASER_DEB("|RD|send self request to get block "<<addr);
-        pmessage_passing->ReqSend(my_id, TAG_SELF_REQ_BLOCK, vsaddr_tag_only_buf, sizeof(vsaddr));
-        pmessage_passing->WaitAck(my_id, tag, message_buf, message_buf_size);
-        if(tag == TAG_ACK_RETRY) {
-          VLASER_DEB("|RD|self request fail, as TAG_ACK_RETRY got");
-          cache_mutex.lock();
-          plocal_cache->SetBlockStatus(addr, INVALID);
-          cache_mutex.unlock();
-          continue;
-        }
-        VLASER_DEB("|RD|self request block "<<addr<<" ok");
-        cache_mutex.lock();
-        /* now check if the block is still in cache */
-        ptmp = plocal_cache->AccessBlock(addr, 1);
+        /* update the directory here, no need to go through the service thread */
+        VLASER_DEB("|RD|self update directory to get block "<<addr);
+        i = SelfUpdateDirectory(addr, DIR_SHARED);
+        VLASER_DEB("|RD|self update directory for block "<<addr<<" ok");
+        cmutex.lock();
+        /* now check if the block is still in cache, PushBlock() has already
+         * told the replacement policy, so the access is not recorded again
+         */
+        ptmp = pcache->AccessBlock(addr, 0);
         if(ptmp != NULL) {
-          storage_mutex.lock();
-
           n = addr % local_block_num;
-          plocal_storage->RdBlock(n, ptmp);
-          storage_mutex.unlock();
+          ReadStorage(n, ptmp);
           /* if self request procedure returns exclusive status, we also change cache status to EXCLUSIVE */
-          if(tag == TAG_ACK_BLOCK_SHARED)
-            plocal_cache->SetBlockStatus(addr, SHARED);
+          if(i == DIR_SHARED)
+            pcache->SetBlockStatus(addr, SHARED);
 
-          plocal_cache->SetIntegrity(addr);
+          pcache->SetIntegrity(addr);
           memcpy(buf, ptmp + startpoint, count); /* give the data back to user */
-          cache_mutex.unlock();
+          cmutex.unlock();
           VLASER_DEB("|RD|read block "<<addr<<" from local storage ok");
           return;
          }
         else {
-          cache_mutex.unlock();
+          cmutex.unlock();
           VLASER_DEB("|RD|the block "<<addr<<" had been grabbed from my cache, now try again");
         }
       }
     }
     else while(1) { /* obtain the block from remote node */
-      Backoff();
       tmpid = addr / local_block_num; 
       /*
        * we are not sure that we can get the block with one try,
        * so we keep running this while(1){} sequence until we get the block
        *
        */
-      cache_mutex.lock();
+      cmutex.lock();
+      /* a TAG_REQ_CLEAN of the block must reach its home first */
+      WaitWriteBack(addr);
       /* we push the new block in advance and set it as exclusive,
        * but no other nodes know that we have this copy at the moment
        * because the directory has not been updated.
        */
-      ptmp = plocal_cache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);        
-      cache_mutex.unlock();
+      ptmp = pcache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);        
+      cmutex.unlock();
       swap_flag = 0;
       /* sent message to the owner node to acquire the block */
-      VLASER_DEB("|RD|request new block from node "<<tmpid);
       PackAddr(addr, vsaddr_tag_only_buf); 
-      pmessage_passing->ReqSend(tmpid, TAG_REQ_BLOCK, vsaddr_tag_only_buf, sizeof(vsaddr));
+      if(pdisk_cache != NULL && pdisk_cache->Find(addr, version)) {
+        /* ask the owner node whether the copy in the disk cache is current,
+         * and read the copy while the request is on its way
+         */
+        VLASER_DEB("|RD|request new block from node "<<tmpid<<" unless version "<<version<<" is current");
+        PackAddr(addr, message_buf);
+        PackAddr(version, message_buf + sizeof(vsaddr));
+        pmessage_passing->ReqSend(tmpid, TAG_REQ_BLOCK_VERSION, message_buf, 2 * sizeof(vsaddr));
+        pdisk_cache->Read(addr, disk_buf);
+      }
+      else {
+        VLASER_DEB("|RD|request new block from node "<<tmpid);
+        pmessage_passing->ReqSend(tmpid, TAG_REQ_BLOCK, vsaddr_tag_only_buf, sizeof(vsaddr));
+      }
       pmessage_passing->WaitAck(tmpid, tag, message_buf, message_buf_size);
-      if(tag == TAG_ACK_ASK_OTHER) {
+      pdata = message_buf;
+      if(tag == TAG_ACK_VERSION_VALID) {
+        VLASER_DEB("|RD|got the block from the disk cache");
+        ++disk_hits;
+        UnpackAddr(message_buf, n);
+        tag = (n == DIR_SHARED) ? TAG_ACK_BLOCK_SHARED : TAG_ACK_BLOCK_EXCLUSIVE;
+        pdata = disk_buf;
+      }
+      else if(tag == TAG_ACK_BLOCK_SHARED || tag == TAG_ACK_BLOCK_EXCLUSIVE) {
+        if(pdisk_cache != NULL && pdisk_cache->Find(addr, n)) {
+          /* the copy in the disk cache is out of date */
+          ++disk_stales;
+          pdisk_cache->Erase(addr);
+        }
+        UnpackAddr(message_buf + block_size, version);
+      }
+      else if(tag == TAG_ACK_ASK_OTHER) {
         holders_flag = 0;
         VLASER_DEB("|RD|be told to ask other");
         UnpackAddr(message_buf, n);
         VLASER_DEB("|RD|got "<<n<<" nodes in holder list");
+        /* the holders' copies are of the version after the list */
+        UnpackAddr(message_buf + sizeof(vsaddr) * (n + 1), version);
         i = n;
         while(i > 0) { /* ask each node in the list for the cache block */
           UnpackAddr(message_buf + sizeof(vsaddr) * (n - i + 1), tmpid);
@@ -1075,37 +2198,32 @@ namespace vlaser {
           VLASER_DEB("|RD|force to get the block from owner node "<<tmpid);
           pmessage_passing->ReqSend(tmpid, TAG_REQ_BLOCK_THIS_NODE, vsaddr_tag_only_buf, sizeof(vsaddr));
           pmessage_passing->WaitAck(tmpid, tag, message_buf, message_buf_size);
+          UnpackAddr(message_buf + block_size, version);
         }
       }
-      if(tag == TAG_ACK_RETRY) {
-        VLASER_DEB("|RD|request block from node "<<tmpid<<" fail, as TAG_ACK_RETRY got");
-        cache_mutex.lock();
-        plocal_cache->SetBlockStatus(addr, INVALID);
-        cache_mutex.unlock();
-        continue;
-      }
       if((tag != TAG_ACK_BLOCK_SHARED) && (tag != TAG_ACK_BLOCK_EXCLUSIVE))
         throw cpl_logic_error("block's host node return it does not have the block: from cpl::ReadWithinBlock()");
       VLASER_DEB("|RD|got the new block "<<addr<<" ok");
-      cache_mutex.lock();
-      ptmp = plocal_cache->AccessBlock(addr, 1);
+      cmutex.lock();
+      ptmp = pcache->AccessBlock(addr, 0);
       if(ptmp != NULL) { /* check whether the block is still in cache */
-        memcpy(ptmp, message_buf, block_size);
+        memcpy(ptmp, pdata, block_size);
         /* we have set the block as exclusive in advance, so if the status which
          * owner node returned is shared, we set the cache block also as SHARED
          */
         if(tag == TAG_ACK_BLOCK_SHARED)
-          plocal_cache->SetBlockStatus(addr, SHARED);
-        plocal_cache->SetIntegrity(addr);
+          pcache->SetBlockStatus(addr, SHARED);
+        pcache->SetIntegrity(addr);
+        pcache->SetBlockVersion(addr, version);
         memcpy(buf, ptmp + startpoint, count); /* give the data back to user */
-        cache_mutex.unlock();
+        cmutex.unlock();
         VLASER_DEB("|RD|read the block "<<addr<<" ok");
         return;
       }
       else { /* if the block had been set as invalid */
         /* we just release the local cache, and return to the very beginning of while(1){} sequence to try again */
         VLASER_DEB("|RD|the block "<<addr<<" had been grabbed from my cache, now try again");
-        cache_mutex.unlock();
+        cmutex.unlock();
       }
     }
   }
@@ -1113,10 +2231,13 @@ namespace vlaser {
   void
   cpl::WriteWithinBlock(vsaddr addr, int startpoint, int count, vsbyte* buf)
   {
+    vscache* pcache = CacheOf(addr);
+    vlamutex& cmutex = CacheMutex(addr);
     vsbyte* ptmp;
     vsbyte* pmes;
     int swap_flag;
     int wb_flag;
+    int len;
     vsaddr n;
     vsaddr swap_addr;
     vsnodeid tmpid;
@@ -1125,249 +2246,247 @@ namespace vlaser {
 
     VLASER_DEB("|WR|writing "<<count<<" bytes in block "<<addr<<" start at "<<startpoint);
     /* we first search the block in local cache */
-    cache_mutex.lock();
-    ptmp = plocal_cache->AccessBlock(addr, 1);
+    cmutex.lock();
+    ptmp = pcache->AccessBlock(addr, 1);
     if(ptmp != NULL) { /* if cache hits */
-      bs = plocal_cache->GetBlockStatus(addr);
-      if(bs != SHARED) {
-        /* set the block as modified */
+      bs = pcache->GetBlockStatus(addr);
+      if(bs != SHARED && (!sectored || pcache->HasSectors(addr, startpoint, count))) {
+        /* set the block as modified, also when it is MODIFIED already,
+         * so the cleaner knows the block is written again
+         */
         VLASER_DEB("|WR|local cache hit, and the block is not shared");
-        if(bs == EXCLUSIVE)
-          plocal_cache->SetBlockStatus(addr, MODIFIED);
+        pcache->SetBlockStatus(addr, MODIFIED);
+        pcache->MarkDirty(addr, startpoint, count);
         pmes = ptmp + startpoint;
         memcpy(pmes, buf, count); /* give the data back to user */
-        cache_mutex.unlock();
+        cmutex.unlock();
         VLASER_DEB("|WR|write block "<<addr<<" to cache ok");
         return;
       }
     }
-    cache_mutex.unlock();
+    cmutex.unlock();
 
-    CleanBackoffCounter();
     PackAddr(addr, vsaddr_tag_only_buf); 
     while(1) { /* we continue running this sequence until we write the block correctly */
-      /*
-       * !!!finish sequence may can not answer the self-requests,
-       * continue retrying may lead to deadlock
-       *
-       */
-      if(finish_signal)
-        return;
-      Backoff();
-      cache_mutex.lock();
-      ptmp = plocal_cache->AccessBlock(addr, 0); /* check whether the block is in cache */
-      cache_mutex.unlock();
+      cmutex.lock();
+      ptmp = pcache->AccessBlock(addr, 0); /* check whether the block is in cache */
+      cmutex.unlock();
       if(ptmp == NULL) {/* if cache misses */
         wb_flag = 0;
         swap_flag = 0;
-        cache_mutex.lock();
+        cmutex.lock();
         /* find a cache line to store the new block */
-        swap_flag = plocal_cache->FindReplacingBlock(swap_addr, wb_flag);
+        swap_flag = pcache->FindReplacingBlock(addr, swap_addr, wb_flag);
         if(wb_flag) { /* if we need to write back a old dirty block first */
           VLASER_DEB("|WR|write back block "<<swap_addr<<" first");
-          ptmp = plocal_cache->AccessBlock(swap_addr, 0);
-          cache_mutex.unlock();
+          WakeCleaner();
           tmpid = swap_addr / local_block_num;
           if(tmpid != my_id) { /* if a remote node */
-            PackAddr(swap_addr, message_buf);
-            pmes = message_buf + sizeof(vsaddr);
-            memcpy(pmes, ptmp, block_size);
-            /* send it to its owner node with writeback tag */
-            VLASER_DEB("|WR|request writing back to node "<<tmpid);
-            pmessage_passing->ReqSend(tmpid, TAG_REQ_WRITEBACK, message_buf, message_buf_size);
-            pmessage_passing->WaitAck(tmpid, tag, message_buf, message_buf_size);
+            /* send it to its owner node through the victim buffer */
+            pmes = PutVictim(swap_addr, len);
+            cmutex.unlock();
+            if(pmes != NULL) {
+              VLASER_DEB("|WR|request writing back to node "<<tmpid);
+              pmessage_passing->ReqSend(tmpid, TAG_REQ_VICTIM, pmes, len);
+            }
           }
           else { /* if writing back a local block */
             VLASER_DEB("|WR|writing back to local storage");
-            dir_mutex.lock();
-            cache_mutex.lock();
+            cmutex.unlock();
+            DirMutex(swap_addr % local_block_num).lock();
+            cmutex.lock();
             /* if the block is still in cache and still modified */
-            if((ptmp = plocal_cache->AccessBlock(swap_addr,0)) != NULL)
-              if(plocal_cache->GetBlockStatus(swap_addr) == MODIFIED) {
+            if((ptmp = pcache->AccessBlock(swap_addr,0)) != NULL)
+              if(pcache->GetBlockStatus(swap_addr) == MODIFIED) {
                 n = swap_addr % local_block_num;
                 storage_mutex.lock();
                 plocal_storage->WrBlock(n, ptmp);
                 storage_mutex.unlock();
-                if(local_dir[n].status != DIR_EXCLUSIVE)
+                if(local_dir->GetStatus(n) != DIR_EXCLUSIVE)
                   throw cpl_logic_error("find discord between local cache and local dir when local writeback: from cpl::WriteWithinBlock()");
-                local_dir[n].status = DIR_NONCACHED;
-                local_dir[n].holders.clear();
+                DropOwner(n);
               }
-              cache_mutex.unlock();
-              dir_mutex.unlock();
+            cmutex.unlock();
+            DirMutex(swap_addr % local_block_num).unlock();
           }
           VLASER_DEB("|WR|write back block "<<swap_addr<<" ok");
         }
-        else /* if no need to writeback, just release the cache lock */
-          cache_mutex.unlock();
+        else { /* if no need to writeback, just release the cache lock */
+          cmutex.unlock();
+          if(swap_flag)
+            SpillVictim(pcache, cmutex, swap_addr);
+        }
         tmpid = addr / local_block_num;
         VLASER_DEB("|WR|try to get new block "<<addr<<" to cache");
         if(tmpid == my_id) { /* if a local block */
-          cache_mutex.lock();
+          cmutex.lock();
           /* we push the new block in advance and set it as exclusive */
-          ptmp = plocal_cache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);        
-          cache_mutex.unlock();
-
-          PackAddr(addr, vsaddr_tag_only_buf); 
-          VLASER_DEB("|WR|send self request to write block "<<addr);
-          pmessage_passing->ReqSend(my_id, TAG_SELF_REQ_BLOCK_EXCLUSIVE, vsaddr_tag_only_buf, sizeof(vsaddr));
-          pmessage_passing->WaitAck(my_id, tag, message_buf, message_buf_size);
-          if(tag == TAG_ACK_RETRY) {
-            VLASER_DEB("|WR|self request fail, as TAG_ACK_RETRY got");
-            cache_mutex.lock();
-            plocal_cache->SetBlockStatus(addr, INVALID);
-            cache_mutex.unlock();
-            continue;
-          }
-          VLASER_DEB("|WR|self request ok");
-          cache_mutex.lock();
+          ptmp = pcache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);        
+          cmutex.unlock();
+
+          VLASER_DEB("|WR|self update directory to write block "<<addr);
+          SelfUpdateDirectory(addr, DIR_EXCLUSIVE);
+          VLASER_DEB("|WR|self update directory ok");
+          cmutex.lock();
           /* now check if the block is still in cache, and is still exclusive */
-          ptmp = plocal_cache->AccessBlock(addr, 1);
+          ptmp = pcache->AccessBlock(addr, 0);
           if(ptmp == NULL) {
             /* if not in cache any more, return to the very beginning and try again */
-            cache_mutex.unlock();
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had been grabbed from my cache, now try again");
             continue;
           }
-          if(plocal_cache->GetBlockStatus(addr) != EXCLUSIVE) {
+          if(pcache->GetBlockStatus(addr) != EXCLUSIVE) {
             /* if it had been set as shared by other node,
              * still fill the cache with this block, and than return to the beginning to try again */
-            storage_mutex.lock();
             n = addr % local_block_num;
-            plocal_storage->RdBlock(n, ptmp);
-            storage_mutex.unlock();
-            plocal_cache->SetIntegrity(addr);
-            cache_mutex.unlock();
+            ReadStorage(n, ptmp);
+            pcache->SetIntegrity(addr);
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had already been shared, now try again");
             continue;
           }
-          storage_mutex.lock();
-
           n = addr % local_block_num;
-          plocal_storage->RdBlock(n, ptmp);
-          storage_mutex.unlock();
+          ReadStorage(n, ptmp);
 
-          plocal_cache->SetIntegrity(addr);
+          pcache->SetIntegrity(addr);
           pmes = ptmp + startpoint;
           memcpy(pmes, buf, count);
-          plocal_cache->SetBlockStatus(addr, MODIFIED);
-          cache_mutex.unlock();
+          pcache->SetBlockStatus(addr, MODIFIED);
+          pcache->MarkDirty(addr, startpoint, count);
+          cmutex.unlock();
           VLASER_DEB("|WR|write block "<<addr<<" from local storage ok");
           return;
         }
         else { /* acquiring the block from remote node */
-          cache_mutex.lock();
+          cmutex.lock();
+          WaitWriteBack(addr);
           /* push the new block as exclusive, not modified, to avoid wrong writeback from this node's service thread */
-          ptmp = plocal_cache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);
-          cache_mutex.unlock();
+          ptmp = pcache->PushBlock(addr, EXCLUSIVE, swap_flag, swap_addr);
+          if(sectored) {
+            /* no sectors yet, get the ones written */
+            pcache->SetValidSectors(addr, 0);
+            cmutex.unlock();
+            if((ptmp = SectoredRequest(addr, startpoint, count, 1)) == NULL)
+              continue;
+            memcpy(ptmp + startpoint, buf, count);
+            pcache->SetBlockStatus(addr, MODIFIED);
+            pcache->MarkDirty(addr, startpoint, count);
+            cmutex.unlock();
+            VLASER_DEB("|WR|write block "<<addr<<" with its sectors got ok");
+            return;
+          }
+          cmutex.unlock();
 
           VLASER_DEB("|WR|request new block as exclusive from node "<<tmpid);
           pmessage_passing->ReqSend(tmpid, TAG_REQ_BLOCK_EXCLUSIVE, vsaddr_tag_only_buf, sizeof(vsaddr));
           pmessage_passing->WaitAck(tmpid, tag, message_buf, message_buf_size);
-          if(tag == TAG_ACK_RETRY) {
-            VLASER_DEB("|WR|request block from node "<<tmpid<<" fail, as TAG_ACK_RETRY got");
-            cache_mutex.lock();
-            plocal_cache->SetBlockStatus(addr, INVALID);
-            cache_mutex.unlock();
-            continue;
-          }
           /* lock the cache to check whether the block is still in cache and is still exclusive */
-          cache_mutex.lock();
-          ptmp = plocal_cache->AccessBlock(addr, 1);
+          cmutex.lock();
+          ptmp = pcache->AccessBlock(addr, 0);
           if(ptmp == NULL) {
             /* if not in cache any more, return to the very beginning and try again */
-            cache_mutex.unlock();
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had been grabbed from my cache, now try again");
             continue;
           }
-          if(plocal_cache->GetBlockStatus(addr) != EXCLUSIVE) {
+          if(pcache->GetBlockStatus(addr) != EXCLUSIVE) {
             /* if it had been set as shared by other node, 
              * write the block to cache still, and than return to the beginning and try again */
             memcpy(ptmp, message_buf, block_size);
-            plocal_cache->SetIntegrity(addr);
-            cache_mutex.unlock();
+            pcache->SetIntegrity(addr);
+            UnpackAddr(message_buf + block_size, n);
+            pcache->SetBlockVersion(addr, n);
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had already been shared, now try again");
             continue;
           }
           /* all conditions have been satisfied */
           memcpy(ptmp, message_buf, block_size);
-          plocal_cache->SetIntegrity(addr);
+          pcache->SetIntegrity(addr);
+          UnpackAddr(message_buf + block_size, n);
+          pcache->SetBlockVersion(addr, n);
           pmes = ptmp + startpoint;
           memcpy(pmes, buf, count);
-          plocal_cache->SetBlockStatus(addr, MODIFIED);
-          cache_mutex.unlock();
+          pcache->SetBlockStatus(addr, MODIFIED);
+          pcache->MarkDirty(addr, startpoint, count);
+          cmutex.unlock();
           VLASER_DEB("|WR|write block "<<addr<<" ok");
           return;
         }
       }
-      else { /* if the block is already in the cache, but the status is SHARED */
+      else { /* if the block is already in the cache, but the status is SHARED, or some sectors are left out */
         /* make the block writable */
         tmpid = addr / local_block_num;
         VLASER_DEB("|WR|writing block cache hit but tagged as shared");
         if(tmpid == my_id) {
-          cache_mutex.lock();
-          ptmp = plocal_cache->AccessBlock(addr, 0);
+          cmutex.lock();
+          ptmp = pcache->AccessBlock(addr, 0);
           if(ptmp == NULL) {
-            cache_mutex.unlock();
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had been grabbed from my cache, now try again");
             continue;
           }
-          plocal_cache->SetBlockStatus(addr, EXCLUSIVE);
-          cache_mutex.unlock();
-
-          PackAddr(addr, vsaddr_tag_only_buf); 
-          VLASER_DEB("|WR|send self request to tag block "<<addr<<" as exclusive");
-          pmessage_passing->ReqSend(my_id, TAG_SELF_REQ_BLOCK_EXCLUSIVE, vsaddr_tag_only_buf, sizeof(vsaddr));
-          pmessage_passing->WaitAck(my_id, tag, message_buf, message_buf_size);
-          if(tag == TAG_ACK_RETRY) {
-            VLASER_DEB("|WR|self request exclusive fail, as TAG_ACK_RETRY got");
-            continue;
-          }
-          VLASER_DEB("|WR|self request ok");
-          cache_mutex.lock();
+          pcache->SetBlockStatus(addr, EXCLUSIVE);
+          cmutex.unlock();
+
+          VLASER_DEB("|WR|self update directory to tag block "<<addr<<" as exclusive");
+          SelfUpdateDirectory(addr, DIR_EXCLUSIVE);
+          VLASER_DEB("|WR|self update directory ok");
+          cmutex.lock();
           /* now check if the block is still in cache, and is still exclusive */
-          ptmp = plocal_cache->AccessBlock(addr, 1);
+          ptmp = pcache->AccessBlock(addr, 0);
           if(ptmp == NULL) {
             /* if not in cache any more, return to the very beginning and try again */
-            cache_mutex.unlock();
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had been grabbed from my cache, now try again");
             continue;
           }
-          if(plocal_cache->GetBlockStatus(addr) != EXCLUSIVE) {
+          if(pcache->GetBlockStatus(addr) != EXCLUSIVE) {
             /* if it had been set as shared by other node, also return to the beginning */
-            cache_mutex.unlock();
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had already been shared, now try again");
             continue;
           }
-          storage_mutex.lock();
-
           n = addr % local_block_num;
-          plocal_storage->RdBlock(n, ptmp);
-          storage_mutex.unlock();
+          ReadStorage(n, ptmp);
 
-          plocal_cache->SetIntegrity(addr);
+          pcache->SetIntegrity(addr);
           pmes = ptmp + startpoint;
           memcpy(pmes, buf, count);
-          plocal_cache->SetBlockStatus(addr, MODIFIED);
-          cache_mutex.unlock();
+          pcache->SetBlockStatus(addr, MODIFIED);
+          pcache->MarkDirty(addr, startpoint, count);
+          cmutex.unlock();
           VLASER_DEB("|WR|write block "<<addr<<" from local storage ok");
           return;
         }
+        else if(sectored) {
+          /* only the sectors written are made exclusive */
+          if((ptmp = SectoredRequest(addr, startpoint, count, 1)) == NULL)
+            continue;
+          memcpy(ptmp + startpoint, buf, count);
+          pcache->SetBlockStatus(addr, MODIFIED);
+          pcache->MarkDirty(addr, startpoint, count);
+          cmutex.unlock();
+          VLASER_DEB("|WR|write block "<<addr<<" with its sectors got ok");
+          return;
+        }
         else { /* if the block is a remote block */
           /*
            * set the block as exclusive in advance, to make it be possible for service 
            * thread to answer the SET_SHARED and SET_INVALID request
            *
            */
-          cache_mutex.lock();
-          ptmp = plocal_cache->AccessBlock(addr, 0);
+          cmutex.lock();
+          WaitWriteBack(addr);
+          ptmp = pcache->AccessBlock(addr, 0);
           if(ptmp == NULL) {
-            cache_mutex.unlock();
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had been grabbed from my cache, now try again");
             continue;
           }
-          plocal_cache->SetBlockStatus(addr, EXCLUSIVE);
-          cache_mutex.unlock();
+          pcache->SetBlockStatus(addr, EXCLUSIVE);
+          cmutex.unlock();
 
           VLASER_DEB("|WR|request node "<<tmpid<<" to set block "<<addr<<" as exclusive");
           pmessage_passing->ReqSend(tmpid, TAG_REQ_EXCLUSIVE, vsaddr_tag_only_buf, sizeof(vsaddr));
@@ -1381,23 +2500,27 @@ namespace vlaser {
            * or shared. If so, return to the beginning to try again.
            *
            */
-          cache_mutex.lock();
-          ptmp = plocal_cache->AccessBlock(addr, 1);
+          cmutex.lock();
+          ptmp = pcache->AccessBlock(addr, 0);
           if(ptmp == NULL) {
-            cache_mutex.unlock();
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had been grabbed from my cache, now try again");
             continue;
           }
-          if(plocal_cache->GetBlockStatus(addr) != EXCLUSIVE) {
-            cache_mutex.unlock();
+          if(pcache->GetBlockStatus(addr) != EXCLUSIVE) {
+            cmutex.unlock();
             VLASER_DEB("|WR|the block "<<addr<<" had already been shared, now try again");
             continue;
           }
-          /* all conditions have been satisfied*/
-          plocal_cache->SetBlockStatus(addr, MODIFIED);
+          /* all conditions have been satisfied, the home has a new version
+           * of the block, which this node does not know
+           */
+          pcache->SetBlockStatus(addr, MODIFIED);
+          pcache->MarkDirty(addr, startpoint, count);
+          pcache->SetBlockVersion(addr, vscache::NO_VERSION);
           pmes = ptmp + startpoint;
           memcpy(pmes, buf, count);
-          cache_mutex.unlock();
+          cmutex.unlock();
           VLASER_DEB("|WR|write block "<<addr<<" ok");
           return;
         }
@@ -1405,6 +2528,68 @@ namespace vlaser {
     }
   }
   
+  vsbyte*
+  cpl::SectoredRequest(vsaddr addr, int startpoint, int count, int overwrite)
+  {
+    vscache* pcache = CacheOf(addr);
+    vlamutex& cmutex = CacheMutex(addr);
+    vsnodeid tmpid = addr / local_block_num;
+    unsigned long long need, valid, want, ship;
+    vsbyte* ptmp;
+    vsaddr n;
+    int tag, len;
+
+    need = pcache->SectorsOf(startpoint, count);
+    cmutex.lock();
+    WaitWriteBack(addr);
+    if((ptmp = pcache->AccessBlock(addr, 0)) == NULL) {
+      cmutex.unlock();
+      VLASER_DEB("|WR|the block "<<addr<<" had been grabbed from my cache, now try again");
+      return NULL;
+    }
+    valid = pcache->GetValidSectors(addr);
+    if(pcache->GetBlockStatus(addr) == SHARED) {
+      /* the other holders may have the sectors of a shared copy, keep
+       * the ones needed and set it as exclusive in advance
+       */
+      valid &= need;
+      want = need;
+      pcache->SetValidSectors(addr, valid);
+      pcache->SetBlockStatus(addr, EXCLUSIVE);
+    }
+    else if((valid & need) == need)
+      return ptmp;
+    else /* nobody else has the sectors the owner has */
+      want = need & ~valid;
+    ship = want & ~valid;
+    if(overwrite)
+      ship &= ~pcache->WholeSectorsOf(startpoint, count);
+    cmutex.unlock();
+
+    VLASER_DEB("|WR|request sectors "<<want<<" of block "<<addr<<" from node "<<tmpid<<", "<<ship<<" shipped");
+    PackAddr(addr, message_buf);
+    PackMask(want, message_buf + sizeof(vsaddr));
+    PackMask(ship, message_buf + sizeof(vsaddr) + DIRTY_MASK_SIZE);
+    pmessage_passing->ReqSend(tmpid, TAG_REQ_BLOCK_EXCLUSIVE, message_buf, sizeof(vsaddr) + 2 * DIRTY_MASK_SIZE);
+    pmessage_passing->WaitAck(tmpid, tag, message_buf, message_buf_size);
+    if(tag != TAG_ACK_BLOCK_EXCLUSIVE)
+      throw cpl_logic_error("block's host node return it does not have the block: from cpl::SectoredRequest()");
+    /* check whether the block is still in cache and is still exclusive */
+    cmutex.lock();
+    ptmp = pcache->AccessBlock(addr, 0);
+    if(ptmp == NULL || pcache->GetBlockStatus(addr) == SHARED) {
+      cmutex.unlock();
+      VLASER_DEB("|WR|the block "<<addr<<" had been grabbed or shared, now try again");
+      return NULL;
+    }
+    len = UnpackSectors(message_buf, ship, ptmp);
+    UnpackAddr(message_buf + len, n);
+    pcache->SetValidSectors(addr, pcache->GetValidSectors(addr) | want);
+    pcache->SetIntegrity(addr);
+    pcache->SetBlockVersion(addr, n);
+    return ptmp;
+  }
+
   int
   cpl::Write(globaladdress gd, vsbyte* buf, int count)
   {
@@ -1414,10 +2599,9 @@ namespace vlaser {
     int i;
     
     /* if this node has been told to terminate, do nothing, just return */
-    if(finish_signal || !is_message_service_ready)
+    if(!BeginIO())
       return 0;
     try{
-      io_busy = 1;
       VLASER_DEB("begin global random write()");
 
       endaddr = (gd + count - 1) / block_size;
@@ -1440,7 +2624,7 @@ namespace vlaser {
         }
         WriteWithinBlock(startaddr, 0, (gd + count) % block_size, buf);
       }
-      io_busy = 0;
+      EndIO();
     }
     catch(std::logic_error& except) {
       std::cout<<"|FATAL| get logic error"<<std::endl<<except.what()<<std::endl<<"catched in cpl::Write"
@@ -1479,6 +2663,20 @@ namespace vlaser {
     std::cout<<"|STD| VLASER Node "<<my_id<<" :"<<std::endl;
     MakeRandomSeed();
     std::cout<<"|STD| Make random seed ok."<<std::endl;
+    std::cout<<"|STD| Local directory has "<<local_dir->entry_num<<" entries in "<<local_dir->FormatName()
+      <<" format, using "<<local_dir->Footprint()<<" bytes."<<std::endl;
+    std::cout<<"|STD| Local cache has "<<cache_block_num<<" blocks in "<<cache_shard_num<<" shards, replaced by "
+      <<cache_shards[0]->PolicyName()<<" policy."<<std::endl;
+    std::cout<<"|STD| Cache data is on "<<cache_shards[0]->DataArena()->BackingName();
+    if(cache_shards[0]->DataArena()->NumaNode() >= 0)
+      std::cout<<" of NUMA node "<<cache_shards[0]->DataArena()->NumaNode();
+    std::cout<<", message buffers are on "<<message_pool->Arena()->BackingName()<<"."<<std::endl;
+    if(pdisk_cache != NULL)
+      std::cout<<"|STD| Disk cache keeps "<<pdisk_cache->slot_num<<" replaced remote blocks."<<std::endl;
+    if(sectored)
+      std::cout<<"|STD| Coherence of the remote blocks is kept by sectors of "<<block_size / vscache::DIRTY_SECTORS<<" bytes."<<std::endl;
+    if(clean_high > 0)
+      std::cout<<"|STD| Cleaner writes back dirty blocks above "<<clean_high<<"% of a shard down to "<<clean_low<<"%."<<std::endl;
     std::cout<<"|STD| Initializing coherence protocol service thread and waiting for all vlaser nodes get ready..."<<std::endl;
     /* block the main thread, and wait for the message serivce thread being ready */
     while(!is_message_service_ready)
@@ -1500,6 +2698,80 @@ namespace vlaser {
     return;
   }
 
+  void
+  cpl::SetWriteBackWatermarks(int high, int low)
+  {
+    if(is_message_service_ready)
+      throw cpl_logic_error("setting the watermarks after initialization: from cpl::SetWriteBackWatermarks()");
+    if(high < 0 || high > 100 || low < 0 || (high > 0 && low > high))
+      throw cpl_logic_error("wrong watermarks: from cpl::SetWriteBackWatermarks()");
+    clean_high = high;
+    clean_low = low;
+    return;
+  }
+
+  void
+  cpl::SetDiskCache(const char* path, vsaddr n)
+  {
+    if(is_message_service_ready)
+      throw cpl_logic_error("setting the disk cache after initialization: from cpl::SetDiskCache()");
+    if(pdisk_cache != NULL) {
+      delete pdisk_cache;
+      pdisk_cache = NULL;
+    }
+    if(n == 0)
+      return;
+    pdisk_cache = new vsdiskcache((BlockSize)block_size, n, path);
+    if(disk_buf == NULL)
+      disk_buf = message_pool->Get();
+    return;
+  }
+
+  void
+  cpl::SetSectoredCoherence()
+  {
+    if(is_message_service_ready)
+      throw cpl_logic_error("setting the sectored coherence after initialization: from cpl::SetSectoredCoherence()");
+    if(dir_owner == NULL) {
+      dir_owner = new vsnodeid[local_block_num];
+      for(vsaddr i = 0; i < local_block_num; ++i)
+        dir_owner[i] = node_num; /* no owner */
+    }
+    sectored = 1;
+    return;
+  }
+
+  void
+  cpl::GetCacheStatistics(vscache::Statistics& st)
+  {
+    vscache::Statistics sst;
+
+    st.hits = st.misses = st.evictions = st.dirty_evictions = 0;
+    for(int i = 0; i < cache_shard_num; ++i) {
+      cache_mutex[i].lock();
+      cache_shards[i]->GetStatistics(sst);
+      cache_mutex[i].unlock();
+      st.hits += sst.hits;
+      st.misses += sst.misses;
+      st.evictions += sst.evictions;
+      st.dirty_evictions += sst.dirty_evictions;
+    }
+    return;
+  }
+
+  void
+  cpl::Sync()
+  {
+    /* the writes of the local storage are under storage_mutex, and
+     * they are durable after the shutdown sequence finalizes it
+     */
+    storage_mutex.lock();
+    if(is_message_service_ready)
+      plocal_storage->Sync();
+    storage_mutex.unlock();
+    return;
+  }
+
   void
   cpl::WaitShutDown()
   {
@@ -10,33 +10,165 @@
  *
  * Feb 16, 2011  Original Design
  * May 15, 2011  Add class lsal_air
+ * Oct 17, 2026  lsal_fileemulate::Rd() and Wr()
+ * Oct 17, 2026  pread64() and pwrite64() instead of lseek64() with read()
+ *               and write(), no O_SYNC, Sync() flushes the file.
+ * Oct 17, 2026  class lsal_queue
+ * Oct 17, 2026  lsal_fileemulate with O_DIRECT and a pool of aligned buffers.
+ * Oct 17, 2026  lsal_fileemulate::RdBlocks() and WrBlocks() by preadv64()
+ *               and pwritev64(), lsal_queue::Submit() runs the queued
+ *               requests by them.
  *
  */
 
 #define _LARGEFILE64_SOURCE
 
+#define DIRECT_IO_ALIGN 4096 //buffer, offset and length alignment of O_DIRECT, the largest logical sector
+#define DIRECT_IO_BOUNCE_BUFFERS 8 //pooled aligned buffers for the unaligned reads and writes
+#define VECTOR_IO_MAX 1024 //most blocks in one preadv64() or pwritev64(), IOV_MAX of linux
+
 #include "lsal.h"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 
 namespace vlaser {
 
+  lsal_queue*
+  lsal::NewQueue(int depth)
+  {
+    return new lsal_queue(this, depth);
+  }
+
+  /*
+   * Implementation for class lsal_queue
+   */
+
+  lsal_queue::lsal_queue(lsal* pls, int dp) :
+  depth(dp),
+  storage(pls)
+  {
+    if(dp < 1)
+      throw lsal::lsal_logic_error("queue of no request: from lsal_queue::lsal_queue()");
+    pending = 0;
+    done = new void*[dp];
+    done_head = 0;
+    done_num = 0;
+    waiting_blocks = new vsaddr[dp];
+    waiting_bufs = new vsbyte*[dp];
+    waiting_tags = new void*[dp];
+    waiting_writes = new int[dp];
+    waiting_num = 0;
+  }
+
+  lsal_queue::~lsal_queue()
+  {
+    delete[] done;
+    delete[] waiting_blocks;
+    delete[] waiting_bufs;
+    delete[] waiting_tags;
+    delete[] waiting_writes;
+  }
+
+  void
+  lsal_queue::Reserve()
+  {
+    if(pending >= depth)
+      throw lsal::lsal_logic_error("too many requests in the queue: from lsal_queue::Reserve()");
+    return;
+  }
+
+  void
+  lsal_queue::Keep(vsaddr blockno, vsbyte* buf, void* tag, int write)
+  {
+    Reserve();
+    waiting_blocks[waiting_num] = blockno;
+    waiting_bufs[waiting_num] = buf;
+    waiting_tags[waiting_num] = tag;
+    waiting_writes[waiting_num] = write;
+    ++waiting_num;
+    ++pending;
+    return;
+  }
+
+  void
+  lsal_queue::RdBlockAsync(vsaddr blockno, vsbyte* buf, void* tag)
+  {
+    Keep(blockno, buf, tag, 0);
+    return;
+  }
+
+  void
+  lsal_queue::WrBlockAsync(vsaddr blockno, vsbyte* buf, void* tag)
+  {
+    Keep(blockno, buf, tag, 1);
+    return;
+  }
+
+  int
+  lsal_queue::Submit()
+  {
+    int i, j, n;
+
+    /* a run of reads or of writes goes in one call, so the
+     * reads and writes of a block keep their order
+     */
+    for(i = 0; i < waiting_num; i = j) {
+      for(j = i + 1; j < waiting_num && waiting_writes[j] == waiting_writes[i]; ++j)
+        ;
+      if(waiting_writes[i])
+        storage->WrBlocks(waiting_blocks + i, waiting_bufs + i, j - i);
+      else
+        storage->RdBlocks(waiting_blocks + i, waiting_bufs + i, j - i);
+      for(; i < j; ++i)
+        done[(done_head + done_num++) % depth] = waiting_tags[i];
+    }
+    n = waiting_num;
+    waiting_num = 0;
+    return n;
+  }
+
+  int
+  lsal_queue::Complete(void*& tag)
+  {
+    if(waiting_num > 0)
+      Submit();
+    if(done_num == 0)
+      return 0;
+    tag = done[done_head];
+    done_head = (done_head + 1) % depth;
+    --done_num;
+    --pending;
+    return 1;
+  }
+
   /*
    * Implementation for class lsal_fileemulate
    */
 
-  lsal_fileemulate::lsal_fileemulate(BlockSize bs, vsaddr vol, const char* fp) :
+  lsal_fileemulate::lsal_fileemulate(BlockSize bs, vsaddr vol, const char* fp, int flags) :
   lsal(bs, vol)
   {
-    if((fd = open(fp, O_CREAT|O_RDWR|O_SYNC|O_LARGEFILE, S_IRUSR|S_IWUSR)) == -1)
+    fd = -1;
+    align = 0;
+    bounce_pool = NULL;
+    if((flags & DIRECT_IO) && (fd = open(fp, O_CREAT|O_RDWR|O_LARGEFILE|O_DIRECT, S_IRUSR|S_IWUSR)) != -1) {
+      align = DIRECT_IO_ALIGN;
+      bounce_pool = new vsbufpool(bs, DIRECT_IO_BOUNCE_BUFFERS, vsarena::ARENA_HUGE_PAGES | vsarena::ARENA_NUMA_LOCAL, align);
+    }
+    if(fd == -1 && (fd = open(fp, O_CREAT|O_RDWR|O_LARGEFILE, S_IRUSR|S_IWUSR)) == -1)
       throw lsal_runtime_error("encounter failure during opening local storage emulation file: from lsal_fileemulate::lsal_fileemulate()");
   }
 
   lsal_fileemulate::~lsal_fileemulate()
   {
     close(fd);
+    delete bounce_pool;
   }
 
   int
@@ -48,17 +180,36 @@ namespace vlaser {
   int
   lsal_fileemulate::Finalize()
   {
-
+    Sync();
     return 0;
   }
 
+  void
+  lsal_fileemulate::Sync()
+  {
+    if(fdatasync(fd) != 0)
+      throw lsal_runtime_error("flushing the file fail: from lsal_fileemulate::Sync()");
+    return;
+  }
+
   void
   lsal_fileemulate::RdBlock(vsaddr blockno, vsbyte* buf)
   {
+    vsbyte* p;
+    ssize_t r;
+
     if(blockno >= block_num)
       throw lsal_runtime_error("RdBlock() method address overflow: from lsal_fileemulate::RdBlock()");
-    lseek64(fd, blockno * block_size, SEEK_SET);
-    if(read(fd, buf, block_size) != block_size)
+    if(align == 0 || Aligned(buf)) {
+      if(pread64(fd, buf, block_size, (off64_t)blockno * block_size) != (ssize_t)block_size)
+        throw lsal_runtime_error("reading block fail: from lsal_fileemulate::RdBlock()");
+      return;
+    }
+    p = bounce_pool->Get();
+    if((r = pread64(fd, p, block_size, (off64_t)blockno * block_size)) == (ssize_t)block_size)
+      memcpy(buf, p, block_size);
+    bounce_pool->Put(p);
+    if(r != (ssize_t)block_size)
       throw lsal_runtime_error("reading block fail: from lsal_fileemulate::RdBlock()");
     return;
   }
@@ -66,12 +217,162 @@ namespace vlaser {
   void
   lsal_fileemulate::WrBlock(vsaddr blockno, vsbyte* buf)
   {
+    vsbyte* p;
+    ssize_t r;
+
     if(blockno >= block_num)
       throw lsal_runtime_error("WrBlock() method address overflow: from lsal_fileemulate::WrBlock()");
-    lseek64(fd, blockno * block_size, SEEK_SET);
-    if(write(fd, buf, block_size) != block_size)
+    if(align == 0 || Aligned(buf)) {
+      if(pwrite64(fd, buf, block_size, (off64_t)blockno * block_size) != (ssize_t)block_size)
+        throw lsal_runtime_error("writing block fail: from lsal_fileemulate::WrBlock()");
+      return;
+    }
+    p = bounce_pool->Get();
+    memcpy(p, buf, block_size);
+    r = pwrite64(fd, p, block_size, (off64_t)blockno * block_size);
+    bounce_pool->Put(p);
+    if(r != (ssize_t)block_size)
       throw lsal_runtime_error("writing block fail: from lsal_fileemulate::WrBlock()");
     return;
   }
+
+  /* orders the requests of Blocks() by block number */
+  struct BlockOrder {
+    const vsaddr* blocknos;
+    BlockOrder(const vsaddr* b) : blocknos(b) {}
+    bool operator()(int a, int b) const { return blocknos[a] < blocknos[b]; }
+  };
+
+  void
+  lsal_fileemulate::Blocks(const vsaddr* blocknos, vsbyte* const* bufs, int n, int write)
+  {
+    std::vector<int> order(n);
+    std::vector<struct iovec> iov;
+    struct iovec* piov;
+    off64_t off;
+    ssize_t r;
+    int i, j, cnt;
+
+    for(i = 0; i < n; ++i) {
+      if(blocknos[i] >= block_num)
+        throw lsal_runtime_error("Blocks() method address overflow: from lsal_fileemulate::Blocks()");
+      order[i] = i;
+    }
+    /* stable, so the writes of the same block keep their order */
+    std::stable_sort(order.begin(), order.end(), BlockOrder(blocknos));
+    iov.resize(n < VECTOR_IO_MAX ? n : VECTOR_IO_MAX);
+    for(i = 0; i < n; i = j) {
+      /* an unaligned buffer of an O_DIRECT file goes through a bounce buffer */
+      if(align != 0 && !Aligned(bufs[order[i]])) {
+        if(write)
+          WrBlock(blocknos[order[i]], bufs[order[i]]);
+        else
+          RdBlock(blocknos[order[i]], bufs[order[i]]);
+        j = i + 1;
+        continue;
+      }
+      /* the run of adjacent blocks from i */
+      for(j = i; j < n && j - i < VECTOR_IO_MAX; ++j) {
+        if(j > i && (blocknos[order[j]] != blocknos[order[j - 1]] + 1 || (align != 0 && !Aligned(bufs[order[j]]))))
+          break;
+        iov[j - i].iov_base = bufs[order[j]];
+        iov[j - i].iov_len = block_size;
+      }
+      off = (off64_t)blocknos[order[i]] * block_size;
+      piov = &iov[0];
+      cnt = j - i;
+      while(cnt > 0) {
+        if((r = write ? pwritev64(fd, piov, cnt, off) : preadv64(fd, piov, cnt, off)) <= 0)
+          throw lsal_runtime_error(write ? "writing blocks fail: from lsal_fileemulate::Blocks()"
+            : "reading blocks fail: from lsal_fileemulate::Blocks()");
+        /* go on after a short transfer */
+        off += r;
+        for(; cnt > 0 && (size_t)r >= piov->iov_len; ++piov, --cnt)
+          r -= piov->iov_len;
+        if(cnt > 0) {
+          piov->iov_base = (vsbyte*)piov->iov_base + r;
+          piov->iov_len -= r;
+        }
+      }
+    }
+    return;
+  }
+
+  void
+  lsal_fileemulate::RdBlocks(const vsaddr* blocknos, vsbyte* const* bufs, int n)
+  {
+    Blocks(blocknos, bufs, n, 0);
+    return;
+  }
+
+  void
+  lsal_fileemulate::WrBlocks(const vsaddr* blocknos, vsbyte* const* bufs, int n)
+  {
+    Blocks(blocknos, bufs, n, 1);
+    return;
+  }
+
+  int
+  lsal_fileemulate::Rd(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size)
+  {
+    vsbyte* p;
+    off64_t off;
+    size_t start, end;
+    ssize_t r;
+
+    if(blockno >= block_num || pos + size > (blockoffset)block_size)
+      throw lsal_runtime_error("Rd() method address overflow: from lsal_fileemulate::Rd()");
+    off = (off64_t)blockno * block_size;
+    if(align == 0) {
+      if(pread64(fd, buf, size, off + pos) != (ssize_t)size)
+        throw lsal_runtime_error("reading fail: from lsal_fileemulate::Rd()");
+      return size;
+    }
+    /* read the aligned span around the bytes */
+    start = pos / align * align;
+    end = (pos + size + align - 1) / align * align;
+    p = bounce_pool->Get();
+    if((r = pread64(fd, p, end - start, off + start)) == (ssize_t)(end - start))
+      memcpy(buf, p + pos - start, size);
+    bounce_pool->Put(p);
+    if(r != (ssize_t)(end - start))
+      throw lsal_runtime_error("reading fail: from lsal_fileemulate::Rd()");
+    return size;
+  }
+
+  int
+  lsal_fileemulate::Wr(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size)
+  {
+    vsbyte* p;
+    off64_t off;
+    size_t start, end;
+    ssize_t r;
+
+    if(blockno >= block_num || pos + size > (blockoffset)block_size)
+      throw lsal_runtime_error("Wr() method address overflow: from lsal_fileemulate::Wr()");
+    off = (off64_t)blockno * block_size;
+    if(align == 0 || (Aligned(buf) && pos % align == 0 && size % align == 0)) {
+      if(pwrite64(fd, buf, size, off + pos) != (ssize_t)size)
+        throw lsal_runtime_error("writing fail: from lsal_fileemulate::Wr()");
+      return size;
+    }
+    /* read, modify and write the aligned span around the bytes,
+     * the writes are serialized by the caller
+     */
+    start = pos / align * align;
+    end = (pos + size + align - 1) / align * align;
+    p = bounce_pool->Get();
+    if((r = pread64(fd, p, end - start, off + start)) >= 0) {
+      /* beyond the end of the file reads as zero, as a hole */
+      if(r < (ssize_t)(end - start))
+        memset(p + r, 0, end - start - r);
+      memcpy(p + pos - start, buf, size);
+      r = pwrite64(fd, p, end - start, off + start);
+    }
+    bounce_pool->Put(p);
+    if(r != (ssize_t)(end - start))
+      throw lsal_runtime_error("writing fail: from lsal_fileemulate::Wr()");
+    return size;
+  }
   
 } //end namesapce vlaser
@@ -0,0 +1,139 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Storage Memory Mapped Implementation
+ * class vlaser::lsal_mmap
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  Clear the dirty bits of a run before flushing it.
+ *
+ */
+
+#define _LARGEFILE64_SOURCE
+
+#include "lsal_mmap.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class lsal_mmap
+   */
+
+  lsal_mmap::lsal_mmap(BlockSize bs, vsaddr vol, const char* fp) :
+  lsal(bs, vol)
+  {
+    struct stat64 st;
+    void* p;
+
+    map_size = (size_t)bs * vol;
+    if((fd = open(fp, O_CREAT|O_RDWR|O_LARGEFILE, S_IRUSR|S_IWUSR)) == -1)
+      throw lsal_runtime_error("encounter failure during opening local storage file: from lsal_mmap::lsal_mmap()");
+    if(fstat64(fd, &st) != 0 || ((size_t)st.st_size < map_size && ftruncate64(fd, (off64_t)map_size) != 0)) {
+      close(fd);
+      throw lsal_runtime_error("can not size the local storage file: from lsal_mmap::lsal_mmap()");
+    }
+    if((p = mmap(NULL, map_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+      close(fd);
+      throw lsal_runtime_error("can not map the local storage file: from lsal_mmap::lsal_mmap()");
+    }
+    base = (vsbyte*)p;
+    dirty_map = new unsigned char[(vol + 7) / 8];
+    memset(dirty_map, 0, (vol + 7) / 8);
+  }
+
+  lsal_mmap::~lsal_mmap()
+  {
+    munmap(base, map_size);
+    close(fd);
+    delete[] dirty_map;
+  }
+
+  int
+  lsal_mmap::Finalize()
+  {
+    Sync();
+    return 0;
+  }
+
+  void
+  lsal_mmap::Sync()
+  {
+    vsaddr i, j;
+
+    /* one msync() for each run of dirty blocks */
+    for(i = 0; i < block_num; i = j) {
+      if(dirty_map[i >> 3] == 0) {
+        j = (i | 7) + 1;
+        continue;
+      }
+      if(!IsDirty(i)) {
+        j = i + 1;
+        continue;
+      }
+      /* the bits of the run are cleared before it is flushed, a block
+       * written again meanwhile stays dirty for the next Sync()
+       */
+      for(j = i; j < block_num && IsDirty(j); ++j)
+        ClearDirty(j);
+      if(msync(base + (size_t)i * block_size, (size_t)(j - i) * block_size, MS_SYNC) != 0)
+        throw lsal_runtime_error("flushing the mapping fail: from lsal_mmap::Sync()");
+    }
+    return;
+  }
+
+  vsbyte*
+  lsal_mmap::BlockPointer(vsaddr blockno)
+  {
+    if(blockno >= block_num)
+      throw lsal_runtime_error("BlockPointer() method address overflow: from lsal_mmap::BlockPointer()");
+    return base + (size_t)blockno * block_size;
+  }
+
+  void
+  lsal_mmap::RdBlock(vsaddr blockno, vsbyte* buf)
+  {
+    if(blockno >= block_num)
+      throw lsal_runtime_error("RdBlock() method address overflow: from lsal_mmap::RdBlock()");
+    memcpy(buf, base + (size_t)blockno * block_size, block_size);
+    return;
+  }
+
+  void
+  lsal_mmap::WrBlock(vsaddr blockno, vsbyte* buf)
+  {
+    if(blockno >= block_num)
+      throw lsal_runtime_error("WrBlock() method address overflow: from lsal_mmap::WrBlock()");
+    memcpy(base + (size_t)blockno * block_size, buf, block_size);
+    MarkDirty(blockno);
+    return;
+  }
+
+  int
+  lsal_mmap::Rd(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size)
+  {
+    if(blockno >= block_num || pos + size > (blockoffset)block_size)
+      throw lsal_runtime_error("Rd() method address overflow: from lsal_mmap::Rd()");
+    memcpy(buf, base + (size_t)blockno * block_size + pos, size);
+    return size;
+  }
+
+  int
+  lsal_mmap::Wr(vsaddr blockno, blockoffset pos, vsbyte* buf, blockoffset size)
+  {
+    if(blockno >= block_num || pos + size > (blockoffset)block_size)
+      throw lsal_runtime_error("Wr() method address overflow: from lsal_mmap::Wr()");
+    memcpy(base + (size_t)blockno * block_size + pos, buf, size);
+    MarkDirty(blockno);
+    return size;
+  }
+
+} //end namespace vlaser
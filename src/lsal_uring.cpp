@@ -0,0 +1,240 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Storage io_uring Implementation
+ * class vlaser::lsal_uring
+ * class vlaser::lsal_uring_queue
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  Unaligned buffers of an O_DIRECT file run at once.
+ * Oct 17, 2026  The requests kept by lsal_queue are submitted too.
+ *
+ */
+
+#define _LARGEFILE64_SOURCE
+
+#include "lsal_uring.h"
+#include <linux/io_uring.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class lsal_uring
+   */
+
+  lsal_queue*
+  lsal_uring::NewQueue(int depth)
+  {
+    return new lsal_uring_queue(this, fd, depth);
+  }
+
+  /*
+   * Implementation of class lsal_uring_queue
+   */
+
+  lsal_uring_queue::lsal_uring_queue(lsal_uring* pls, int fd, int dp) :
+  lsal_queue(pls, dp),
+  file_fd(fd)
+  {
+    struct io_uring_params p;
+    char* sq;
+    char* cq;
+
+    queued = 0;
+    requests = new Request[dp];
+    free_requests = new int[dp];
+    for(free_num = 0; free_num < dp; ++free_num)
+      free_requests[free_num] = dp - 1 - free_num;
+    sq_ring = cq_ring = sqes = MAP_FAILED;
+
+    memset(&p, 0, sizeof(p));
+    if((ring_fd = syscall(__NR_io_uring_setup, dp, &p)) < 0) {
+      ring_fd = -1;
+      return;
+    }
+    sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP) {
+      if(cq_ring_size > sq_ring_size)
+        sq_ring_size = cq_ring_size;
+      cq_ring_size = sq_ring_size;
+    }
+    sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    sq_ring = mmap(NULL, sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if(p.features & IORING_FEAT_SINGLE_MMAP)
+      cq_ring = sq_ring;
+    else
+      cq_ring = mmap(NULL, cq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    sqes = mmap(NULL, sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if(sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+      throw lsal::lsal_runtime_error("can not map the io_uring rings: from lsal_uring_queue::lsal_uring_queue()");
+
+    sq = (char*)sq_ring;
+    sq_head = (unsigned*)(sq + p.sq_off.head);
+    sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    sq_array = (unsigned*)(sq + p.sq_off.array);
+    cq = (char*)cq_ring;
+    cq_head = (unsigned*)(cq + p.cq_off.head);
+    cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    cqes = cq + p.cq_off.cqes;
+  }
+
+  lsal_uring_queue::~lsal_uring_queue()
+  {
+    void* tag;
+
+    if(ring_fd != -1) {
+      /* the kernel may still use the buffers of the requests in flight */
+      try {
+        while(Complete(tag))
+          ;
+      }
+      catch(...) {
+      }
+      munmap(sqes, sqes_size);
+      if(cq_ring != sq_ring)
+        munmap(cq_ring, cq_ring_size);
+      munmap(sq_ring, sq_ring_size);
+      close(ring_fd);
+    }
+    delete[] requests;
+    delete[] free_requests;
+  }
+
+  void
+  lsal_uring_queue::Queue(vsaddr blockno, vsbyte* buf, void* tag, int write)
+  {
+    struct io_uring_sqe* sqe;
+    unsigned tail, index;
+    int r;
+
+    if(blockno >= storage->block_num)
+      throw lsal::lsal_runtime_error("request address overflow: from lsal_uring_queue::Queue()");
+    Reserve();
+    r = free_requests[--free_num];
+    requests[r].tag = tag;
+    requests[r].buf = buf;
+    requests[r].blockno = blockno;
+    requests[r].write = write;
+
+    /* only this thread moves the tail of the submission ring */
+    tail = *sq_tail;
+    index = tail & *sq_mask;
+    sqe = (struct io_uring_sqe*)sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = file_fd;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = storage->block_size;
+    sqe->off = (__u64)blockno * storage->block_size;
+    sqe->user_data = r;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++queued;
+    ++pending;
+    return;
+  }
+
+  void
+  lsal_uring_queue::RdBlockAsync(vsaddr blockno, vsbyte* buf, void* tag)
+  {
+    if(ring_fd == -1 || (storage->Alignment() != 0 && ((size_t)buf & (storage->Alignment() - 1)) != 0))
+      lsal_queue::RdBlockAsync(blockno, buf, tag);
+    else
+      Queue(blockno, buf, tag, 0);
+    return;
+  }
+
+  void
+  lsal_uring_queue::WrBlockAsync(vsaddr blockno, vsbyte* buf, void* tag)
+  {
+    if(ring_fd == -1 || (storage->Alignment() != 0 && ((size_t)buf & (storage->Alignment() - 1)) != 0))
+      lsal_queue::WrBlockAsync(blockno, buf, tag);
+    else
+      Queue(blockno, buf, tag, 1);
+    return;
+  }
+
+  int
+  lsal_uring_queue::Submit()
+  {
+    int n, r;
+
+    /* the requests not on the ring run now */
+    for(n = lsal_queue::Submit(); queued > 0; ) {
+      if((r = syscall(__NR_io_uring_enter, ring_fd, queued, 0, 0, NULL, 0)) < 0) {
+        if(errno == EINTR || errno == EAGAIN || errno == EBUSY)
+          continue;
+        throw lsal::lsal_runtime_error("submitting the requests fail: from lsal_uring_queue::Submit()");
+      }
+      queued -= r;
+      n += r;
+    }
+    return n;
+  }
+
+  void
+  lsal_uring_queue::Finish(Request& req, int done)
+  {
+    off64_t off;
+    ssize_t r;
+
+    if(done < 0)
+      throw lsal::lsal_runtime_error(req.write ? "writing block fail: from lsal_uring_queue::Finish()"
+        : "reading block fail: from lsal_uring_queue::Finish()");
+    off = (off64_t)req.blockno * storage->block_size;
+    while(done < (int)storage->block_size) {
+      if(req.write)
+        r = pwrite64(file_fd, req.buf + done, storage->block_size - done, off + done);
+      else
+        r = pread64(file_fd, req.buf + done, storage->block_size - done, off + done);
+      if(r <= 0)
+        throw lsal::lsal_runtime_error(req.write ? "writing block fail: from lsal_uring_queue::Finish()"
+          : "reading block fail: from lsal_uring_queue::Finish()");
+      done += r;
+    }
+    return;
+  }
+
+  int
+  lsal_uring_queue::Complete(void*& tag)
+  {
+    struct io_uring_cqe* cqe;
+    unsigned head;
+    int r, res;
+
+    /* the requests not on the ring finish in lsal_queue */
+    if(ring_fd == -1 || done_num > 0 || waiting_num > 0)
+      return lsal_queue::Complete(tag);
+    if(pending == 0)
+      return 0;
+    if(queued > 0)
+      Submit();
+    head = *cq_head;
+    while(head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+      if(syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+        throw lsal::lsal_runtime_error("waiting for a request fail: from lsal_uring_queue::Complete()");
+    cqe = (struct io_uring_cqe*)cqes + (head & *cq_mask);
+    r = (int)cqe->user_data;
+    res = cqe->res;
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    free_requests[free_num++] = r;
+    --pending;
+    if(res != (int)storage->block_size)
+      Finish(requests[r], res);
+    tag = requests[r].tag;
+    return 1;
+  }
+
+} //end namespace vlaser
@@ -0,0 +1,198 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing Abstract Layer
+ * abstract class vlaser::mpal_framed
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#define SERREQSEND_TIMEOUT 300000 //microsecond, how long TrySerReqSend() waits the confirming
+
+#include "mpal_framed.h"
+#include <cstring>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class mpal_framed
+   */
+
+  mpal_framed::mpal_framed(vsnodeid id, vsnodeid num) :
+  mpal(id, num)
+  {
+    own_inbox = new mpal_inbox(num, MPAL_FRAMED_CHANNEL_NUM);
+    pinbox = own_inbox;
+    is_initialized = 0;
+    try_seq = 0;
+  }
+
+  mpal_framed::~mpal_framed()
+  {
+    delete own_inbox;
+  }
+
+  void
+  mpal_framed::DeliverTo(mpal_framed* owner)
+  {
+    if(is_initialized)
+      throw mpal_logic_error("changing inbox after initialized: from mpal_framed::DeliverTo()");
+    pinbox = owner->pinbox;
+    return;
+  }
+
+  inline void
+  mpal_framed::Take(int channel, vsnodeid source, int& tag, vsbyte* buf, int count)
+  {
+    mpal_inbox::Frame* f;
+
+    if(source >= node_num)
+      throw mpal_logic_error("waiting message from an error source: from mpal_framed::Take()");
+    f = pinbox->Take(channel, source);
+    memcpy(buf, f->data, (f->count < count) ? f->count : count);
+    tag = f->tag;
+    pinbox->FreeFrame(f);
+    return;
+  }
+
+  int
+  mpal_framed::ReqSend(vsnodeid dest, int tag, vsbyte* buf, int count)
+  {
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::ReqSend()");
+    if(dest >= node_num)
+      throw mpal_logic_error("sending message to an error dest: from mpal_framed::ReqSend()");
+    VLASER_DEB("Req sending "<<count<<" bytes REQ to node "<<dest<<" with tag "<<tag);
+    PostFrame(MPAL_REQ, dest, mpal_inbox::FRAME_DATA, tag, 0, buf, count);
+    return 0;
+  }
+
+  int
+  mpal_framed::WaitReq(vsnodeid& source, int& tag, vsbyte* buf, int count)
+  {
+    mpal_inbox::Frame* f;
+    unsigned int seq;
+    int kind;
+
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::WaitReq()");
+    VLASER_DEB("waiting REQ from any node");
+    f = pinbox->TakeAny(MPAL_REQ);
+    source = f->source;
+    tag = f->tag;
+    memcpy(buf, f->data, (f->count < count) ? f->count : count);
+    kind = f->kind;
+    seq = f->seq;
+    pinbox->FreeFrame(f);
+    if(kind == mpal_inbox::FRAME_TRY) {
+      /* tell the sender that the message is taken, and let it decide */
+      PostFrame(MPAL_REQ, source, mpal_inbox::FRAME_CONFIRM, 0, seq, NULL, 0);
+      if(pinbox->WaitDecision(source, seq) != mpal_inbox::FRAME_GO) {
+        VLASER_DEB("recieve SYN failed, return -1");
+        return -1;
+      }
+    }
+    VLASER_DEB("got REQ from "<<source<<" with tag "<<tag);
+    return 0;
+  }
+
+  int
+  mpal_framed::AckSend(vsnodeid dest, int tag, vsbyte* buf, int count)
+  {
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::AckSend()");
+    if(dest >= node_num)
+      throw mpal_logic_error("sending message to an error dest: from mpal_framed::AckSend()");
+    VLASER_DEB("Ack sending "<<count<<" bytes ACK to node "<<dest<<" with tag "<<tag);
+    PostFrame(MPAL_ACK, dest, mpal_inbox::FRAME_DATA, tag, 0, buf, count);
+    return 0;
+  }
+
+  int
+  mpal_framed::WaitAck(vsnodeid source, int& tag, vsbyte* buf, int count)
+  {
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::WaitAck()");
+    VLASER_DEB("waiting ACK from node "<<source);
+    Take(MPAL_ACK, source, tag, buf, count);
+    return 0;
+  }
+
+  int
+  mpal_framed::SerSend(vsnodeid dest, int tag, vsbyte* buf, int count)
+  {
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::SerSend()");
+    if(dest >= node_num)
+      throw mpal_logic_error("sending message to an error dest: from mpal_framed::SerSend()");
+    VLASER_DEB("Ser sending "<<count<<" bytes SER to node "<<dest<<" with tag "<<tag);
+    PostFrame(MPAL_SER, dest, mpal_inbox::FRAME_DATA, tag, 0, buf, count);
+    return 0;
+  }
+
+  int
+  mpal_framed::WaitSer(vsnodeid source, int& tag, vsbyte* buf, int count)
+  {
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::WaitSer()");
+    VLASER_DEB("waiting SER from node "<<source);
+    Take(MPAL_SER, source, tag, buf, count);
+    return 0;
+  }
+
+  int
+  mpal_framed::TrySerReqSend(vsnodeid dest, int tag, vsbyte* buf, int count)
+  {
+    unsigned int seq;
+
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::TrySerReqSend()");
+    if(dest >= node_num)
+      throw mpal_logic_error("sending message to an error dest: from mpal_framed::TrySerReqSend()");
+    VLASER_DEB("SerReq sending "<<count<<" bytes SERREQ to node "<<dest<<" with tag "<<tag);
+    seq = __sync_add_and_fetch(&try_seq, 1);
+    pinbox->Expect(dest, seq);
+    PostFrame(MPAL_REQ, dest, mpal_inbox::FRAME_TRY, tag, seq, buf, count);
+    if(!pinbox->WaitConfirm(dest, seq, SERREQSEND_TIMEOUT)) {
+      VLASER_DEB("wait SER confirming timeout, now return -1");
+      PostFrame(MPAL_REQ, dest, mpal_inbox::FRAME_CANCEL, 0, seq, NULL, 0);
+      return -1;
+    }
+    VLASER_DEB("got SER confirming");
+    PostFrame(MPAL_REQ, dest, mpal_inbox::FRAME_GO, 0, seq, NULL, 0);
+    return 0;
+  }
+
+  int
+  mpal_framed::TestOnFrames(unsigned char flag)
+  {
+    int result_flag = flag ? 1 : 0;
+    int tag;
+
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_framed::TestOnFrames()");
+    VLASER_DEB("entered TestOnFrames() with flag "<<(int)flag);
+    if(my_id == 0) {
+      /* collect every node's flag */
+      for(vsnodeid i = 1; i < node_num; ++i) {
+        Take(MPAL_CTL, i, tag, NULL, 0);
+        VLASER_DEB("got flag "<<tag<<" from node "<<i);
+        if(!tag)
+          result_flag = 0;
+      }
+      for(vsnodeid i = 1; i < node_num; ++i)
+        PostFrame(MPAL_CTL, i, mpal_inbox::FRAME_DATA, result_flag, 0, NULL, 0);
+    }
+    else {
+      PostFrame(MPAL_CTL, 0, mpal_inbox::FRAME_DATA, result_flag, 0, NULL, 0);
+      Take(MPAL_CTL, 0, result_flag, NULL, 0);
+    }
+    VLASER_DEB("TestOnFrames() ok, the result flag is "<<result_flag);
+    return result_flag;
+  }
+
+} //end namespace vlaser
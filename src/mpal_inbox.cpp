@@ -0,0 +1,214 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing Abstract Layer
+ * class vlaser::mpal_inbox
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  Keep only the expected confirmings, no timed out seq is kept
+ *
+ */
+
+#include "mpal_inbox.h"
+#include <sys/time.h>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class mpal_inbox
+   */
+
+  mpal_inbox::mpal_inbox(vsnodeid num, int chnum) :
+  node_num(num),
+  channel_num(chnum),
+  message_cond(inbox_mutex),
+  handshake_cond(inbox_mutex)
+  {
+    queues = new std::deque<Frame*>[chnum * num];
+    arrivals = new std::list<vsnodeid>[chnum];
+  }
+
+  mpal_inbox::~mpal_inbox()
+  {
+    for(int i = 0; i < channel_num * (int)node_num; ++i)
+      while(!queues[i].empty()) {
+        FreeFrame(queues[i].front());
+        queues[i].pop_front();
+      }
+    delete[] queues;
+    delete[] arrivals;
+  }
+
+  mpal_inbox::Frame*
+  mpal_inbox::NewFrame(int count)
+  {
+    Frame* f = new Frame;
+
+    f->count = count;
+    f->data = (count > 0) ? new vsbyte[count] : NULL;
+    return f;
+  }
+
+  void
+  mpal_inbox::FreeFrame(Frame* f)
+  {
+    delete[] f->data;
+    delete f;
+  }
+
+  void
+  mpal_inbox::Put(Frame* f)
+  {
+    std::deque<Frame*>::iterator q;
+    std::list<vsnodeid>::iterator a;
+    TypeOfSeqKey key(f->source, f->seq);
+
+    if(f->channel >= channel_num || f->source >= node_num) {
+      FreeFrame(f);
+      return;
+    }
+    inbox_mutex.lock();
+    switch(f->kind) {
+      case FRAME_DATA:
+      case FRAME_TRY:
+        queues[f->channel * node_num + f->source].push_back(f);
+        arrivals[f->channel].push_back(f->source);
+        message_cond.broadcast();
+        inbox_mutex.unlock();
+        return;
+
+      case FRAME_CONFIRM:
+        /* nobody waits a confirming which has timed out */
+        if(expected.count(key)) {
+          confirms.insert(key);
+          handshake_cond.broadcast();
+        }
+        break;
+
+      case FRAME_CANCEL:
+        /* if the cancelled message is still in queue, just drop it */
+        for(q = queues[f->channel * node_num + f->source].begin(); q != queues[f->channel * node_num + f->source].end(); ++q)
+          if((*q)->kind == FRAME_TRY && (*q)->seq == f->seq)
+            break;
+        if(q != queues[f->channel * node_num + f->source].end()) {
+          FreeFrame(*q);
+          queues[f->channel * node_num + f->source].erase(q);
+          for(a = arrivals[f->channel].begin(); *a != f->source; ++a)
+            ;
+          arrivals[f->channel].erase(a);
+        }
+        else {
+          /* the receiver is waiting the decision */
+          decisions[key] = f->kind;
+          handshake_cond.broadcast();
+        }
+        break;
+
+      case FRAME_GO:
+        decisions[key] = f->kind;
+        handshake_cond.broadcast();
+        break;
+    }
+    inbox_mutex.unlock();
+    FreeFrame(f);
+    return;
+  }
+
+  /* must be called with inbox_mutex locked */
+  inline mpal_inbox::Frame*
+  mpal_inbox::PopFrom(int channel, vsnodeid source)
+  {
+    std::list<vsnodeid>::iterator a;
+    Frame* f = queues[channel * node_num + source].front();
+
+    queues[channel * node_num + source].pop_front();
+    for(a = arrivals[channel].begin(); *a != source; ++a)
+      ;
+    arrivals[channel].erase(a);
+    return f;
+  }
+
+  mpal_inbox::Frame*
+  mpal_inbox::Take(int channel, vsnodeid source)
+  {
+    Frame* f;
+
+    inbox_mutex.lock();
+    while(queues[channel * node_num + source].empty())
+      message_cond.wait();
+    f = PopFrom(channel, source);
+    inbox_mutex.unlock();
+    return f;
+  }
+
+  mpal_inbox::Frame*
+  mpal_inbox::TakeAny(int channel)
+  {
+    Frame* f;
+
+    inbox_mutex.lock();
+    while(arrivals[channel].empty())
+      message_cond.wait();
+    f = PopFrom(channel, arrivals[channel].front());
+    inbox_mutex.unlock();
+    return f;
+  }
+
+  void
+  mpal_inbox::Expect(vsnodeid dest, unsigned int seq)
+  {
+    inbox_mutex.lock();
+    expected.insert(TypeOfSeqKey(dest, seq));
+    inbox_mutex.unlock();
+    return;
+  }
+
+  int
+  mpal_inbox::WaitConfirm(vsnodeid dest, unsigned int seq, int timeout)
+  {
+    struct timeval now;
+    struct timespec deadline;
+    TypeOfSeqKey key(dest, seq);
+
+    gettimeofday(&now, NULL);
+    deadline.tv_sec = now.tv_sec + timeout / 1000000;
+    deadline.tv_nsec = (now.tv_usec + timeout % 1000000) * 1000;
+    if(deadline.tv_nsec >= 1000000000) {
+      ++deadline.tv_sec;
+      deadline.tv_nsec -= 1000000000;
+    }
+    inbox_mutex.lock();
+    while(!confirms.erase(key))
+      if(!handshake_cond.timedwait(&deadline)) {
+        if(confirms.erase(key))
+          break;
+        /* a confirming after this is dropped by Put() */
+        expected.erase(key);
+        inbox_mutex.unlock();
+        return 0;
+      }
+    expected.erase(key);
+    inbox_mutex.unlock();
+    return 1;
+  }
+
+  int
+  mpal_inbox::WaitDecision(vsnodeid source, unsigned int seq)
+  {
+    std::map<TypeOfSeqKey, int>::iterator d;
+    TypeOfSeqKey key(source, seq);
+    int kind;
+
+    inbox_mutex.lock();
+    while((d = decisions.find(key)) == decisions.end())
+      handshake_cond.wait();
+    kind = d->second;
+    decisions.erase(d);
+    inbox_mutex.unlock();
+    return kind;
+  }
+
+} //end namespace vlaser
@@ -0,0 +1,87 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing Abstract Layer
+ * class vlaser::mpal_inproc
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#include "mpal_inproc.h"
+#include <cstring>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class mpal_inproc
+   */
+
+  mpal_inproc::mpal_inproc(vsnodeid id, vsnodeid num, mpal_inproc** nodes) :
+  mpal_framed(id, num)
+  {
+    if(nodes[id] != NULL)
+      throw mpal_logic_error("node id is used by another node: from mpal_inproc::mpal_inproc()");
+    peers = nodes;
+    peers[id] = this;
+    VLASER_DEB("got "<<num<<" nodes");
+  }
+
+  mpal_inproc::~mpal_inproc()
+  {
+    peers[my_id] = NULL;
+  }
+
+  int
+  mpal_inproc::Initialize()
+  {
+    VLASER_DEB("entered Initialize()");
+    if(is_initialized)
+      return 0;
+    for(vsnodeid i = 0; i < node_num; ++i)
+      if(peers[i] == NULL)
+        throw mpal_runtime_error("some node is not constructed yet: from mpal_inproc::Initialize()");
+    is_initialized = 1;
+    VLASER_DEB("Initialize() ok");
+    return 0;
+  }
+
+  int
+  mpal_inproc::Test(unsigned char flag)
+  {
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_inproc::Test()");
+    return TestOnFrames(flag);
+  }
+
+  int
+  mpal_inproc::Finalize()
+  {
+    is_initialized = 0;
+    VLASER_DEB("mpal_inproc Finalize() ok");
+    return 0;
+  }
+
+  void
+  mpal_inproc::PostFrame(int channel, vsnodeid dest, int kind, int tag, unsigned int seq, vsbyte* buf, int count)
+  {
+    mpal_inbox::Frame* f;
+
+    if(dest >= node_num)
+      throw mpal_logic_error("sending message to an error dest: from mpal_inproc::PostFrame()");
+    f = peers[dest]->pinbox->NewFrame(count);
+    f->channel = channel;
+    f->source = my_id;
+    f->kind = kind;
+    f->tag = tag;
+    f->seq = seq;
+    memcpy(f->data, buf, count);
+    peers[dest]->pinbox->Put(f);
+    VLASER_DEB("sent "<<dest<<" "<<count<<" bytes frame in PostFrame()");
+    return;
+  }
+
+} //end namespace vlaser
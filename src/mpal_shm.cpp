@@ -0,0 +1,459 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Message Passing Abstract Layer
+ * class vlaser::mpal_shm
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#define SHM_RING_SIZE (1 << 18) // bytes of a ring buffer, must be a power of 2
+#define SHM_SEG_HEAD_SIZE 128 // bytes reserved for SegHead at the beginning of a segment
+#define SHM_MAGIC 0x766c7368 // marks a segment whose creator has finished setting it up
+#define ATTACH_RETRY_INTERVAL 10000 // microsecond, retry interval of mapping a segment not yet created
+#define RING_FULL_INTERVAL 20 // microsecond, how long a sender sleeps on a full ring
+#define DOORBELL_TIMEOUT 100000000 // nanosecond, the longest sleep of an idle receive thread
+
+#include "mpal_shm.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class mpal_shm
+   */
+
+  mpal_shm::mpal_shm(vsnodeid id, vsnodeid num, char local_ids_path[], char shm_name[], mpal_framed* remote) :
+  mpal_framed(id, num)
+  {
+    if(remote != NULL && (remote->my_id != id || remote->node_num != num))
+      throw mpal_logic_error("remote transport is made for another node: from mpal_shm::mpal_shm()");
+    premote = remote;
+    if(premote != NULL)
+      premote->DeliverTo(this);
+    local_ids_file_path = local_ids_path;
+    shm_name_prefix = shm_name;
+    VLASER_DEB("got "<<num<<" nodes");
+    VLASER_DEB("local ids file is "<<local_ids_path);
+
+    is_local = new char[num];
+    pair_segs = new void*[num];
+    node_segs = new SegHead*[num];
+    tx_rings = new RingHead*[num];
+    tx_data = new unsigned char*[num];
+    tx_mutex = new vlamutex[num];
+    readers = new RingReader[num];
+    for(int i = 0; i < (int)num; ++i) {
+      is_local[i] = 0;
+      pair_segs[i] = NULL;
+      node_segs[i] = NULL;
+      readers[i].frame = NULL;
+    }
+    local_num = 0;
+    stop_flag = 0;
+  }
+
+  mpal_shm::~mpal_shm()
+  {
+    delete[] is_local;
+    delete[] pair_segs;
+    delete[] node_segs;
+    delete[] tx_rings;
+    delete[] tx_data;
+    delete[] tx_mutex;
+    delete[] readers;
+  }
+
+  void
+  mpal_shm::GetLocalIds()
+  {
+    std::ifstream local_ids(local_ids_file_path.c_str());
+    long id_tmp;
+
+    VLASER_DEB("enter GetLocalIds()");
+    if(!local_ids)
+      throw mpal_runtime_error("can not open local ids file: from mpal_shm::GetLocalIds()");
+    while(local_ids >> id_tmp) {
+      if(id_tmp < 0 || id_tmp >= node_num)
+        throw mpal_runtime_error("node id error in local ids file: from mpal_shm::GetLocalIds()");
+      if(!is_local[id_tmp]) {
+        is_local[id_tmp] = 1;
+        ++local_num;
+      }
+    }
+    local_ids.close();
+    if(!is_local[my_id])
+      throw mpal_runtime_error("my id is not in local ids file: from mpal_shm::GetLocalIds()");
+    if(premote == NULL && local_num != node_num)
+      throw mpal_runtime_error("some nodes are not on this host, but no remote transport: from mpal_shm::GetLocalIds()");
+    VLASER_DEB("GetLocalIds() ok, "<<local_num<<" nodes on this host");
+    return;
+  }
+
+  std::string
+  mpal_shm::SegmentName(vsnodeid a, vsnodeid b)
+  {
+    std::ostringstream name;
+
+    if(a == b)
+      name<<"/"<<shm_name_prefix<<"_node"<<a;
+    else
+      name<<"/"<<shm_name_prefix<<"_"<<a<<"_"<<b;
+    return name.str();
+  }
+
+  void*
+  mpal_shm::CreateSegment(const std::string& name, size_t size)
+  {
+    void* seg;
+    int fd;
+
+    /* a segment left by a crashed run is thrown away */
+    shm_unlink(name.c_str());
+    if((fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)) < 0)
+      throw mpal_runtime_error("can not create shared memory segment: from mpal_shm::CreateSegment()");
+    if(ftruncate(fd, size) != 0) {
+      close(fd);
+      throw mpal_runtime_error("can not size shared memory segment: from mpal_shm::CreateSegment()");
+    }
+    seg = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(seg == MAP_FAILED)
+      throw mpal_runtime_error("can not map shared memory segment: from mpal_shm::CreateSegment()");
+    /* ftruncate() has zeroed the segment, all rings are empty */
+    ((SegHead*)seg)->creator = getpid();
+    __atomic_store_n(&((SegHead*)seg)->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return seg;
+  }
+
+  void*
+  mpal_shm::OpenSegment(const std::string& name, size_t size)
+  {
+    struct stat st;
+    void* seg;
+    int fd;
+
+    while(1) {
+      if((fd = shm_open(name.c_str(), O_RDWR, 0600)) < 0) {
+        usleep(ATTACH_RETRY_INTERVAL);
+        continue;
+      }
+      if(fstat(fd, &st) != 0 || (size_t)st.st_size < size) {
+        close(fd);
+        usleep(ATTACH_RETRY_INTERVAL);
+        continue;
+      }
+      seg = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if(seg == MAP_FAILED)
+        throw mpal_runtime_error("can not map shared memory segment: from mpal_shm::OpenSegment()");
+      /* the creator must be alive, or it is a segment of a crashed run */
+      if(__atomic_load_n(&((SegHead*)seg)->magic, __ATOMIC_ACQUIRE) == SHM_MAGIC
+        && (kill(((SegHead*)seg)->creator, 0) == 0 || errno == EPERM)) {
+        __atomic_add_fetch(&((SegHead*)seg)->attached, 1, __ATOMIC_SEQ_CST);
+        return seg;
+      }
+      munmap(seg, size);
+      usleep(ATTACH_RETRY_INTERVAL);
+    }
+  }
+
+  void
+  mpal_shm::MapSegments()
+  {
+    size_t pair_size = SHM_SEG_HEAD_SIZE + 2 * (sizeof(RingHead) + SHM_RING_SIZE);
+    unsigned char* rings[2];
+
+    VLASER_DEB("enter MapSegments()");
+    /* create this node's segments first, so no node waits on another while holding its own back */
+    node_segs[my_id] = (SegHead*)CreateSegment(SegmentName(my_id, my_id), SHM_SEG_HEAD_SIZE);
+    for(vsnodeid p = my_id + 1; p < node_num; ++p)
+      if(is_local[p])
+        pair_segs[p] = CreateSegment(SegmentName(my_id, p), pair_size);
+    for(vsnodeid p = 0; p < node_num; ++p) {
+      if(!is_local[p] || p == my_id)
+        continue;
+      if(p < my_id)
+        pair_segs[p] = OpenSegment(SegmentName(p, my_id), pair_size);
+      node_segs[p] = (SegHead*)OpenSegment(SegmentName(p, p), SHM_SEG_HEAD_SIZE);
+
+      /* the ring of the lower id to the higher one goes first */
+      rings[0] = (unsigned char*)pair_segs[p] + SHM_SEG_HEAD_SIZE;
+      rings[1] = rings[0] + sizeof(RingHead) + SHM_RING_SIZE;
+      tx_rings[p] = (RingHead*)rings[(my_id < p) ? 0 : 1];
+      tx_data[p] = (unsigned char*)tx_rings[p] + sizeof(RingHead);
+      readers[p].ring = (RingHead*)rings[(my_id < p) ? 1 : 0];
+      readers[p].data = (unsigned char*)readers[p].ring + sizeof(RingHead);
+      readers[p].tail = 0;
+      readers[p].head_got = 0;
+      readers[p].frame = NULL;
+    }
+
+    /* unlink the names once every peer has mapped the segments */
+    while(__atomic_load_n(&node_segs[my_id]->attached, __ATOMIC_SEQ_CST) < (int)local_num - 1)
+      usleep(ATTACH_RETRY_INTERVAL);
+    shm_unlink(SegmentName(my_id, my_id).c_str());
+    for(vsnodeid p = my_id + 1; p < node_num; ++p)
+      if(is_local[p]) {
+        while(__atomic_load_n(&((SegHead*)pair_segs[p])->attached, __ATOMIC_SEQ_CST) < 1)
+          usleep(ATTACH_RETRY_INTERVAL);
+        shm_unlink(SegmentName(my_id, p).c_str());
+      }
+    VLASER_DEB("MapSegments() ok");
+    return;
+  }
+
+  int
+  mpal_shm::Initialize()
+  {
+    VLASER_DEB("entered Initialize()");
+    if(is_initialized)
+      return 0;
+    /* the remote transport sets up the nodes on all hosts first */
+    if(premote != NULL)
+      premote->Initialize();
+    GetLocalIds();
+    MapSegments();
+    stop_flag = 0;
+    if(pthread_create(&recv_thread_id, NULL, &mpal_shm::_recv_routine, this) != 0)
+      throw mpal_runtime_error("can not create receive thread: from mpal_shm::Initialize()");
+    is_initialized = 1;
+    VLASER_DEB("Initialize() ok");
+    return 0;
+  }
+
+  int
+  mpal_shm::Test(unsigned char flag)
+  {
+    if(!is_initialized)
+      throw mpal_logic_error("communication environment not initialized: mpal_shm::Test()");
+    if(premote != NULL)
+      return premote->Test(flag);
+    return TestOnFrames(flag);
+  }
+
+  int
+  mpal_shm::Finalize()
+  {
+    size_t pair_size = SHM_SEG_HEAD_SIZE + 2 * (sizeof(RingHead) + SHM_RING_SIZE);
+
+    if(is_initialized) {
+      if(premote != NULL)
+        premote->Finalize();
+      /* stop the receive thread first, then unmap all the segments */
+      stop_flag = 1;
+      Ring(my_id);
+      pthread_join(recv_thread_id, NULL);
+      for(vsnodeid p = 0; p < node_num; ++p) {
+        if(readers[p].frame != NULL) {
+          pinbox->FreeFrame(readers[p].frame);
+          readers[p].frame = NULL;
+        }
+        if(pair_segs[p] != NULL)
+          munmap(pair_segs[p], pair_size);
+        if(node_segs[p] != NULL)
+          munmap(node_segs[p], SHM_SEG_HEAD_SIZE);
+        pair_segs[p] = NULL;
+        node_segs[p] = NULL;
+      }
+      is_initialized = 0;
+      VLASER_DEB("mpal_shm Finalize() ok");
+    }
+    return 0;
+  }
+
+  void*
+  mpal_shm::_recv_routine(void* pclass)
+  {
+    ((mpal_shm*)pclass)->ReceiveThread();
+    return NULL;
+  }
+
+  void
+  mpal_shm::ReceiveThread()
+  {
+    SegHead* bell = node_segs[my_id];
+    struct timespec timeout;
+    int progress, v;
+
+    VLASER_DEB("enter ReceiveThread()");
+    while(!stop_flag) {
+      progress = 0;
+      for(vsnodeid p = 0; p < node_num; ++p)
+        if(pair_segs[p] != NULL && ReadRing(readers[p]))
+          progress = 1;
+      if(progress)
+        continue;
+
+      /* nothing to read, sleep on the doorbell. check the rings again
+       * after announcing the sleep, a sender who missed the announcement
+       * has written its frame before this check
+       */
+      v = __atomic_load_n(&bell->doorbell, __ATOMIC_SEQ_CST);
+      __atomic_store_n(&bell->sleeping, 1, __ATOMIC_SEQ_CST);
+      for(vsnodeid p = 0; p < node_num; ++p)
+        if(pair_segs[p] != NULL && __atomic_load_n(&readers[p].ring->head, __ATOMIC_SEQ_CST) != readers[p].tail)
+          progress = 1;
+      if(!progress && !stop_flag) {
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = DOORBELL_TIMEOUT;
+        syscall(SYS_futex, &bell->doorbell, FUTEX_WAIT, v, &timeout, NULL, 0);
+      }
+      __atomic_store_n(&bell->sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+    VLASER_DEB("receive thread exit");
+    return;
+  }
+
+  int
+  mpal_shm::ReadRing(RingReader& rd)
+  {
+    unsigned long long avail;
+    unsigned int off, c, part;
+    unsigned char* dst;
+
+    avail = __atomic_load_n(&rd.ring->head, __ATOMIC_ACQUIRE) - rd.tail;
+    if(avail == 0)
+      return 0;
+    while(avail > 0) {
+      if(rd.head_got < sizeof(FrameHead)) { /* still receiving the header */
+        dst = (unsigned char*)&rd.head + rd.head_got;
+        c = sizeof(FrameHead) - rd.head_got;
+      }
+      else {
+        dst = rd.frame->data + rd.body_got;
+        c = rd.head.count - rd.body_got;
+      }
+      if(c > avail)
+        c = avail;
+      off = rd.tail & (SHM_RING_SIZE - 1);
+      part = (c < SHM_RING_SIZE - off) ? c : SHM_RING_SIZE - off;
+      memcpy(dst, rd.data + off, part);
+      memcpy(dst + part, rd.data, c - part);
+      rd.tail += c;
+      avail -= c;
+      /* give the space back at once, a long message may not fit in the ring */
+      __atomic_store_n(&rd.ring->tail, rd.tail, __ATOMIC_RELEASE);
+
+      if(rd.head_got < sizeof(FrameHead)) {
+        rd.head_got += c;
+        if(rd.head_got < sizeof(FrameHead))
+          continue;
+        if(rd.head.count < 0)
+          throw mpal_runtime_error("broken frame in shared memory ring: from mpal_shm::ReadRing()");
+        rd.frame = pinbox->NewFrame(rd.head.count);
+        rd.frame->channel = rd.head.channel;
+        rd.frame->source = (vsnodeid)(&rd - readers);
+        rd.frame->kind = rd.head.kind;
+        rd.frame->tag = rd.head.tag;
+        rd.frame->seq = rd.head.seq;
+        rd.body_got = 0;
+      }
+      else
+        rd.body_got += c;
+      if(rd.body_got == rd.head.count) {
+        pinbox->Put(rd.frame);
+        rd.frame = NULL;
+        rd.head_got = 0;
+      }
+    }
+    return 1;
+  }
+
+  void
+  mpal_shm::RingWrite(vsnodeid dest, const unsigned char* src, int count)
+  {
+    RingHead* ring = tx_rings[dest];
+    unsigned long long head = ring->head;
+    unsigned int off, c, part;
+
+    while(count > 0) {
+      c = SHM_RING_SIZE - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+      if(c == 0) {
+        /* make sure the receiver is draining the ring */
+        Ring(dest);
+        usleep(RING_FULL_INTERVAL);
+        continue;
+      }
+      if(c > (unsigned int)count)
+        c = count;
+      off = head & (SHM_RING_SIZE - 1);
+      part = (c < SHM_RING_SIZE - off) ? c : SHM_RING_SIZE - off;
+      memcpy(tx_data[dest] + off, src, part);
+      memcpy(tx_data[dest], src + part, c - part);
+      head += c;
+      src += c;
+      count -= c;
+      __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+    return;
+  }
+
+  void
+  mpal_shm::Ring(vsnodeid dest)
+  {
+    SegHead* bell = node_segs[dest];
+
+    __atomic_add_fetch(&bell->doorbell, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&bell->sleeping, __ATOMIC_SEQ_CST))
+      syscall(SYS_futex, &bell->doorbell, FUTEX_WAKE, 1, NULL, NULL, 0);
+    return;
+  }
+
+  void
+  mpal_shm::PostFrame(int channel, vsnodeid dest, int kind, int tag, unsigned int seq, vsbyte* buf, int count)
+  {
+    mpal_inbox::Frame* f;
+    FrameHead head;
+
+    if(dest >= node_num)
+      throw mpal_logic_error("sending message to an error dest: from mpal_shm::PostFrame()");
+    if(dest == my_id) {
+      /* message to myself goes to the inbox directly */
+      f = pinbox->NewFrame(count);
+      f->channel = channel;
+      f->source = my_id;
+      f->kind = kind;
+      f->tag = tag;
+      f->seq = seq;
+      memcpy(f->data, buf, count);
+      pinbox->Put(f);
+      return;
+    }
+    if(!is_local[dest]) {
+      if(premote == NULL)
+        throw mpal_logic_error("no transport to the dest: from mpal_shm::PostFrame()");
+      premote->PostFrame(channel, dest, kind, tag, seq, buf, count);
+      return;
+    }
+    head.channel = channel;
+    head.kind = kind;
+    head.tag = tag;
+    head.count = count;
+    head.seq = seq;
+    tx_mutex[dest].lock();
+    RingWrite(dest, (unsigned char*)&head, sizeof(FrameHead));
+    RingWrite(dest, buf, count);
+    tx_mutex[dest].unlock();
+    Ring(dest);
+    VLASER_DEB("sent "<<dest<<" "<<count<<" bytes frame in PostFrame()");
+    return;
+  }
+
+} //end namespace vlaser
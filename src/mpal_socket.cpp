@@ -8,6 +8,13 @@
  * Source File
  *
  * Mar 26, 2011  Original Design
+ * Oct 17, 2026  Keep one persistent framed connection per
+ *               peer and channel instead of connecting
+ *               for every message.
+ * Oct 17, 2026  Receive all connections with an epoll thread
+ *               into class mpal_inbox.
+ * Oct 17, 2026  Derive from class mpal_framed, which now keeps
+ *               the message and handshake protocol.
  *
  */
 
@@ -16,25 +23,31 @@
 #define SER_LISTEN 2013
 #define CTL_LISTEN 2014
 #define REQ_QUEUE_SIZE 128 // request listen socket's accept() queue size
-#define ACK_QUEUE_SIZE 1
-#define SER_QUEUE_SIZE 1
+#define ACK_QUEUE_SIZE 128
+#define SER_QUEUE_SIZE 128
 #define CTL_QUEUE_SIZE 128
-#define SERREQSEND_TIMEOUT 300000 //microsecond, timeout for SerReqSend's socket sendibg
 #define TIMEOUT_RETRY_INTERVAL 50000 // microsecond, reconnect interval of socket connection failure
 #define TCP_SEND_FLAG MSG_DONTROUTE // do not route tcp package out of subnet
 #define TCP_RECV_FLAG MSG_WAITALL // block the recieve function until the recv buffer is full or tcp is closed
 #define TCP_SEND_BUFFER_SIZE 4096 // how many bytes will be sent for socket sending
+#define EPOLL_EVENT_NUM 64 // how many ready connections are got by one epoll_wait()
 
 
 #include "mpal_socket.h"
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <errno.h>
 #include <unistd.h>
 #include <signal.h>
+#include <pthread.h>
+#include <cstring>
+#include <iostream>
 #include <fstream>
 #include <set>
 
@@ -45,7 +58,7 @@ namespace vlaser {
    */
 
   mpal_socket::mpal_socket(vsnodeid id, vsnodeid num, char my_addr_path[], char hosts_addr_path[]) :
-  mpal(id, num)
+  mpal_framed(id, num)
   {
     id_map_vlaser_to_inet = new my_inet_addr_t[num];
     addr_list = new my_inet_addr_t[num];
@@ -59,14 +72,30 @@ namespace vlaser {
     ack_channel_port = htons(ACK_LISTEN);
     ser_channel_port = htons(SER_LISTEN);
     ctl_channel_port = htons(CTL_LISTEN);
-    is_initialized = 0;
     is_busy = 0;
+
+    out_socks = new int[MPAL_CHANNEL_NUM * num];
+    in_socks = new int[MPAL_CHANNEL_NUM * num];
+    for(int i = 0; i < MPAL_CHANNEL_NUM * (int)num; ++i) {
+      out_socks[i] = -1;
+      in_socks[i] = -1;
+    }
+    out_mutex = new vlamutex[MPAL_CHANNEL_NUM * num];
+    confirm_mutex = new vlamutex[num];
+    conns = new Connection[(MPAL_CHANNEL_NUM + 1) * num];
+    epoll_fd = -1;
+    wake_fd = -1;
   }
 
   mpal_socket::~mpal_socket()
   {
     delete[] addr_list;
     delete[] id_map_vlaser_to_inet;
+    delete[] out_socks;
+    delete[] in_socks;
+    delete[] out_mutex;
+    delete[] confirm_mutex;
+    delete[] conns;
   }
   
   void
@@ -104,6 +133,7 @@ namespace vlaser {
   mpal_socket::PrepareSocks()
   {
     struct sockaddr_in channel;
+    int opt;
 
     /* create, bind, and listen all three channel's listen sockets */
     VLASER_DEB("enter PrepareSocks()");
@@ -115,6 +145,14 @@ namespace vlaser {
       throw mpal_runtime_error("getting ser_listen_socket failed: from mpal_socket::PrepareSocks()");
     if((ctl_listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
       throw mpal_runtime_error("getting ctl_listen_socket failed: from mpal_socket::PrepareSocks()");
+    /* persistent connections leave TIME_WAIT sockets on the listen ports after
+     * Finalize(), allow binding them again when the node restarts
+     */
+    opt = 1;
+    setsockopt(req_listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(int));
+    setsockopt(ack_listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(int));
+    setsockopt(ser_listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(int));
+    setsockopt(ctl_listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(int));
     channel.sin_family = AF_INET;
     channel.sin_addr.s_addr = my_inet_addr;
     channel.sin_port = req_channel_port;
@@ -286,9 +324,110 @@ namespace vlaser {
       close(socktmp);
     }
     is_initialized = 1;
+    /* every node has got the id table, now set up the persistent connections */
+    MakeMesh();
     VLASER_DEB("Initialize() ok");
     return 0;
   }
+
+  void*
+  mpal_socket::_accept_routine(void* pclass)
+  {
+    ((mpal_socket*)pclass)->AcceptMesh();
+    return NULL;
+  }
+
+  void
+  mpal_socket::AcceptMesh()
+  {
+    int listen_socks[MPAL_CHANNEL_NUM];
+    int socktmp, i;
+    vsnodeid id_tmp;
+
+    listen_socks[MPAL_REQ] = req_listen_socket;
+    listen_socks[MPAL_ACK] = ack_listen_socket;
+    listen_socks[MPAL_SER] = ser_listen_socket;
+    /* every node, this node included, connects each channel exactly once */
+    for(int c = 0; c < MPAL_CHANNEL_NUM; ++c)
+      for(int k = 0; k < (int)node_num; ++k) {
+        if((socktmp = accept(listen_socks[c], NULL, NULL)) < 0)
+          continue;
+        i = 1;
+        setsockopt(socktmp, IPPROTO_TCP, TCP_NODELAY, &i, sizeof(int));
+        if(recv(socktmp, &id_tmp, sizeof(vsnodeid), TCP_RECV_FLAG) != sizeof(vsnodeid) || id_tmp >= node_num
+          || in_socks[c * node_num + id_tmp] != -1) {
+          close(socktmp);
+          continue;
+        }
+        VLASER_DEB("accepted channel "<<c<<" connection from node "<<id_tmp);
+        in_socks[c * node_num + id_tmp] = socktmp;
+      }
+    return;
+  }
+
+  void
+  mpal_socket::MakeMesh()
+  {
+    struct sockaddr_in paddr;
+    my_inet_port_t ports[MPAL_CHANNEL_NUM];
+    pthread_t accept_thread;
+    struct epoll_event ev;
+    int cflag, the_socket, i;
+
+    VLASER_DEB("enter MakeMesh()");
+    ports[MPAL_REQ] = req_channel_port;
+    ports[MPAL_ACK] = ack_channel_port;
+    ports[MPAL_SER] = ser_channel_port;
+    if(pthread_create(&accept_thread, NULL, &mpal_socket::_accept_routine, this) != 0)
+      throw mpal_runtime_error("can not create accepting thread: from mpal_socket::MakeMesh()");
+    /* make sure that no node is still waiting the id table on its listen sockets */
+    Test(1);
+    for(int c = 0; c < MPAL_CHANNEL_NUM; ++c)
+      for(vsnodeid dest = 0; dest < node_num; ++dest) {
+        paddr.sin_family = AF_INET;
+        paddr.sin_addr.s_addr = id_map_vlaser_to_inet[dest];
+        paddr.sin_port = ports[c];
+        if((the_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
+          throw mpal_runtime_error("getting mesh socket failed: from mpal_socket::MakeMesh()");
+        i = 1;
+        if(setsockopt(the_socket, IPPROTO_TCP, TCP_NODELAY, &i, sizeof(int)) < 0)
+          throw mpal_runtime_error("set mesh socket tcp_nodelay error: from mpal_socket::MakeMesh()");
+        while((cflag = connect(the_socket, (struct sockaddr *)&paddr, sizeof(paddr))) != 0 && (errno == ETIMEDOUT || errno == ECONNREFUSED))
+          usleep(TIMEOUT_RETRY_INTERVAL);
+        if(cflag < 0)
+          throw mpal_runtime_error("mesh connecting failed: from mpal_socket::MakeMesh()");
+        if(send(the_socket, &my_id, sizeof(vsnodeid), TCP_SEND_FLAG) != sizeof(vsnodeid))
+          throw mpal_runtime_error("send less bytes than expected when sending my_id: from mpal_socket::MakeMesh()");
+        out_socks[c * node_num + dest] = the_socket;
+      }
+    pthread_join(accept_thread, NULL);
+    for(int i = 0; i < MPAL_CHANNEL_NUM * (int)node_num; ++i)
+      if(in_socks[i] == -1)
+        throw mpal_runtime_error("some node did not connect all its channels: from mpal_socket::MakeMesh()");
+
+    /* watch all incoming connections, and the outgoing request connections for the confirmings */
+    if((epoll_fd = epoll_create1(0)) < 0 || (wake_fd = eventfd(0, 0)) < 0)
+      throw mpal_runtime_error("can not create epoll instance: from mpal_socket::MakeMesh()");
+    for(int i = 0; i < (MPAL_CHANNEL_NUM + 1) * (int)node_num; ++i) {
+      conns[i].sock = (i < MPAL_CHANNEL_NUM * (int)node_num) ? in_socks[i] : out_socks[MPAL_REQ * node_num + i % node_num];
+      conns[i].channel = (i < MPAL_CHANNEL_NUM * (int)node_num) ? i / (int)node_num : (int)MPAL_REQ;
+      conns[i].peer = i % node_num;
+      conns[i].head_got = 0;
+      conns[i].frame = NULL;
+      ev.events = EPOLLIN;
+      ev.data.u32 = i;
+      if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conns[i].sock, &ev) != 0)
+        throw mpal_runtime_error("can not watch a connection: from mpal_socket::MakeMesh()");
+    }
+    ev.events = EPOLLIN;
+    ev.data.u32 = (MPAL_CHANNEL_NUM + 1) * node_num; /* the wake up event */
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) != 0)
+      throw mpal_runtime_error("can not watch the wake up event: from mpal_socket::MakeMesh()");
+    if(pthread_create(&recv_thread_id, NULL, &mpal_socket::_recv_routine, this) != 0)
+      throw mpal_runtime_error("can not create receive thread: from mpal_socket::MakeMesh()");
+    VLASER_DEB("MakeMesh() ok");
+    return;
+  }
   
   int
   mpal_socket::Test(unsigned char flag)
@@ -383,246 +522,187 @@ namespace vlaser {
   int
   mpal_socket::Finalize()
   {
+    uint64_t one = 1;
+
     if(is_initialized) {
       while(is_busy)
         usleep(10000);
+      /* stop the receive thread first, then close all the connections */
+      if(write(wake_fd, &one, sizeof(one)) != sizeof(one))
+        throw mpal_runtime_error("can not wake up the receive thread: from mpal_socket::Finalize()");
+      pthread_join(recv_thread_id, NULL);
+      close(epoll_fd);
+      close(wake_fd);
       close(req_listen_socket);
       close(ack_listen_socket);
       close(ser_listen_socket);
       close(ctl_listen_socket);
+      for(int i = 0; i < MPAL_CHANNEL_NUM * (int)node_num; ++i) {
+        if(out_socks[i] != -1)
+          close(out_socks[i]);
+        if(in_socks[i] != -1)
+          close(in_socks[i]);
+        out_socks[i] = in_socks[i] = -1;
+      }
+      for(int i = 0; i < (MPAL_CHANNEL_NUM + 1) * (int)node_num; ++i)
+        if(conns[i].frame != NULL) {
+          pinbox->FreeFrame(conns[i].frame);
+          conns[i].frame = NULL;
+        }
       is_initialized = 0;
       VLASER_DEB("mpal_socket Finalize() ok");
     }
     return 0;
   }
-  
-  inline int
-  mpal_socket::SendProto(my_inet_port_t the_port, vsnodeid dest, int tag, vsbyte* buf, int count)
-  {
-    struct sockaddr_in paddr;
-    int cflag, the_socket, c, i;
-    int send_counter;
-    unsigned char* pbuf;
-    
-    if(dest >= node_num)
-      throw mpal_logic_error("sending message to an error dest: from mpal_socket::SendProto()");
-    paddr.sin_family = AF_INET;
-    paddr.sin_addr.s_addr = id_map_vlaser_to_inet[dest];
-    paddr.sin_port = the_port;
-    if((the_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
-      throw mpal_runtime_error("getting send_socket failed: from mpal_socket::SendProto()");
-    i = 1;
-    if(setsockopt(the_socket, IPPROTO_TCP, TCP_NODELAY, &i, sizeof(int)) < 0)
-      throw mpal_runtime_error("set send_socket tcp_nodelay error: from mpal_socket::SendProto()");
-    VLASER_DEB("connecting "<<dest<<" in SendProto()");
-    while((cflag = connect(the_socket, (struct sockaddr *)&paddr, sizeof(paddr))) != 0 && errno == ETIMEDOUT)
-      usleep(TIMEOUT_RETRY_INTERVAL);
-    if(cflag < 0)
-      throw mpal_runtime_error("req send connecting failed: from mpal_socket::SendProto()");
-
-    if(send(the_socket, &my_id, sizeof(vsnodeid), TCP_SEND_FLAG) != sizeof(vsnodeid))
-      throw mpal_runtime_error("send less bytes than expected when sending my_id: from mpal_socket::SendProto()");
-    c = recv(the_socket, &i, sizeof(vsnodeid), TCP_RECV_FLAG);
-    if(c != sizeof(int))
-      throw mpal_runtime_error("lost send confirming: from mpal_socket::SendProto()");
-
-    VLASER_DEB("got send confirming");
-    if(send(the_socket, &tag, sizeof(int), TCP_SEND_FLAG) != sizeof(int))
-      throw mpal_runtime_error("send less bytes than expected when sending tag: from mpal_socket::SendProto()");
-    pbuf = (unsigned char*)buf;
-    send_counter = count;
-    while(send_counter > 0)
-      if(send_counter < TCP_SEND_BUFFER_SIZE) {
-        c = send(the_socket, pbuf, send_counter, TCP_SEND_FLAG);
-        if(c != send_counter)
-          throw mpal_runtime_error("socket sent less bytes than expected: from mpal_socket::SendProto()");
-        send_counter = 0;
-      }
-      else {
-        c = send(the_socket, pbuf, TCP_SEND_BUFFER_SIZE, TCP_SEND_FLAG);
-        if(c != TCP_SEND_BUFFER_SIZE)
-          throw mpal_runtime_error("socket sent less bytes than expected: from mpal_socket::SendProto()");
-        pbuf += TCP_SEND_BUFFER_SIZE;
-        send_counter -= TCP_SEND_BUFFER_SIZE;
-      }
-    VLASER_DEB("sent "<<dest<<" "<<count<<" bytes message in SendProto()");
-    close(the_socket);
-    return 0;
-  }
-
-  inline int
-  mpal_socket::RecvProto(int the_socket, vsnodeid& source, int& tag, vsbyte* buf, int count)
-  {
-    int recv_sock;
-    int c, i;
-
-    VLASER_DEB("waiting in RecvProto()");
-    recv_sock = accept(the_socket, NULL, NULL); /* accept a incoming connection from any source */
-    i = 1;
-    if(setsockopt(recv_sock, IPPROTO_TCP, TCP_NODELAY, &i, sizeof(int)) < 0)
-      throw mpal_runtime_error("set recv_sock tcp_nodelay error: from mpal_socket::RecvProtoSend()");
-    /* get the client's vlaser id */
-    c = recv(recv_sock, &source, sizeof(vsnodeid), TCP_RECV_FLAG);
-    if(c != sizeof(vsnodeid))
-      throw mpal_runtime_error("receive failed as cannot get source id: from mpal_socket::RecvProto()");
-    i = send(recv_sock, &source, sizeof(vsnodeid), TCP_SEND_FLAG);
-    if(i == -1) {
-      close(recv_sock);
-      VLASER_DEB("recieve SYN failed, return -1");
-      return -1;
-    }
-    /* get the message tag */
-    c = recv(recv_sock, &i, sizeof(int), TCP_RECV_FLAG);
-    if(c != sizeof(int))
-      throw mpal_runtime_error("receive failed as cannot get source id: from mpal_socket::RecvProto()");
-    if(i == -1) {
-      close(recv_sock);
-      VLASER_DEB("recieve SYN failed, return -1");
-      return -1;
-    }
-    tag = i;
-
-    c = recv(recv_sock, buf, count, TCP_RECV_FLAG);
-    close(recv_sock);
-    VLASER_DEB("received "<<c<<" bytes from "<<source<<" with tag "<<tag<<" in RecvProto() with recv confirming return value is "<<source);
-    return 0;
-  }
-
-  int
-  mpal_socket::ReqSend(vsnodeid dest, int tag, vsbyte* buf, int count)
-  {
-    if(is_initialized) {
-      VLASER_DEB("Req sending "<<count<<" bytes REQ to node "<<dest<<" with tag "<<tag);
-      return SendProto(req_channel_port, dest, tag, buf, count);
-    }
-    else
-      throw mpal_logic_error("communication environment not initialized: mpal_socket::ReqSend()");
-  }
-
 
-  int
-  mpal_socket::WaitReq(vsnodeid& source, int& tag, vsbyte* buf, int count)
+  void*
+  mpal_socket::_recv_routine(void* pclass)
   {
-    if(is_initialized) {
-      VLASER_DEB("waiting REQ from any node");
-      return RecvProto(req_listen_socket, source, tag, buf, count);
-    }
-    else
-      throw mpal_logic_error("communication environment not initialized: mpal_socket::WaitReq()");
+    ((mpal_socket*)pclass)->ReceiveThread();
+    return NULL;
   }
 
-  int
-  mpal_socket::AckSend(vsnodeid dest, int tag, vsbyte* buf, int count)
+  void
+  mpal_socket::ReceiveThread()
   {
-    if(is_initialized) {
-      VLASER_DEB("Ack sending "<<count<<" bytes ACK to node "<<dest<<" with tag "<<tag);
-      return SendProto(ack_channel_port, dest, tag, buf, count);
+    struct epoll_event evs[EPOLL_EVENT_NUM];
+    int n;
+
+    VLASER_DEB("enter ReceiveThread()");
+    while(1) {
+      n = epoll_wait(epoll_fd, evs, EPOLL_EVENT_NUM, -1);
+      if(n < 0) {
+        if(errno == EINTR)
+          continue;
+        std::cout<<"|FATAL| epoll_wait failed in mpal_socket::ReceiveThread()"<<std::endl;
+        return;
+      }
+      for(int i = 0; i < n; ++i) {
+        if(evs[i].data.u32 == (MPAL_CHANNEL_NUM + 1) * node_num) {
+          VLASER_DEB("receive thread exit");
+          return;
+        }
+        if(ReadConnection(conns[evs[i].data.u32]) == -1) {
+          /* the node has finalized, stop watching it */
+          VLASER_DEB("node "<<conns[evs[i].data.u32].peer<<" closed its channel "<<conns[evs[i].data.u32].channel<<" connection");
+          epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conns[evs[i].data.u32].sock, NULL);
+        }
+      }
     }
-    else
-      throw mpal_logic_error("communication environment not initialized: mpal_socket::AckSend()");  
   }
 
   int
-  mpal_socket::WaitAck(vsnodeid source, int& tag, vsbyte* buf, int count)
+  mpal_socket::ReadConnection(Connection& conn)
   {
-    vsnodeid source_comp;
-
-    if(is_initialized) {
-      VLASER_DEB("waiting ACK from node "<<source);
-      RecvProto(ack_listen_socket, source_comp, tag, buf, count);
-      if(source_comp != source)
-        throw mpal_runtime_error("received an unexpected source's Ack: mpal_socket::WaitAck()");
-      return 0;
+    int c;
+
+    while(1) {
+      if(conn.head_got < (int)sizeof(FrameHead)) /* still receiving the header */
+        c = recv(conn.sock, (unsigned char*)&conn.head + conn.head_got, sizeof(FrameHead) - conn.head_got, MSG_DONTWAIT);
+      else if(conn.body_got < conn.head.count)
+        c = recv(conn.sock, conn.frame->data + conn.body_got, conn.head.count - conn.body_got, MSG_DONTWAIT);
+      else
+        c = 0; /* a complete frame with an empty message, nothing to read */
+
+      if(c < 0) {
+        if(errno == EINTR)
+          continue;
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+          return 0;
+        return -1;
+      }
+      if(conn.head_got < (int)sizeof(FrameHead)) {
+        if(c == 0)
+          return -1;
+        conn.head_got += c;
+        if(conn.head_got < (int)sizeof(FrameHead))
+          continue;
+        if(conn.head.count < 0)
+          return -1;
+        conn.frame = pinbox->NewFrame(conn.head.count);
+        conn.frame->channel = conn.channel;
+        conn.frame->source = conn.peer;
+        conn.frame->kind = conn.head.kind;
+        conn.frame->tag = conn.head.tag;
+        conn.frame->seq = conn.head.seq;
+        conn.body_got = 0;
+      }
+      else if(c == 0 && conn.body_got < conn.head.count)
+        return -1;
+      else
+        conn.body_got += c;
+      if(conn.body_got == conn.head.count) {
+        pinbox->Put(conn.frame);
+        conn.frame = NULL;
+        conn.head_got = 0;
+      }
     }
-    else
-      throw mpal_logic_error("communication environment not initialized: mpal_socket::WaitAck()");
   }
 
+  /* send one frame to the_socket's peer,
+   * caller must hold the socket's out_mutex if the socket is shared
+   */
   int
-  mpal_socket::SerSend(vsnodeid dest, int tag, vsbyte* buf, int count)
-  {
-    if(is_initialized) {
-      VLASER_DEB("Ser sending "<<count<<" bytes SER to node "<<dest<<" with tag "<<tag);
-      return SendProto(ser_channel_port, dest, tag, buf, count);
-    }
-    else
-      throw mpal_logic_error("communication environment not initialized: mpal_socket::SerSend()");  
-  }
-  
-  int
-  mpal_socket::WaitSer(vsnodeid source, int& tag, vsbyte* buf, int count)
+  mpal_socket::SendFrame(int the_socket, int kind, int tag, unsigned int seq, vsbyte* buf, int count)
   {
-    vsnodeid source_comp;
-
-    if(is_initialized) {
-      VLASER_DEB("waiting SER from node "<<source);
-      RecvProto(ser_listen_socket, source_comp, tag, buf, count);
-      if(source_comp != source)
-        throw mpal_runtime_error("received an unexpected source's Ack: mpal_socket::WaitSer()");
-      return 0;
+    FrameHead head;
+    struct iovec iov[2];
+    struct msghdr msg;
+    int iovcnt, c;
+
+    head.kind = kind;
+    head.tag = tag;
+    head.count = count;
+    head.seq = seq;
+    iov[0].iov_base = &head;
+    iov[0].iov_len = sizeof(FrameHead);
+    iov[1].iov_base = buf;
+    iov[1].iov_len = count;
+    iovcnt = (count > 0) ? 2 : 1;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    /* header and message go out with one system call in most cases */
+    while(iovcnt > 0) {
+      msg.msg_iovlen = iovcnt;
+      c = sendmsg(the_socket, &msg, TCP_SEND_FLAG | MSG_NOSIGNAL);
+      if(c < 0) {
+        if(errno == EINTR)
+          continue;
+        throw mpal_runtime_error("socket sending failed: from mpal_socket::SendFrame()");
+      }
+      while(iovcnt > 0 && c >= (int)msg.msg_iov->iov_len) {
+        c -= msg.msg_iov->iov_len;
+        ++msg.msg_iov;
+        --iovcnt;
+      }
+      if(iovcnt > 0) {
+        msg.msg_iov->iov_base = (unsigned char*)msg.msg_iov->iov_base + c;
+        msg.msg_iov->iov_len -= c;
+      }
     }
-    else
-      throw mpal_logic_error("communication environment not initialized: mpal_socket::WaitSer()");
+    return 0;
   }
 
-  int
-  mpal_socket::TrySerReqSend(vsnodeid dest, int tag, vsbyte* buf, int count)
+  void
+  mpal_socket::PostFrame(int channel, vsnodeid dest, int kind, int tag, unsigned int seq, vsbyte* buf, int count)
   {
-    struct sockaddr_in paddr;
-    int cflag, the_socket, c, i;
-    int send_counter;
-    unsigned char* pbuf;
-    struct timeval myto;
-    struct linger mylinger;
-
-    VLASER_DEB("SerReq sending "<<count<<" bytes SERREQ to node "<<dest<<" with tag "<<tag);
-    if(is_initialized) {
-      if(dest >= node_num)
-        throw mpal_logic_error("sending message to an error dest: from mpal_socket::TrySerReqSend()");
-      paddr.sin_family = AF_INET;
-      paddr.sin_addr.s_addr = id_map_vlaser_to_inet[dest];
-      paddr.sin_port = req_channel_port;
-      if((the_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
-        throw mpal_runtime_error("getting send_socket failed: from mpal_socket::TrySerReqSend()");
-      i = 1;
-      if(setsockopt(the_socket, IPPROTO_TCP, TCP_NODELAY, &i, sizeof(int)) < 0)
-        throw mpal_runtime_error("set send_socket tcp_nodelay error: from mpal_socket::TrySerReqSend()");
-      myto.tv_sec = SERREQSEND_TIMEOUT / 1000000;
-      myto.tv_usec = SERREQSEND_TIMEOUT % 1000000;
-      if(setsockopt(the_socket, SOL_SOCKET, SO_RCVTIMEO, &myto, sizeof(myto)) < 0)
-        throw mpal_runtime_error("set send_socket receive timeout sockopt failed: from mpal_socket::TrySerReqSend()");
-      VLASER_DEB("connecting "<<dest<<" in SerReqSend()");
-      while((cflag = connect(the_socket, (struct sockaddr *)&paddr, sizeof(paddr))) != 0 && errno == ETIMEDOUT)
-        usleep(TIMEOUT_RETRY_INTERVAL);
-      if(cflag < 0)
-        throw mpal_runtime_error("req send connecting failed: from mpal_socket::TrySerReqSend()");
-
-      if(send(the_socket, &my_id, sizeof(vsnodeid), TCP_SEND_FLAG) != sizeof(vsnodeid))
-        throw mpal_runtime_error("send less bytes than expected when sending my_id: from mpal_socket::TrySerReqSend()");
-      VLASER_DEB("sent "<<dest<<" SER message in SerReqSend(), now wait the SER confirming");
-      c = recv(the_socket, &i, sizeof(vsnodeid), TCP_RECV_FLAG);
-      if(c == -1) {
-        VLASER_DEB("wait SER confirming timeout, now return -1");
-        i = -1;
-        c = send(the_socket, &i, sizeof(int), TCP_SEND_FLAG);
-        if(c != sizeof(int))
-          throw mpal_logic_error("sending -1 tag failure message error: from mpal_socket::TrySerReqSend()");
-        close(the_socket);
-        return -1;
-      }
-      if(c != sizeof(vsnodeid))
-        throw mpal_logic_error("received broken SER confirming: from mpal_socket::TrySerReqSend()");
-
-      VLASER_DEB("got SER confirming");
-      if(send(the_socket, &tag, sizeof(int), TCP_SEND_FLAG) != sizeof(int))
-        throw mpal_runtime_error("send less bytes than expected when sending tag: from mpal_socket::TrySerReqSend()");
-      if(send(the_socket, buf, count, TCP_SEND_FLAG) != count)
-        throw mpal_runtime_error("send less bytes than expected when sending message: from mpal_socket::TrySerReqSend()");
-      close(the_socket);
+    int i;
+
+    if(channel >= MPAL_CHANNEL_NUM)
+      throw mpal_logic_error("no connection for the channel: from mpal_socket::PostFrame()");
+    if(kind == mpal_inbox::FRAME_CONFIRM) {
+      /* confirmings go back on the request connection the FRAME_TRY came from */
+      confirm_mutex[dest].lock();
+      SendFrame(in_socks[MPAL_REQ * node_num + dest], kind, tag, seq, buf, count);
+      confirm_mutex[dest].unlock();
+      return;
     }
-    else
-      throw mpal_logic_error("communication environment not initialized: mpal_socket::TrySerReqSend()");
-    return 0;
+    i = channel * node_num + dest;
+    out_mutex[i].lock();
+    SendFrame(out_socks[i], kind, tag, seq, buf, count);
+    out_mutex[i].unlock();
+    VLASER_DEB("sent "<<dest<<" "<<count<<" bytes frame in PostFrame()");
+    return;
   }
 
 } //end namespace vlaser
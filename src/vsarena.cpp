@@ -0,0 +1,179 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Memory Arenas
+ * class vlaser::vsarena
+ * class vlaser::vsbufpool
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  vsbufpool buffers aligned as asked, also those from the heap.
+ *
+ */
+
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024) //the huge page size mapped and aligned to
+#define ARENA_NUMA_NODE_MAX 1024 //largest NUMA node id the node mask holds
+#define ARENA_BUF_ALIGN 64 //buffers of a vsbufpool start on cache lines
+
+#include "vsarena.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <cstring>
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+namespace vlaser {
+
+  /*
+   * Implementation of class vsarena
+   */
+
+  vsarena::vsarena(size_t n, int flags) :
+  size(n)
+  {
+    size_t huge = ARENA_HUGE_PAGE_SIZE;
+    vsbyte* p;
+
+    map_addr = MAP_FAILED;
+    numa_node = -1;
+    if(size == 0)
+      size = 1;
+    if((flags & ARENA_HUGE_PAGES) && size >= huge) {
+      /* explicit huge pages, only if the system has reserved them */
+      map_size = (size + huge - 1) / huge * huge;
+      map_addr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if(map_addr != MAP_FAILED) {
+        base = (vsbyte*)map_addr;
+        backing = BACKING_HUGE;
+      }
+      else {
+        /* a huge page aligned range advised for transparent huge pages */
+        map_size = (size + huge - 1) / huge * huge + huge;
+        map_addr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(map_addr == MAP_FAILED)
+          throw arena_runtime_error("can not map the arena: from vsarena::vsarena()");
+        p = (vsbyte*)map_addr;
+        base = p + (huge - (size_t)p % huge) % huge;
+        if(madvise(base, (size + huge - 1) / huge * huge, MADV_HUGEPAGE) == 0)
+          backing = BACKING_TRANSPARENT_HUGE;
+        else
+          backing = BACKING_PAGES;
+      }
+    }
+    else {
+      map_size = size;
+      map_addr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if(map_addr == MAP_FAILED)
+        throw arena_runtime_error("can not map the arena: from vsarena::vsarena()");
+      base = (vsbyte*)map_addr;
+      backing = BACKING_PAGES;
+    }
+    /* the pages are not touched yet, so the policy places all of them */
+    if(flags & ARENA_NUMA_LOCAL)
+      BindLocal();
+  }
+
+  vsarena::~vsarena()
+  {
+    if(map_addr != MAP_FAILED)
+      munmap(map_addr, map_size);
+  }
+
+  void
+  vsarena::BindLocal()
+  {
+    unsigned long mask[ARENA_NUMA_NODE_MAX / (8 * sizeof(unsigned long))];
+    unsigned int cpu, node;
+    size_t bits = 8 * sizeof(unsigned long);
+
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+    if(syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= ARENA_NUMA_NODE_MAX)
+      return;
+    memset(mask, 0, sizeof(mask));
+    mask[node / bits] |= 1UL << (node % bits);
+    /* preferred, not bound, so a full node falls back to the others */
+    if(syscall(SYS_mbind, map_addr, map_size, MPOL_PREFERRED, mask, (unsigned long)ARENA_NUMA_NODE_MAX, 0) == 0)
+      numa_node = node;
+#endif
+    return;
+  }
+
+  const char*
+  vsarena::BackingName()
+  {
+    switch(backing) {
+      case BACKING_HUGE:
+        return "huge pages";
+      case BACKING_TRANSPARENT_HUGE:
+        return "transparent huge pages";
+      default:
+        return "normal pages";
+    }
+  }
+
+  /*
+   * Implementation of class vsbufpool
+   */
+
+  vsbufpool::vsbufpool(size_t bsize, int n, int flags, size_t align) :
+  buf_size(bsize),
+  buf_align(align > ARENA_BUF_ALIGN ? align : ARENA_BUF_ALIGN)
+  {
+    size_t stride = (bsize + buf_align - 1) / buf_align * buf_align;
+
+    arena = new vsarena(stride * n, flags);
+    free_bufs.reserve(n);
+    for(int i = n - 1; i >= 0; --i)
+      free_bufs.push_back(arena->Base() + stride * i);
+  }
+
+  vsbufpool::~vsbufpool()
+  {
+    delete arena;
+  }
+
+  vsbyte*
+  vsbufpool::Get()
+  {
+    vsbyte* p;
+    void* q;
+
+    pool_mutex.lock();
+    if(free_bufs.empty()) {
+      pool_mutex.unlock();
+      if(posix_memalign(&q, buf_align, buf_size) != 0)
+        throw vsarena::arena_runtime_error("no memory for a buffer: from vsbufpool::Get()");
+      return (vsbyte*)q;
+    }
+    p = free_bufs.back();
+    free_bufs.pop_back();
+    pool_mutex.unlock();
+    return p;
+  }
+
+  void
+  vsbufpool::Put(vsbyte* buf)
+  {
+    if(!arena->Contains(buf)) {
+      free(buf);
+      return;
+    }
+    pool_mutex.lock();
+    free_bufs.push_back(buf);
+    pool_mutex.unlock();
+    return;
+  }
+
+} //end namespace vlaser
@@ -11,11 +11,28 @@
  * May 11, 2011  Add a list to record all invalid
  *               blocks in cache to speed up the
  *               replacement procedure.
+ * Oct 17, 2026  Open addressing index, and the LRU and invalid
+ *               lists linked by block indices inside the blocks.
+ * Oct 17, 2026  The replacement policy is a vsreplacer, count the
+ *               hits and misses.
+ * Oct 17, 2026  Block sequence numbers and TryRead().
+ * Oct 17, 2026  Trace the MODIFIED blocks in a list as their status
+ *               changes, instead of scanning all blocks.
+ * Oct 17, 2026  Clean the cold MODIFIED blocks ahead of time.
+ * Oct 17, 2026  Allocate the block data from a vsarena, on huge pages
+ *               of the local NUMA node when it can.
+ * Oct 17, 2026  Block versions for the local disk cache.
+ * Oct 17, 2026  Dirty sector masks.
+ * Oct 17, 2026  Dirty byte ranges.
+ * Oct 17, 2026  Tell every TryRead() hit to the policy, by the
+ *               referenced flags.
+ * Oct 17, 2026  Valid sector masks, for the sectored coherence.
  *
  */
 
 #include "vscache.h"
 #include <cstring>
+#include <algorithm>
 
 namespace vlaser {
 
@@ -23,51 +40,189 @@ namespace vlaser {
    * Implementation of Class vscache
    */
 
-  vscache::vscache(BlockSize bsize, vsaddr n) :
+  vscache::vscache(BlockSize bsize, vsaddr n, ReplacementPolicy policy) :
   cache_block_size(bsize), /* block size */
   cache_size(n) /* number of total blocks */
   {
-    cache_list.clear();
-    cache_map.clear();
-    invalid_blocks.clear();
+    vsaddr slots;
+
     modified_blocks.clear();
     
     /* allocate all cache block data space */
-    cacheX = (vsbyte*)(new unsigned char[sizeof(vsbyte) * bsize * n]);
+    arena = new vsarena(sizeof(vsbyte) * (size_t)bsize * n);
+    cacheX = arena->Base();
 
     /* allocate all CacheBlock */
     cache_blocks = new CacheBlock[n];
 
+    /* the index keeps its load factor under 1/2 */
+    for(slots = 2, index_shift = 31; slots < 2 * n; slots <<= 1, --index_shift)
+      ;
+    index_mask = slots - 1;
+    index_slots = new IndexSlot[slots];
+    for(vsaddr i = 0; i < slots; ++i)
+      index_slots[i].block = NIL;
+
+    /* all blocks are invalid, none of them is in the policy */
+    replacer = vsreplacer::Create(policy, n);
+    invalid_head = NIL;
+    modified_head = NIL;
+    modified_num = 0;
     for(int i = 0; i < n; ++i) {
       (cache_blocks[i]).data = cacheX + i * cache_block_size;
       (cache_blocks[i]).status = INVALID;
       (cache_blocks[i]).pinning_flag = 0;
       (cache_blocks[i]).integrity_flag = 0;
+      (cache_blocks[i]).cleaning_flag = 0;
+      (cache_blocks[i]).version = NO_VERSION;
+      (cache_blocks[i]).dirty_mask = 0;
+      (cache_blocks[i]).range_num = 0;
+      (cache_blocks[i]).seq = 0;
+      (cache_blocks[i]).referenced = 0;
+      (cache_blocks[i]).valid_mask = ~0ULL;
+      (cache_blocks[i]).addr = i;
 
-      cache_map.insert(TypeOfCacheMap::value_type(i, &(cache_blocks[i])));
-      cache_list.push_front(i);
-      invalid_blocks.push_front(i);
-      (cache_blocks[i]).list_pos = cache_list.begin();
-      (cache_blocks[i]).invalid_pos = invalid_blocks.begin();
+      IndexInsert(i, i);
+      InvalidPushFront(i);
     }
     pinning_block_num = 0;
     is_create_modified_list = 0;
+    /* at least as large as the blocks */
+    touch_mask = slots / 2 - 1;
+    touch_ring = new int[slots / 2];
+    for(vsaddr i = 0; i < slots / 2; ++i)
+      touch_ring[i] = NIL;
+    touch_head = touch_tail = 0;
+    ClearStatistics();
   }
 
   vscache::~vscache()
   {
-    delete[] cacheX;
+    delete arena;
     delete[] cache_blocks;
+    delete[] index_slots;
+    delete[] touch_ring;
+    delete replacer;
+  }
+
+  inline int
+  vscache::LookUp(vsaddr addr)
+  {
+    /* Fibonacci hashing, the high bits of the product are the slot */
+    vsaddr i = (vsaddr)(addr * 2654435769u) >> index_shift;
+
+    while(index_slots[i].block != NIL) {
+      if(index_slots[i].addr == addr)
+        return index_slots[i].block;
+      i = (i + 1) & index_mask;
+    }
+    return NIL;
+  }
+
+  inline void
+  vscache::IndexInsert(vsaddr addr, int block)
+  {
+    vsaddr i = (vsaddr)(addr * 2654435769u) >> index_shift;
+
+    while(index_slots[i].block != NIL)
+      i = (i + 1) & index_mask;
+    index_slots[i].addr = addr;
+    index_slots[i].block = block;
+    return;
+  }
+
+  inline void
+  vscache::IndexErase(vsaddr addr)
+  {
+    vsaddr i = (vsaddr)(addr * 2654435769u) >> index_shift;
+    vsaddr j, home;
+
+    while(index_slots[i].addr != addr || index_slots[i].block == NIL) {
+      if(index_slots[i].block == NIL)
+        throw cache_logic_error("erasing an address not in the index: from vscache::IndexErase()");
+      i = (i + 1) & index_mask;
+    }
+    /* move the following slots of the probing run back,
+     * so no tombstone is needed
+     */
+    j = i;
+    while(1) {
+      j = (j + 1) & index_mask;
+      if(index_slots[j].block == NIL)
+        break;
+      home = (vsaddr)(index_slots[j].addr * 2654435769u) >> index_shift;
+      /* slot j can fill the hole at i if its home is not in (i, j] */
+      if(((j - home) & index_mask) >= ((j - i) & index_mask)) {
+        index_slots[i] = index_slots[j];
+        i = j;
+      }
+    }
+    index_slots[i].block = NIL;
+    return;
+  }
+
+  inline void
+  vscache::InvalidUnlink(int block)
+  {
+    CacheBlock* tmp = cache_blocks + block;
+
+    if(tmp->invalid_prev != NIL)
+      cache_blocks[tmp->invalid_prev].invalid_next = tmp->invalid_next;
+    else
+      invalid_head = tmp->invalid_next;
+    if(tmp->invalid_next != NIL)
+      cache_blocks[tmp->invalid_next].invalid_prev = tmp->invalid_prev;
+    return;
+  }
+
+  inline void
+  vscache::InvalidPushFront(int block)
+  {
+    CacheBlock* tmp = cache_blocks + block;
+
+    tmp->invalid_prev = NIL;
+    tmp->invalid_next = invalid_head;
+    if(invalid_head != NIL)
+      cache_blocks[invalid_head].invalid_prev = block;
+    invalid_head = block;
+    return;
+  }
+
+  inline void
+  vscache::TraceModified(int block, BlockStatus oldst, BlockStatus newst)
+  {
+    CacheBlock* tmp = cache_blocks + block;
+
+    if(oldst == MODIFIED && newst != MODIFIED) {
+      if(tmp->modified_prev != NIL)
+        cache_blocks[tmp->modified_prev].modified_next = tmp->modified_next;
+      else
+        modified_head = tmp->modified_next;
+      if(tmp->modified_next != NIL)
+        cache_blocks[tmp->modified_next].modified_prev = tmp->modified_prev;
+      --modified_num;
+    }
+    else if(oldst != MODIFIED && newst == MODIFIED) {
+      tmp->dirty_mask = 0;
+      tmp->range_num = 0;
+      tmp->modified_prev = NIL;
+      tmp->modified_next = modified_head;
+      if(modified_head != NIL)
+        cache_blocks[modified_head].modified_prev = block;
+      modified_head = block;
+      ++modified_num;
+    }
+    return;
   }
 
   inline vscache::CacheBlock*
   vscache::FindBlock(vsaddr addr)
   {
-    TypeOfCacheMap::iterator temp;
-    if((temp = cache_map.find(addr)) == cache_map.end())
+    int i;
+    if((i = LookUp(addr)) == NIL)
       throw cache_miss("cache miss: from vscache::find()");
     else
-      return temp->second;
+      return cache_blocks + i;
   }
 
   vscache::BlockStatus
@@ -81,14 +236,27 @@ namespace vlaser {
   {
     CacheBlock* tmp = FindBlock(addr);
     
-    /* trace the change of the invalid blocks' number */
-    if(tmp->status == INVALID && status != INVALID)
-      invalid_blocks.erase(tmp->invalid_pos);
+    /* trace the change of the invalid blocks' number,
+     * only the valid and not pinned blocks are in the policy
+     */
+    BeginChange(tmp);
+    if(tmp->status == INVALID && status != INVALID) {
+      InvalidUnlink(tmp - cache_blocks);
+      if(!tmp->pinning_flag)
+        replacer->Insert(tmp - cache_blocks, addr);
+    }
     else if(tmp->status != INVALID && status == INVALID) {
-      invalid_blocks.push_front(addr);
-      tmp->invalid_pos = invalid_blocks.begin();
+      InvalidPushFront(tmp - cache_blocks);
+      if(!tmp->pinning_flag)
+        replacer->Remove(tmp - cache_blocks, addr, 0);
     }
+    TraceModified(tmp - cache_blocks, tmp->status, status);
     tmp->status = status;
+    /* a write of a MODIFIED block also sets its status, so the
+     * block being written back is known to be dirty again
+     */
+    tmp->cleaning_flag = 0;
+    EndChange(tmp);
     return;
   }
 
@@ -106,25 +274,156 @@ namespace vlaser {
   {
     CacheBlock* tmp = FindBlock(addr);
         
-    return tmp->integrity_flag;
+    return tmp->integrity_flag && tmp->valid_mask == ~0ULL;
+  }
+
+  void
+  vscache::SetBlockVersion(vsaddr addr, vsaddr version)
+  {
+    CacheBlock* tmp = FindBlock(addr);
+
+    tmp->version = version;
+    return;
+  }
+
+  vsaddr
+  vscache::GetBlockVersion(vsaddr addr)
+  {
+    CacheBlock* tmp = FindBlock(addr);
+
+    return tmp->version;
+  }
+
+  void
+  vscache::MarkDirty(vsaddr addr, int startpoint, int count)
+  {
+    CacheBlock* tmp = FindBlock(addr);
+    int i;
+    blockoffset s = startpoint, e = startpoint + count;
+
+    if(count <= 0)
+      return;
+    tmp->dirty_mask |= SectorsOf(startpoint, count);
+    if(tmp->range_num < 0)
+      return;
+    /* merge the ranges touching [s, e) into it, the last one fills the
+     * hole, and look again from the first as [s, e) has grown
+     */
+    for(i = 0; i < tmp->range_num; )
+      if(tmp->range_start[i] <= e && s <= tmp->range_end[i]) {
+        if(tmp->range_start[i] < s)
+          s = tmp->range_start[i];
+        if(tmp->range_end[i] > e)
+          e = tmp->range_end[i];
+        --tmp->range_num;
+        tmp->range_start[i] = tmp->range_start[tmp->range_num];
+        tmp->range_end[i] = tmp->range_end[tmp->range_num];
+        i = 0;
+      }
+      else
+        ++i;
+    if(tmp->range_num == DIRTY_RANGES) {
+      tmp->range_num = -1;
+      return;
+    }
+    tmp->range_start[tmp->range_num] = s;
+    tmp->range_end[tmp->range_num] = e;
+    ++tmp->range_num;
+    return;
+  }
+
+  int
+  vscache::GetDirtyRanges(vsaddr addr, blockoffset* start, blockoffset* len)
+  {
+    CacheBlock* tmp = FindBlock(addr);
+
+    if(tmp->range_num <= 0)
+      return 0;
+    for(int i = 0; i < tmp->range_num; ++i) {
+      start[i] = tmp->range_start[i];
+      len[i] = tmp->range_end[i] - tmp->range_start[i];
+    }
+    return tmp->range_num;
+  }
+
+  unsigned long long
+  vscache::GetDirtyMask(vsaddr addr)
+  {
+    return FindBlock(addr)->dirty_mask;
+  }
+
+  unsigned long long
+  vscache::SectorsOf(int startpoint, int count)
+  {
+    int sector = cache_block_size / DIRTY_SECTORS;
+    int first, last;
+
+    if(count <= 0)
+      return 0;
+    first = startpoint / sector;
+    last = (startpoint + count - 1) / sector;
+    if(last - first + 1 == DIRTY_SECTORS)
+      return ~0ULL;
+    return ((1ULL << (last - first + 1)) - 1) << first;
+  }
+
+  unsigned long long
+  vscache::WholeSectorsOf(int startpoint, int count)
+  {
+    int sector = cache_block_size / DIRTY_SECTORS;
+    int first = (startpoint + sector - 1) / sector; /* the first sector starting in the range */
+    int end = (startpoint + count) / sector; /* the sector after the last one ending in it */
+
+    if(end <= first)
+      return 0;
+    if(end - first == DIRTY_SECTORS)
+      return ~0ULL;
+    return ((1ULL << (end - first)) - 1) << first;
+  }
+
+  unsigned long long
+  vscache::GetValidSectors(vsaddr addr)
+  {
+    return FindBlock(addr)->valid_mask;
+  }
+
+  void
+  vscache::SetValidSectors(vsaddr addr, unsigned long long mask)
+  {
+    CacheBlock* tmp = FindBlock(addr);
+
+    BeginChange(tmp);
+    tmp->valid_mask = mask;
+    EndChange(tmp);
+    return;
+  }
+
+  int
+  vscache::HasSectors(vsaddr addr, int startpoint, int count)
+  {
+    unsigned long long need = SectorsOf(startpoint, count);
+
+    return (FindBlock(addr)->valid_mask & need) == need;
   }
 
   vsbyte*
   vscache::AccessBlock(vsaddr addr, int rec_flag)
   {
-    TypeOfCacheMap::iterator map_iter;
     CacheBlock* tmp;
+    int i;
 
-    if((map_iter = cache_map.find(addr)) == cache_map.end())
-      return NULL;
-    tmp = map_iter->second;
-    if(tmp->status == INVALID)
+    if((i = LookUp(addr)) == NIL || cache_blocks[i].status == INVALID) {
+      if(rec_flag)
+        ++stats.misses;
       return NULL;
+    }
+    tmp = cache_blocks + i;
 
     if(rec_flag) {
-      cache_list.erase(tmp->list_pos);
-      cache_list.push_back(addr);
-      tmp->list_pos = --cache_list.end();
+      __sync_fetch_and_add(&stats.hits, 1);
+      DrainTouches();
+      if(!tmp->pinning_flag)
+        replacer->Touch(i);
     }
     return (tmp->data);
   }
@@ -136,8 +435,12 @@ namespace vlaser {
     tmp = FindBlock(addr);
     if(tmp->status == INVALID)
       throw cache_miss("Locking a invalid block: from vscache::AccessBlock()"); 
-    tmp->pinning_flag = 1;
-    ++pinning_block_num;
+    if(!tmp->pinning_flag) {
+      /* a pinned block is out of the policy until it is released */
+      tmp->pinning_flag = 1;
+      ++pinning_block_num;
+      replacer->Remove(tmp - cache_blocks, addr, 0);
+    }
     return;
   }
   
@@ -151,56 +454,63 @@ namespace vlaser {
       --pinning_block_num;
       if(pinning_block_num < 0)
         throw cache_logic_error("pinning block counter is broken: from vscache::ReleaseBlock()");
+      if(tmp->status != INVALID)
+        replacer->Insert(tmp - cache_blocks, addr);
     }
     return;
   }
 
   inline vsbyte*
-  vscache::SwapBlock(vscache::TypeOfCacheMap::iterator oldmap_iter, vsaddr newaddr, vscache::BlockStatus newstatus)
+  vscache::SwapBlock(int block, vsaddr newaddr, vscache::BlockStatus newstatus)
   {
-    CacheBlock* tmp;
-    tmp = oldmap_iter->second; /* get old block's pointer */
+    CacheBlock* tmp = cache_blocks + block;
+
+    BeginChange(tmp);
+    /* the old block leaves the policy, it is a victim if it is still valid */
+    if(tmp->pinning_flag) {
+      tmp->pinning_flag = 0;
+      --pinning_block_num;
+    }
+    else if(tmp->status != INVALID)
+      replacer->Remove(block, tmp->addr, 1);
     /* set all new block's properties */
-    tmp->pinning_flag = 0;
+    TraceModified(block, tmp->status, newstatus);
     tmp->status = newstatus;
     tmp->integrity_flag = 0;
-    /* delete the old block from LRU list, hash map, and invalid list */
-    cache_list.erase(tmp->list_pos);
-    cache_map.erase(oldmap_iter);
-    /* insert the new block to hash map */
-    cache_map.insert(TypeOfCacheMap::value_type(newaddr, tmp));
-    /* insert new block to LRU list's end */
-    cache_list.push_back(newaddr);
-    tmp->list_pos = --cache_list.end();
+    tmp->cleaning_flag = 0;
+    tmp->version = NO_VERSION;
+    tmp->valid_mask = ~0ULL;
+    /* move the block to the new address in the index */
+    if(tmp->addr != newaddr) {
+      IndexErase(tmp->addr);
+      IndexInsert(newaddr, block);
+      tmp->addr = newaddr;
+    }
+    if(newstatus != INVALID)
+      replacer->Insert(block, newaddr);
+    EndChange(tmp);
     return tmp->data;
   }
 
   int
-  vscache::FindReplacingBlock(vsaddr& addr, int& if_writeback)
-  {
-    TypeOfCacheMap::iterator map_iter;
-    TypeOfLRUList::iterator list_iter;
-
-    if(invalid_blocks.empty()) {
-      list_iter = cache_list.begin();
-      while(list_iter != cache_list.end()) {
-        map_iter = cache_map.find(*list_iter);
-        if(map_iter == cache_map.end()) /* if find nothing, LRU list or hash map may be broken, there should be design problems */
-          throw cache_logic_error("LRU list discords with cache hash map: from vscache::FindReplacingBlock()");
-        if(map_iter->second->pinning_flag == 0) {
-          /* if not pinning, use it */
-          if(map_iter->second->status == MODIFIED)
-            if_writeback = 1;
-          else
-            if_writeback = 0;
-          addr = map_iter->first;
-          return 1;
-        }
-      ++list_iter;
+  vscache::FindReplacingBlock(vsaddr newaddr, vsaddr& addr, int& if_writeback)
+  {
+    int i;
+
+    if(invalid_head == NIL) {
+      DrainTouches();
+      /* pinned blocks are not in the policy */
+      if((i = replacer->Victim(newaddr)) == NIL)
+        throw cache_pinning("all cache block pins up: from vscache::ReplaceBlock()"); /* all cache block is pinning */
+      ++stats.evictions;
+      if(cache_blocks[i].status == MODIFIED) {
+        if_writeback = 1;
+        ++stats.dirty_evictions;
       }
-      if(cache_map.size() != cache_size)
-        throw cache_logic_error("cache hash map size does not equate to cache blocks set number: from vscache::ReplaceBlock()");
-      throw cache_pinning("all cache block pins up: from vscache::ReplaceBlock()"); /* all cache block is pinning */
+      else
+        if_writeback = 0;
+      addr = cache_blocks[i].addr;
+      return 1;
     }
     else
       return 0;
@@ -209,88 +519,151 @@ namespace vlaser {
   vsbyte*
   vscache::PushBlock(vsaddr newaddr, BlockStatus st, int swapblock, vsaddr swappedaddr)
   {
-    TypeOfCacheMap::iterator map_iter;
-    CacheBlock* ptmp;
-    int bingo = 0;
+    int i;
 
     if(swapblock) {
       /* push new block by replacing the given old block */
-      map_iter = cache_map.find(newaddr);
-      if(map_iter != cache_map.end())
+      if(LookUp(newaddr) != NIL)
         throw cache_logic_error("pushing a cached virtual address: from vscache::PushBlock()");
-      map_iter = cache_map.find(swappedaddr);
-      if(map_iter == cache_map.end())
+      if((i = LookUp(swappedaddr)) == NIL)
         throw cache_logic_error("can not find the swapblock address in cache: from vscache::PushBlock()");
-      if(map_iter->second->status == INVALID)
-        invalid_blocks.erase(map_iter->second->invalid_pos);
-      if(st == INVALID) {
-        invalid_blocks.push_front(newaddr);
-        map_iter->second->invalid_pos = invalid_blocks.begin();
-      }
-      return SwapBlock(map_iter, newaddr, st);
+      if(cache_blocks[i].status == INVALID)
+        InvalidUnlink(i);
+      if(st == INVALID)
+        InvalidPushFront(i);
+      return SwapBlock(i, newaddr, st);
     }
     else {
-      if(invalid_blocks.empty())
+      if(invalid_head == NIL)
         throw cache_logic_error("call PushBlock method using no swap mode, but find there is no invalid block: from vscache::PushBlock()");
       
-      map_iter = cache_map.find(newaddr);
-      if(map_iter != cache_map.end()) {
+      if((i = LookUp(newaddr)) != NIL) {
         /* if the cached block is INVALID, just replace it */
-        if(map_iter->second->status == INVALID) {
+        if(cache_blocks[i].status == INVALID) {
           if(st != INVALID)
-            invalid_blocks.erase(map_iter->second->invalid_pos);
-          return SwapBlock(map_iter, newaddr, st);
+            InvalidUnlink(i);
+          return SwapBlock(i, newaddr, st);
         }
         else
           throw cache_logic_error("Pushing a cached virtual address: from vscache::PushBlock()");
       }
 
-      map_iter = cache_map.find(invalid_blocks.front());
-      if(map_iter == cache_map.end())
-        throw cache_logic_error("can not find a invalid block in cache_map, which the block is from invalid list: from ReplaceBlock()");
-      invalid_blocks.pop_front();
-      
-      if(st == INVALID) {
-        invalid_blocks.push_front(newaddr);
-        map_iter->second->invalid_pos = invalid_blocks.begin();
-      }
-      return SwapBlock(map_iter, newaddr, st);
+      i = invalid_head;
+      InvalidUnlink(i);
+      if(st == INVALID)
+        InvalidPushFront(i);
+      return SwapBlock(i, newaddr, st);
     }
   }
 
+  void
+  vscache::GetModifiedBlocks(std::vector<vsaddr>& list)
+  {
+    list.clear();
+    list.reserve(modified_num);
+    for(int i = modified_head; i != NIL; i = cache_blocks[i].modified_next)
+      list.push_back(cache_blocks[i].addr);
+    std::sort(list.begin(), list.end());
+    return;
+  }
+
   inline void
   vscache::FindAllModified()
   {
-    TypeOfCacheMap::iterator map_iter = cache_map.begin();
-
-    modified_blocks.clear();
-    /* record all the blocks that is tagged as MODIFIED */
-    while(map_iter != cache_map.end()) {
-      if(map_iter->second->status == MODIFIED)
-        modified_blocks.push_back(map_iter->first);
-      ++map_iter;
-    }
+    GetModifiedBlocks(modified_blocks);
+    /* CleanCache() takes them from the back */
+    std::reverse(modified_blocks.begin(), modified_blocks.end());
     is_create_modified_list = 1;
     return;
   }
 
+  vsbyte*
+  vscache::CleanBlock(vsaddr addr)
+  {
+    int i;
+
+    if((i = LookUp(addr)) == NIL || cache_blocks[i].status != MODIFIED)
+      return NULL;
+    BeginChange(cache_blocks + i);
+    TraceModified(i, MODIFIED, INVALID);
+    cache_blocks[i].status = INVALID;
+    cache_blocks[i].cleaning_flag = 0;
+    InvalidPushFront(i);
+    if(!cache_blocks[i].pinning_flag)
+      replacer->Remove(i, addr, 0);
+    EndChange(cache_blocks + i);
+    return cache_blocks[i].data;
+  }
+
+  void
+  vscache::FindColdModified(vsaddr max, vsaddr scan, std::vector<vsaddr>& list)
+  {
+    int i;
+
+    list.clear();
+    DrainTouches();
+    /* pinned blocks are not in the policy */
+    for(i = replacer->Coldest(); i != NIL && scan > 0 && list.size() < max; i = replacer->Warmer(i), --scan)
+      if(cache_blocks[i].status == MODIFIED)
+        list.push_back(cache_blocks[i].addr);
+    return;
+  }
+
+  vsbyte*
+  vscache::BeginClean(vsaddr addr)
+  {
+    int i;
+
+    if((i = LookUp(addr)) == NIL || cache_blocks[i].status != MODIFIED || cache_blocks[i].pinning_flag)
+      return NULL;
+    /* pinned, so it is not chosen as a victim while being written back */
+    LockBlock(addr);
+    cache_blocks[i].cleaning_flag = 1;
+    return cache_blocks[i].data;
+  }
+
+  int
+  vscache::EndClean(vsaddr addr, int written)
+  {
+    int i, k = 0;
+
+    /* the block may have been replaced if it was set INVALID meanwhile */
+    if((i = LookUp(addr)) == NIL)
+      return 0;
+    if(written && cache_blocks[i].cleaning_flag && cache_blocks[i].status == MODIFIED) {
+      SetBlockStatus(addr, EXCLUSIVE);
+      k = 1;
+    }
+    cache_blocks[i].cleaning_flag = 0;
+    ReleaseBlock(addr);
+    return k;
+  }
+
   int
   vscache::CleanCache(vsaddr& addr, vsbyte** buf)
   {
-    TypeOfCacheMap::iterator map_iter;
+    int i;
     
     if(!is_create_modified_list)
       FindAllModified();
     if(modified_blocks.size() == 0)
       return 0;
     else {
-      map_iter = cache_map.find(modified_blocks.back());
-      if(map_iter == cache_map.end())
+      if((i = LookUp(modified_blocks.back())) == NIL)
         throw cache_logic_error("modified blocks list is broken: from vscache::CleanCache()");
       /* return its data and global address */
-      *buf = map_iter->second->data;
-      addr = map_iter->first;
-      map_iter->second->status = INVALID;
+      *buf = cache_blocks[i].data;
+      addr = cache_blocks[i].addr;
+      if(cache_blocks[i].status != INVALID) {
+        BeginChange(cache_blocks + i);
+        TraceModified(i, cache_blocks[i].status, INVALID);
+        cache_blocks[i].status = INVALID;
+        cache_blocks[i].cleaning_flag = 0;
+        InvalidPushFront(i);
+        if(!cache_blocks[i].pinning_flag)
+          replacer->Remove(i, addr, 0);
+        EndChange(cache_blocks + i);
+      }
       modified_blocks.pop_back();
       return 1;
     }
@@ -299,18 +672,87 @@ namespace vlaser {
   int
   vscache::IsCached(vsaddr addr, BlockStatus& status)
   {
-    TypeOfCacheMap::iterator temp;
-    if((temp = cache_map.find(addr)) == cache_map.end())
+    int i;
+    if((i = LookUp(addr)) == NIL)
       return 0;
     else
-      if(temp->second->status == INVALID)
+      if(cache_blocks[i].status == INVALID)
         return 0;
       else {
-        status = temp->second->status;
+        status = cache_blocks[i].status;
         return 1;
       }
   }
 
+  int
+  vscache::TryRead(vsaddr addr, int startpoint, int count, vsbyte* buf)
+  {
+    volatile IndexSlot* slots = index_slots;
+    CacheBlock* tmp;
+    vsaddr i, n;
+    unsigned int seq;
+    unsigned long long need = SectorsOf(startpoint, count);
+    int block;
+
+    /* the index may be changing, a wrong block is found out by
+     * checking its address, and a missed one by the locked retry
+     */
+    i = (vsaddr)(addr * 2654435769u) >> index_shift;
+    for(n = 0; n <= index_mask; ++n) {
+      if((block = slots[i].block) == NIL)
+        return 0;
+      if(slots[i].addr == addr)
+        break;
+      i = (i + 1) & index_mask;
+    }
+    if(n > index_mask || block < 0 || (vsaddr)block >= cache_size)
+      return 0;
+    tmp = cache_blocks + block;
+
+    seq = tmp->seq;
+    __sync_synchronize();
+    if((seq & 1) || tmp->addr != addr || tmp->status == INVALID || (tmp->valid_mask & need) != need)
+      return 0;
+    memcpy(buf, tmp->data + startpoint, count);
+    __sync_synchronize();
+    if(tmp->seq != seq)
+      return 0;
+
+    __sync_fetch_and_add(&stats.hits, 1);
+    if(__sync_lock_test_and_set(&tmp->referenced, 1) == 0)
+      touch_ring[__sync_fetch_and_add(&touch_head, 1) & touch_mask] = block;
+    return 1;
+  }
+
+  void
+  vscache::DrainTouches()
+  {
+    unsigned int head = touch_head;
+    int block;
+
+    __sync_synchronize();
+    for(; touch_tail != head; ++touch_tail) {
+      /* a slot taken but not yet filled is drained next time */
+      if((block = touch_ring[touch_tail & touch_mask]) == NIL)
+        break;
+      touch_ring[touch_tail & touch_mask] = NIL;
+      __sync_lock_release(&cache_blocks[block].referenced);
+      if(cache_blocks[block].status != INVALID && !cache_blocks[block].pinning_flag)
+        replacer->Touch(block);
+    }
+    return;
+  }
+
+  void
+  vscache::ClearStatistics()
+  {
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+    stats.dirty_evictions = 0;
+    return;
+  }
+
   inline vsaddr
   vscache::GetPinningNum()
   {
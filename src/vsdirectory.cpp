@@ -0,0 +1,225 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Storage Directory Component
+ * class vlaser::vsdirectory
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#include "vsdirectory.h"
+#include <cstring>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class vsdirectory
+   */
+
+  vsdirectory::vsdirectory(vsaddr n, vsnodeid nm) :
+  entry_num(n),
+  node_num(nm)
+  {
+    entries = new Entry[n];
+    memset(entries, 0, sizeof(Entry) * n);
+    group_size = (nm + VSDIRECTORY_BITS_NODE_MAX - 1) / VSDIRECTORY_BITS_NODE_MAX;
+    for(vsaddr i = 0; i < n; ++i)
+      entries[i].kind = (nm <= VSDIRECTORY_BITS_NODE_MAX) ? ENTRY_BITS : ENTRY_POINTERS;
+  }
+
+  vsdirectory::~vsdirectory()
+  {
+    delete[] entries;
+  }
+
+  inline void
+  vsdirectory::ClearBits(Entry& e)
+  {
+    for(int i = 0; i < VSDIRECTORY_BITS_NODE_MAX / 64; ++i)
+      e.bits[i] = 0;
+    return;
+  }
+
+  void
+  vsdirectory::Insert(vsaddr laddr, vsnodeid id)
+  {
+    Entry& e = entries[laddr];
+    vsnodeid old[VSDIRECTORY_POINTER_NUM];
+    int i, j;
+
+    if(id >= node_num)
+      throw directory_logic_error("inserting an error node id: from vsdirectory::Insert()");
+    switch(e.kind) {
+      case ENTRY_BITS:
+        SetBit(e, id);
+        break;
+
+      case ENTRY_POINTERS:
+        for(i = 0; i < e.num && e.ptrs[i] < id; ++i)
+          ;
+        if(i < e.num && e.ptrs[i] == id)
+          break;
+        if(e.num < VSDIRECTORY_POINTER_NUM) {
+          /* keep the ids ascending */
+          for(j = e.num; j > i; --j)
+            e.ptrs[j] = e.ptrs[j - 1];
+          e.ptrs[i] = id;
+          ++e.num;
+          break;
+        }
+        /* no room for one more id, turn to the coarse vector */
+        memcpy(old, e.ptrs, sizeof(old));
+        ClearBits(e);
+        for(j = 0; j < VSDIRECTORY_POINTER_NUM; ++j)
+          SetBit(e, old[j] / group_size);
+        e.num = 0;
+        e.kind = ENTRY_COARSE;
+        SetBit(e, id / group_size);
+        break;
+
+      case ENTRY_COARSE:
+        SetBit(e, id / group_size);
+        break;
+    }
+    return;
+  }
+
+  void
+  vsdirectory::Erase(vsaddr laddr, vsnodeid id)
+  {
+    Entry& e = entries[laddr];
+    int i;
+
+    if(id >= node_num)
+      return;
+    switch(e.kind) {
+      case ENTRY_BITS:
+        e.bits[id >> 6] &= ~(1ULL << (id & 63));
+        break;
+
+      case ENTRY_POINTERS:
+        for(i = 0; i < e.num && e.ptrs[i] != id; ++i)
+          ;
+        if(i == e.num)
+          break;
+        for(--e.num; i < e.num; ++i)
+          e.ptrs[i] = e.ptrs[i + 1];
+        break;
+
+      case ENTRY_COARSE:
+        /* the other nodes of the group may still hold the block */
+        break;
+    }
+    return;
+  }
+
+  void
+  vsdirectory::Clear(vsaddr laddr)
+  {
+    Entry& e = entries[laddr];
+
+    ClearBits(e);
+    e.num = 0;
+    if(e.kind == ENTRY_COARSE)
+      e.kind = ENTRY_POINTERS;
+    return;
+  }
+
+  int
+  vsdirectory::Has(vsaddr laddr, vsnodeid id)
+  {
+    Entry& e = entries[laddr];
+
+    if(id >= node_num)
+      return 0;
+    switch(e.kind) {
+      case ENTRY_BITS:
+        return TestBit(e, id);
+
+      case ENTRY_POINTERS:
+        for(int i = 0; i < e.num; ++i)
+          if(e.ptrs[i] == id)
+            return 1;
+        return 0;
+
+      case ENTRY_COARSE:
+        return TestBit(e, id / group_size);
+    }
+    return 0;
+  }
+
+  int
+  vsdirectory::Count(vsaddr laddr)
+  {
+    Entry& e = entries[laddr];
+    vsnodeid g, end;
+    int n = 0;
+
+    switch(e.kind) {
+      case ENTRY_BITS:
+        for(int i = 0; i < VSDIRECTORY_BITS_NODE_MAX / 64; ++i)
+          n += __builtin_popcountll(e.bits[i]);
+        break;
+
+      case ENTRY_POINTERS:
+        n = e.num;
+        break;
+
+      case ENTRY_COARSE:
+        for(g = 0; g * group_size < node_num; ++g)
+          if(TestBit(e, g)) {
+            end = (g + 1) * group_size;
+            n += ((end < node_num) ? end : node_num) - g * group_size;
+          }
+        break;
+    }
+    return n;
+  }
+
+  int
+  vsdirectory::List(vsaddr laddr, vsnodeid* list)
+  {
+    Entry& e = entries[laddr];
+    unsigned long long w;
+    vsnodeid g, i, end;
+    int n = 0;
+
+    switch(e.kind) {
+      case ENTRY_BITS:
+        for(int k = 0; k < VSDIRECTORY_BITS_NODE_MAX / 64; ++k)
+          for(w = e.bits[k]; w != 0; w &= w - 1)
+            list[n++] = k * 64 + __builtin_ctzll(w);
+        break;
+
+      case ENTRY_POINTERS:
+        for(n = 0; n < e.num; ++n)
+          list[n] = e.ptrs[n];
+        break;
+
+      case ENTRY_COARSE:
+        for(g = 0; g * group_size < node_num; ++g)
+          if(TestBit(e, g)) {
+            end = (g + 1) * group_size;
+            if(end > node_num)
+              end = node_num;
+            for(i = g * group_size; i < end; ++i)
+              list[n++] = i;
+          }
+        break;
+    }
+    return n;
+  }
+
+  const char*
+  vsdirectory::FormatName()
+  {
+    if(node_num <= VSDIRECTORY_BITS_NODE_MAX)
+      return "bit-vector";
+    return "limited pointer with coarse vector";
+  }
+
+} //end namespace vlaser
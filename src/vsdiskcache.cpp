@@ -0,0 +1,156 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Local Disk Cache Component
+ * class vlaser::vsdiskcache
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ *
+ */
+
+#define _LARGEFILE64_SOURCE
+
+#include "vsdiskcache.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class vsdiskcache
+   */
+
+  vsdiskcache::vsdiskcache(BlockSize bsize, vsaddr n, const char* path) :
+  block_size(bsize),
+  slot_num(n)
+  {
+    vsaddr size;
+
+    if(n == 0)
+      throw diskcache_logic_error("disk cache of no block: from vsdiskcache::vsdiskcache()");
+    if((fd = open(path, O_CREAT|O_TRUNC|O_RDWR|O_LARGEFILE, S_IRUSR|S_IWUSR)) == -1)
+      throw diskcache_runtime_error("can not open the disk cache file: from vsdiskcache::vsdiskcache()");
+    unlink(path);
+    if(ftruncate64(fd, (off64_t)bsize * n) != 0)
+      throw diskcache_runtime_error("can not size the disk cache file: from vsdiskcache::vsdiskcache()");
+
+    slots = new Slot[n];
+    for(vsaddr i = 0; i < n; ++i)
+      slots[i].used = 0;
+    hand = 0;
+    /* the index keeps its load factor under 1/2 */
+    for(size = 2, index_shift = 31; size < 2 * n; size <<= 1, --index_shift)
+      ;
+    index_mask = size - 1;
+    index_slots = new int[size];
+    for(vsaddr i = 0; i < size; ++i)
+      index_slots[i] = NIL;
+  }
+
+  vsdiskcache::~vsdiskcache()
+  {
+    close(fd);
+    delete[] slots;
+    delete[] index_slots;
+  }
+
+  int
+  vsdiskcache::LookUp(vsaddr addr)
+  {
+    vsaddr i;
+
+    for(i = Home(addr); index_slots[i] != NIL; i = (i + 1) & index_mask)
+      if(slots[index_slots[i]].addr == addr)
+        return index_slots[i];
+    return NIL;
+  }
+
+  void
+  vsdiskcache::IndexErase(vsaddr addr)
+  {
+    vsaddr i, j, home;
+
+    for(i = Home(addr); index_slots[i] == NIL || slots[index_slots[i]].addr != addr; i = (i + 1) & index_mask)
+      if(index_slots[i] == NIL)
+        throw diskcache_logic_error("erasing an address not in the index: from vsdiskcache::IndexErase()");
+    /* move the following entries of the probing run back */
+    j = i;
+    while(1) {
+      j = (j + 1) & index_mask;
+      if(index_slots[j] == NIL)
+        break;
+      home = Home(slots[index_slots[j]].addr);
+      if(((j - home) & index_mask) >= ((j - i) & index_mask)) {
+        index_slots[i] = index_slots[j];
+        i = j;
+      }
+    }
+    index_slots[i] = NIL;
+    return;
+  }
+
+  int
+  vsdiskcache::Find(vsaddr addr, vsaddr& version)
+  {
+    int s;
+
+    if((s = LookUp(addr)) == NIL)
+      return 0;
+    version = slots[s].version;
+    return 1;
+  }
+
+  void
+  vsdiskcache::Read(vsaddr addr, vsbyte* buf)
+  {
+    int s;
+
+    if((s = LookUp(addr)) == NIL)
+      throw diskcache_logic_error("reading a block not held: from vsdiskcache::Read()");
+    if(pread64(fd, buf, block_size, (off64_t)block_size * s) != (ssize_t)block_size)
+      throw diskcache_runtime_error("reading block fail: from vsdiskcache::Read()");
+    return;
+  }
+
+  void
+  vsdiskcache::Put(vsaddr addr, vsaddr version, vsbyte* buf)
+  {
+    vsaddr i;
+    int s;
+
+    /* a held block is written again in its slot */
+    if((s = LookUp(addr)) == NIL) {
+      s = hand;
+      hand = (hand + 1) % slot_num;
+      if(slots[s].used)
+        IndexErase(slots[s].addr);
+      slots[s].addr = addr;
+      slots[s].used = 1;
+      for(i = Home(addr); index_slots[i] != NIL; i = (i + 1) & index_mask)
+        ;
+      index_slots[i] = s;
+    }
+    slots[s].version = version;
+    if(pwrite64(fd, buf, block_size, (off64_t)block_size * s) != (ssize_t)block_size)
+      throw diskcache_runtime_error("writing block fail: from vsdiskcache::Put()");
+    return;
+  }
+
+  void
+  vsdiskcache::Erase(vsaddr addr)
+  {
+    int s;
+
+    if((s = LookUp(addr)) != NIL) {
+      IndexErase(addr);
+      slots[s].used = 0;
+    }
+    return;
+  }
+
+} //end namespace vlaser
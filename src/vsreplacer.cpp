@@ -0,0 +1,624 @@
+/*
+ * Virtual Linear Address SERvice
+ *
+ * Author :Liu Peng-Hong  Institute of Scientific Computing, Nankai Univ.
+ *
+ * Cache Block Replacement Policies
+ * abstract class vlaser::vsreplacer
+ * class vlaser::vsreplacer_lru
+ * class vlaser::vsreplacer_clock
+ * class vlaser::vsreplacer_2q
+ * class vlaser::vsreplacer_arc
+ * Source File
+ *
+ * Oct 17, 2026  Original Design
+ * Oct 17, 2026  Coldest() and Warmer() of the policies.
+ *
+ */
+
+#include "vsreplacer.h"
+#include <cstring>
+
+namespace vlaser {
+
+  /*
+   * Implementation of class vsreplacer
+   */
+
+  vsreplacer::vsreplacer(vsaddr n) :
+  block_num(n)
+  {
+    block_prev = new int[n];
+    block_next = new int[n];
+    block_list = new unsigned char[n];
+    memset(block_list, 0, sizeof(unsigned char) * n);
+  }
+
+  vsreplacer::~vsreplacer()
+  {
+    delete[] block_prev;
+    delete[] block_next;
+    delete[] block_list;
+  }
+
+  vsreplacer*
+  vsreplacer::Create(ReplacementPolicy p, vsaddr n)
+  {
+    switch(p) {
+      case REPLACE_LRU:
+        return new vsreplacer_lru(n);
+      case REPLACE_CLOCK:
+        return new vsreplacer_clock(n);
+      case REPLACE_2Q:
+        return new vsreplacer_2q(n);
+      case REPLACE_ARC:
+        return new vsreplacer_arc(n);
+    }
+    throw replacer_logic_error("unknown replacement policy: from vsreplacer::Create()");
+  }
+
+  void
+  vsreplacer::ListInit(BlockList& l)
+  {
+    l.head = l.tail = NIL;
+    l.size = 0;
+    return;
+  }
+
+  void
+  vsreplacer::ListPushBack(BlockList& l, int block)
+  {
+    block_prev[block] = l.tail;
+    block_next[block] = NIL;
+    if(l.tail != NIL)
+      block_next[l.tail] = block;
+    else
+      l.head = block;
+    l.tail = block;
+    ++l.size;
+    return;
+  }
+
+  void
+  vsreplacer::ListUnlink(BlockList& l, int block)
+  {
+    if(block_prev[block] != NIL)
+      block_next[block_prev[block]] = block_next[block];
+    else
+      l.head = block_next[block];
+    if(block_next[block] != NIL)
+      block_prev[block_next[block]] = block_prev[block];
+    else
+      l.tail = block_prev[block];
+    --l.size;
+    return;
+  }
+
+  /*
+   * Implementation of class vsghost
+   */
+
+  vsghost::vsghost(vsaddr cap, int listnum) :
+  capacity(cap),
+  list_num(listnum)
+  {
+    vsaddr slots;
+
+    entries = new Entry[cap];
+    for(vsaddr i = 0; i < cap; ++i)
+      entries[i].next = i + 1;
+    if(cap > 0)
+      entries[cap - 1].next = NIL;
+    free_head = (cap > 0) ? 0 : NIL;
+
+    lists = new List[listnum];
+    for(int i = 0; i < listnum; ++i) {
+      lists[i].head = lists[i].tail = NIL;
+      lists[i].size = 0;
+    }
+
+    for(slots = 2, index_shift = 31; slots < 2 * cap; slots <<= 1, --index_shift)
+      ;
+    index_mask = slots - 1;
+    index_slots = new int[slots];
+    for(vsaddr i = 0; i < slots; ++i)
+      index_slots[i] = NIL;
+  }
+
+  vsghost::~vsghost()
+  {
+    delete[] entries;
+    delete[] lists;
+    delete[] index_slots;
+  }
+
+  int
+  vsghost::LookUp(vsaddr addr)
+  {
+    vsaddr i = Home(addr);
+
+    while(index_slots[i] != NIL) {
+      if(entries[index_slots[i]].addr == addr)
+        return index_slots[i];
+      i = (i + 1) & index_mask;
+    }
+    return NIL;
+  }
+
+  int
+  vsghost::Find(vsaddr addr)
+  {
+    int e = LookUp(addr);
+
+    return (e == NIL) ? -1 : entries[e].list;
+  }
+
+  void
+  vsghost::EraseEntry(int e)
+  {
+    List& l = lists[entries[e].list];
+    vsaddr i = Home(entries[e].addr);
+    vsaddr j;
+
+    /* remove it from the index, with backward shift deletion */
+    while(index_slots[i] != e)
+      i = (i + 1) & index_mask;
+    j = i;
+    while(1) {
+      j = (j + 1) & index_mask;
+      if(index_slots[j] == NIL)
+        break;
+      if(((j - Home(entries[index_slots[j]].addr)) & index_mask) >= ((j - i) & index_mask)) {
+        index_slots[i] = index_slots[j];
+        i = j;
+      }
+    }
+    index_slots[i] = NIL;
+
+    /* remove it from its list */
+    if(entries[e].prev != NIL)
+      entries[entries[e].prev].next = entries[e].next;
+    else
+      l.head = entries[e].next;
+    if(entries[e].next != NIL)
+      entries[entries[e].next].prev = entries[e].prev;
+    else
+      l.tail = entries[e].prev;
+    --l.size;
+
+    entries[e].next = free_head;
+    free_head = e;
+    return;
+  }
+
+  void
+  vsghost::PushBack(int l, vsaddr addr)
+  {
+    vsaddr i;
+    int e;
+
+    if(capacity == 0)
+      return;
+    if((e = LookUp(addr)) != NIL)
+      EraseEntry(e);
+    /* when full, drop the oldest address of list l, or of any list if l is empty */
+    for(int k = l; free_head == NIL; k = (k + 1) % list_num)
+      PopFront(k);
+    e = free_head;
+    free_head = entries[e].next;
+
+    entries[e].addr = addr;
+    entries[e].list = l;
+    entries[e].prev = lists[l].tail;
+    entries[e].next = NIL;
+    if(lists[l].tail != NIL)
+      entries[lists[l].tail].next = e;
+    else
+      lists[l].head = e;
+    lists[l].tail = e;
+    ++lists[l].size;
+
+    for(i = Home(addr); index_slots[i] != NIL; i = (i + 1) & index_mask)
+      ;
+    index_slots[i] = e;
+    return;
+  }
+
+  void
+  vsghost::Erase(vsaddr addr)
+  {
+    int e = LookUp(addr);
+
+    if(e != NIL)
+      EraseEntry(e);
+    return;
+  }
+
+  void
+  vsghost::PopFront(int l)
+  {
+    if(lists[l].head != NIL)
+      EraseEntry(lists[l].head);
+    return;
+  }
+
+  /*
+   * Implementation of class vsreplacer_lru
+   */
+
+  vsreplacer_lru::vsreplacer_lru(vsaddr n) :
+  vsreplacer(n)
+  {
+    ListInit(lru);
+  }
+
+  void
+  vsreplacer_lru::Insert(int block, vsaddr /* addr */)
+  {
+    ListPushBack(lru, block);
+    block_list[block] = 1;
+    return;
+  }
+
+  void
+  vsreplacer_lru::Touch(int block)
+  {
+    if(block_list[block] && block != lru.tail) {
+      ListUnlink(lru, block);
+      ListPushBack(lru, block);
+    }
+    return;
+  }
+
+  void
+  vsreplacer_lru::Remove(int block, vsaddr /* addr */, int /* evicted */)
+  {
+    if(block_list[block]) {
+      ListUnlink(lru, block);
+      block_list[block] = 0;
+    }
+    return;
+  }
+
+  int
+  vsreplacer_lru::Victim(vsaddr /* newaddr */)
+  {
+    return lru.head;
+  }
+
+  int
+  vsreplacer_lru::Coldest()
+  {
+    return lru.head;
+  }
+
+  int
+  vsreplacer_lru::Warmer(int block)
+  {
+    return block_next[block];
+  }
+
+  /*
+   * Implementation of class vsreplacer_clock
+   */
+
+  vsreplacer_clock::vsreplacer_clock(vsaddr n) :
+  vsreplacer(n)
+  {
+    ListInit(ring);
+    hand = NIL;
+    referenced = new unsigned char[n];
+    memset(referenced, 0, sizeof(unsigned char) * n);
+  }
+
+  vsreplacer_clock::~vsreplacer_clock()
+  {
+    delete[] referenced;
+  }
+
+  void
+  vsreplacer_clock::Insert(int block, vsaddr /* addr */)
+  {
+    int prev;
+
+    referenced[block] = 0;
+    block_list[block] = 1;
+    if(hand == NIL || hand == ring.head) {
+      /* behind the hand is the end of the ring */
+      ListPushBack(ring, block);
+      if(hand == NIL)
+        hand = block;
+      return;
+    }
+    /* put it just behind the hand, so it is the last one the hand meets */
+    prev = block_prev[hand];
+    block_prev[block] = prev;
+    block_next[block] = hand;
+    block_next[prev] = block;
+    block_prev[hand] = block;
+    ++ring.size;
+    return;
+  }
+
+  void
+  vsreplacer_clock::Touch(int block)
+  {
+    referenced[block] = 1;
+    return;
+  }
+
+  void
+  vsreplacer_clock::Remove(int block, vsaddr /* addr */, int /* evicted */)
+  {
+    if(!block_list[block])
+      return;
+    if(hand == block) {
+      hand = block_next[block];
+      if(hand == NIL)
+        hand = ring.head;
+    }
+    ListUnlink(ring, block);
+    block_list[block] = 0;
+    if(ring.size == 0)
+      hand = NIL;
+    return;
+  }
+
+  int
+  vsreplacer_clock::Victim(vsaddr /* newaddr */)
+  {
+    int block;
+
+    if(hand == NIL)
+      return NIL;
+    /* at most one round clearing the bits */
+    while(referenced[hand]) {
+      referenced[hand] = 0;
+      hand = block_next[hand];
+      if(hand == NIL)
+        hand = ring.head;
+    }
+    block = hand;
+    hand = block_next[hand];
+    if(hand == NIL)
+      hand = ring.head;
+    return block;
+  }
+
+  int
+  vsreplacer_clock::Coldest()
+  {
+    return hand;
+  }
+
+  int
+  vsreplacer_clock::Warmer(int block)
+  {
+    /* one round from the hand, the reference bits are not looked at */
+    block = block_next[block];
+    if(block == NIL)
+      block = ring.head;
+    return (block == hand) ? NIL : block;
+  }
+
+  /*
+   * Implementation of class vsreplacer_2q
+   */
+
+  vsreplacer_2q::vsreplacer_2q(vsaddr n) :
+  vsreplacer(n),
+  kin((n / 4 > 0) ? n / 4 : 1)
+  {
+    ListInit(a1in);
+    ListInit(am);
+    /* A1out remembers the blocks of half of the cache */
+    a1out = new vsghost((n / 2 > 0) ? n / 2 : 1, 1);
+  }
+
+  vsreplacer_2q::~vsreplacer_2q()
+  {
+    delete a1out;
+  }
+
+  void
+  vsreplacer_2q::Insert(int block, vsaddr addr)
+  {
+    if(a1out->Find(addr) >= 0) {
+      /* requested again after leaving A1in, it is hot */
+      a1out->Erase(addr);
+      ListPushBack(am, block);
+      block_list[block] = IN_AM;
+    }
+    else {
+      ListPushBack(a1in, block);
+      block_list[block] = IN_A1IN;
+    }
+    return;
+  }
+
+  void
+  vsreplacer_2q::Touch(int block)
+  {
+    /* a hit in A1in is a correlated reference, leave it */
+    if(block_list[block] == IN_AM && block != am.tail) {
+      ListUnlink(am, block);
+      ListPushBack(am, block);
+    }
+    return;
+  }
+
+  void
+  vsreplacer_2q::Remove(int block, vsaddr addr, int evicted)
+  {
+    switch(block_list[block]) {
+      case IN_A1IN:
+        ListUnlink(a1in, block);
+        if(evicted)
+          a1out->PushBack(0, addr);
+        break;
+      case IN_AM:
+        ListUnlink(am, block);
+        break;
+    }
+    block_list[block] = IN_NONE;
+    return;
+  }
+
+  int
+  vsreplacer_2q::Victim(vsaddr /* newaddr */)
+  {
+    if(a1in.size > kin || am.head == NIL)
+      return a1in.head;
+    return am.head;
+  }
+
+  int
+  vsreplacer_2q::Coldest()
+  {
+    return ColdList().head;
+  }
+
+  int
+  vsreplacer_2q::Warmer(int block)
+  {
+    BlockList& first = ColdList();
+
+    /* the list Victim() takes from first, then the other one */
+    if(block_next[block] != NIL || block != first.tail)
+      return block_next[block];
+    return (&first == &a1in) ? am.head : a1in.head;
+  }
+
+  /*
+   * Implementation of class vsreplacer_arc
+   */
+
+  vsreplacer_arc::vsreplacer_arc(vsaddr n) :
+  vsreplacer(n)
+  {
+    ListInit(t1);
+    ListInit(t2);
+    /* B1 and B2 hold at most 2n - |T1| - |T2| addresses */
+    ghost = new vsghost(2 * n, 2);
+    target = 0;
+    adapted = 0;
+  }
+
+  vsreplacer_arc::~vsreplacer_arc()
+  {
+    delete ghost;
+  }
+
+  void
+  vsreplacer_arc::Adapt(int l)
+  {
+    vsaddr b1 = ghost->Size(B1), b2 = ghost->Size(B2), d;
+
+    if(l == B1) {
+      d = (b1 >= b2) ? 1 : b2 / b1;
+      target = (target + d < block_num) ? target + d : block_num;
+    }
+    else {
+      d = (b2 >= b1) ? 1 : b1 / b2;
+      target = (target > d) ? target - d : 0;
+    }
+    return;
+  }
+
+  void
+  vsreplacer_arc::Insert(int block, vsaddr addr)
+  {
+    int l = ghost->Find(addr);
+
+    if(l >= 0) {
+      /* a ghost hit, the block has been used more than once */
+      if(!adapted || adapted_addr != addr)
+        Adapt(l);
+      ghost->Erase(addr);
+      ListPushBack(t2, block);
+      block_list[block] = IN_T2;
+    }
+    else {
+      /* keep |T1| + |B1| and the whole directory within their sizes */
+      if(t1.size + ghost->Size(B1) >= block_num && ghost->Size(B1) > 0)
+        ghost->PopFront(B1);
+      else if(t1.size + t2.size + ghost->Size(B1) + ghost->Size(B2) >= 2 * block_num && ghost->Size(B2) > 0)
+        ghost->PopFront(B2);
+      ListPushBack(t1, block);
+      block_list[block] = IN_T1;
+    }
+    adapted = 0;
+    return;
+  }
+
+  void
+  vsreplacer_arc::Touch(int block)
+  {
+    switch(block_list[block]) {
+      case IN_T1:
+        ListUnlink(t1, block);
+        ListPushBack(t2, block);
+        block_list[block] = IN_T2;
+        break;
+      case IN_T2:
+        if(block != t2.tail) {
+          ListUnlink(t2, block);
+          ListPushBack(t2, block);
+        }
+        break;
+    }
+    return;
+  }
+
+  void
+  vsreplacer_arc::Remove(int block, vsaddr addr, int evicted)
+  {
+    switch(block_list[block]) {
+      case IN_T1:
+        ListUnlink(t1, block);
+        if(evicted)
+          ghost->PushBack(B1, addr);
+        break;
+      case IN_T2:
+        ListUnlink(t2, block);
+        if(evicted)
+          ghost->PushBack(B2, addr);
+        break;
+    }
+    block_list[block] = IN_NONE;
+    return;
+  }
+
+  int
+  vsreplacer_arc::Victim(vsaddr newaddr)
+  {
+    int l = ghost->Find(newaddr);
+
+    /* adapt the target before choosing, as ARC does */
+    if(l >= 0 && !(adapted && adapted_addr == newaddr)) {
+      Adapt(l);
+      adapted = 1;
+      adapted_addr = newaddr;
+    }
+    if(t1.head != NIL && (t1.size > target || (l == B2 && t1.size == target) || t2.head == NIL))
+      return t1.head;
+    return t2.head;
+  }
+
+  int
+  vsreplacer_arc::Coldest()
+  {
+    return ColdList().head;
+  }
+
+  int
+  vsreplacer_arc::Warmer(int block)
+  {
+    BlockList& first = ColdList();
+
+    if(block_next[block] != NIL || block != first.tail)
+      return block_next[block];
+    return (&first == &t1) ? t2.head : t1.head;
+  }
+
+} //end namespace vlaser
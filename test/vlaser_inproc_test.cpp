@@ -0,0 +1,287 @@
+#include "cpl.h"
+#include "lsal.h"
+#include "mpal_inproc.h"
+#include "vstype.h"
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+#define CLI_OUT(x) cout<<"|CLIENT| id "<<my_id<<" : "<<x<<endl
+
+using namespace std;
+using namespace vlaser;
+
+/* all nodes run in this process, one client thread for each node */
+const int my_vlaser_node_num = 8;
+const BlockSize my_blocksize = B4K;
+const vsaddr my_localsize = 1024;
+const int my_vscache_size = 256;
+const int my_worker_num = 4;
+const int RANDOM_COUNT = 1024;
+const vsaddr my_totalsize = my_vlaser_node_num * my_localsize;
+
+mpal_inproc* nodes[my_vlaser_node_num];
+cpl* cpls[my_vlaser_node_num];
+/* block b is written only by node b % my_vlaser_node_num, with the stamp
+ * my_id * RANDOM_COUNT + i + 1 in every word at iteration i, 0 is never written.
+ * stamps[b] is the last stamp of block b
+ */
+unsigned int stamps[my_totalsize];
+/* a quarter of the blocks are written in byte ranges at random offsets
+ * instead, by all nodes at once: node n writes only the n-th slice of a
+ * block, every byte 1 + n plus a multiple of my_vlaser_node_num.
+ * shadows keeps the bytes they should hold
+ */
+const int my_slice = my_blocksize / my_vlaser_node_num;
+vsbyte* shadows;
+int bads[my_vlaser_node_num];
+
+int
+IsPartial(vsaddr b)
+{
+  return (b / my_vlaser_node_num) % 4 == 0;
+}
+
+vsbyte*
+Shadow(vsaddr b)
+{
+  return shadows + (size_t)(b / my_vlaser_node_num / 4 * my_vlaser_node_num + b % my_vlaser_node_num) * my_blocksize;
+}
+
+/* return how many of the bytes read from off are not 0 or a byte of their slice's node */
+int
+ForeignBytes(const vsbyte* buf, int off, int size)
+{
+  int n = 0;
+
+  for(int j = 0; j < size; ++j)
+    if(buf[j] != 0 && (buf[j] - 1) % my_vlaser_node_num != (off + j) / my_slice)
+      ++n;
+  return n;
+}
+
+void
+StampBlock(vsbyte* buf, unsigned int stamp)
+{
+  unsigned int* p = (unsigned int*)buf;
+
+  for(unsigned int j = 0; j < my_blocksize / sizeof(unsigned int); ++j)
+    p[j] = stamp;
+}
+
+/* return the stamp of the block, or -1 if its words differ */
+long
+BlockStamp(const vsbyte* buf)
+{
+  const unsigned int* p = (const unsigned int*)buf;
+
+  for(unsigned int j = 1; j < my_blocksize / sizeof(unsigned int); ++j)
+    if(p[j] != p[0])
+      return -1;
+  return p[0];
+}
+
+void*
+client(void* arg)
+{
+  vsnodeid my_id = (vsnodeid)(long)arg;
+  vsbyte* my_buf;
+  vsaddr random_v;
+  long stamp;
+  int off, len, lo, hi;
+  vscache::Statistics st;
+  struct timeval tclo1, tclo2;
+  double tclo;
+
+  my_buf = new vsbyte[my_blocksize];
+  try {
+    cpls[my_id]->Initialize();
+
+    CLI_OUT("|BEGIN|begin testintg");
+    gettimeofday(&tclo1, NULL);
+    for(int i = 0; i < RANDOM_COUNT; ++i) {
+      random_v = random() % 2;
+      if(random_v) {
+        random_v = random() % my_totalsize;
+        if(IsPartial(random_v)) {
+          off = random() % my_blocksize;
+          len = 1 + random() % (my_blocksize - off);
+          cpls[my_id]->Read(random_v * my_blocksize + off, my_buf, len);
+          /* a byte of another slice's writer, or a stale byte of my own slice */
+          lo = max(off, (int)my_id * my_slice);
+          hi = min(off + len, ((int)my_id + 1) * my_slice);
+          if(ForeignBytes(my_buf, off, len) != 0
+             || (lo < hi && memcmp(my_buf + lo - off, Shadow(random_v) + lo, hi - lo) != 0)) {
+            CLI_OUT("|BAD|block "<<random_v<<" read bytes "<<off<<" to "<<off + len<<" are wrong");
+            ++bads[my_id];
+          }
+          continue;
+        }
+        cpls[my_id]->Read(random_v * my_blocksize, my_buf, my_blocksize);
+        /* a torn block, a stamp of another writer, or a stale stamp of my own */
+        stamp = BlockStamp(my_buf);
+        if(stamp == -1 || (stamp != 0 && (stamp - 1) / RANDOM_COUNT != random_v % my_vlaser_node_num)
+           || (random_v % my_vlaser_node_num == my_id && stamp != stamps[random_v])) {
+          CLI_OUT("|BAD|block "<<random_v<<" read stamp "<<stamp);
+          ++bads[my_id];
+        }
+      }
+      else {
+        random_v = random() % my_totalsize;
+        if(IsPartial(random_v)) {
+          /* any block, in my own slice */
+          off = my_id * my_slice + random() % my_slice;
+          len = 1 + random() % ((my_id + 1) * my_slice - off);
+          memset(my_buf, 1 + my_id + my_vlaser_node_num * (i % (255 / my_vlaser_node_num)), len);
+          memcpy(Shadow(random_v) + off, my_buf, len);
+          cpls[my_id]->Write(random_v * my_blocksize + off, my_buf, len);
+          continue;
+        }
+        random_v = random_v - random_v % my_vlaser_node_num + my_id;
+        stamps[random_v] = my_id * RANDOM_COUNT + i + 1;
+        StampBlock(my_buf, stamps[random_v]);
+        cpls[my_id]->Write(random_v * my_blocksize, my_buf, my_blocksize);
+      }
+    }
+    gettimeofday(&tclo2, NULL);
+
+    /* all writes done, every node sees the last stamps */
+    nodes[my_id]->Test(1);
+    for(vsaddr b = 0; b < my_totalsize; ++b) {
+      cpls[my_id]->Read(b * my_blocksize, my_buf, my_blocksize);
+      if(IsPartial(b)) {
+        if(memcmp(my_buf, Shadow(b), my_blocksize) != 0) {
+          CLI_OUT("|BAD|block "<<b<<" read bytes differ after writing");
+          ++bads[my_id];
+        }
+      }
+      else if(BlockStamp(my_buf) != stamps[b]) {
+        CLI_OUT("|BAD|block "<<b<<" read stamp "<<BlockStamp(my_buf)<<" after writing, want "<<stamps[b]);
+        ++bads[my_id];
+      }
+    }
+
+    /* every read and write is looked up once, and the cache is much
+     * smaller than the blocks, so the policy has replaced many of them
+     */
+    cpls[my_id]->GetCacheStatistics(st);
+    if(st.hits + st.misses != RANDOM_COUNT + my_totalsize || st.hits == 0 || st.evictions == 0
+       || st.evictions > st.misses || st.dirty_evictions > st.evictions) {
+      CLI_OUT("|BAD|cache statistics "<<st.hits<<" hits, "<<st.misses<<" misses, "<<st.evictions<<" evictions, "
+        <<st.dirty_evictions<<" dirty");
+      ++bads[my_id];
+    }
+    /* a durability barrier while the other nodes may still be reading */
+    cpls[my_id]->Sync();
+    CLI_OUT("|OK|testing done with "<<bads[my_id]<<" bad blocks, now shutdown...");
+
+    nodes[my_id]->Test(1);
+    if(my_id == 0)
+      cpls[my_id]->ShutDown();
+    else
+      cpls[my_id]->WaitShutDown();
+  }
+  catch(logic_error& exc) {
+    cout<<"|CLIENT RETHROW| id "<<my_id<<" "<<exc.what()<<endl;cout.flush();
+  }
+  catch(runtime_error& exc) {
+    cout<<"|CLIENT RETHROW| id "<<my_id<<" "<<exc.what()<<endl;cout.flush();
+  }
+
+  tclo = tclo2.tv_sec - tclo1.tv_sec + (tclo2.tv_usec - tclo1.tv_usec) / 1000000.0;
+  CLI_OUT("|FIN|finish testing, used "<<tclo<<" second wall time for "<<RANDOM_COUNT<<" IOs, so random access time is "
+<<tclo * 1000 / RANDOM_COUNT<<" milli second, IOPS is "<<RANDOM_COUNT / tclo);
+  delete[] my_buf;
+  return NULL;
+}
+
+/* run all nodes with the replacement policy, by sectors if sectored, return the bad blocks */
+int
+RunPolicy(ReplacementPolicy policy, int sectored)
+{
+  lsal* myls[my_vlaser_node_num];
+  pthread_t clients[my_vlaser_node_num];
+  char paths[my_vlaser_node_num][32];
+  vsbyte* buf;
+  int fd, bad = 0;
+
+  for(vsaddr b = 0; b < my_totalsize; ++b)
+    stamps[b] = 0;
+  memset(shadows, 0, (size_t)my_totalsize / 4 * my_blocksize);
+  for(int i = 0; i < my_vlaser_node_num; ++i) {
+    nodes[i] = NULL;
+    bads[i] = 0;
+  }
+  /* every node must be constructed before any cpl is initialized */
+  for(int i = 0; i < my_vlaser_node_num; ++i) {
+    new mpal_inproc(i, my_vlaser_node_num, nodes);
+    /* local storage in a zero filled temp file, so the data can be checked */
+    snprintf(paths[i], sizeof(paths[i]), "/tmp/vlaser_inproc_XXXXXX");
+    if((fd = mkstemp(paths[i])) == -1 || ftruncate(fd, (off_t)my_localsize * my_blocksize) != 0) {
+      cout<<"can not create local storage file "<<paths[i]<<endl;
+      return 1;
+    }
+    close(fd);
+    myls[i] = new lsal_fileemulate(my_blocksize, my_localsize, paths[i]);
+    cpls[i] = new cpl(my_blocksize, my_vscache_size, my_localsize, i, my_vlaser_node_num, nodes[i], myls[i],
+      my_worker_num, policy);
+    if(sectored)
+      cpls[i]->SetSectoredCoherence();
+  }
+  for(long i = 0; i < my_vlaser_node_num; ++i)
+    pthread_create(&clients[i], NULL, client, (void*)i);
+  for(int i = 0; i < my_vlaser_node_num; ++i)
+    pthread_join(clients[i], NULL);
+
+  /* after shutdown, the local storage holds the last stamps */
+  buf = new vsbyte[my_blocksize];
+  for(int i = 0; i < my_vlaser_node_num; ++i) {
+    bad += bads[i];
+    for(vsaddr k = 0; k < my_localsize; ++k) {
+      myls[i]->RdBlock(k, buf);
+      if(IsPartial(i * my_localsize + k)) {
+        if(memcmp(buf, Shadow(i * my_localsize + k), my_blocksize) != 0) {
+          cout<<"|BAD| block "<<i * my_localsize + k<<" stored bytes differ at shutdown"<<endl;
+          ++bad;
+        }
+      }
+      else if(BlockStamp(buf) != stamps[i * my_localsize + k]) {
+        cout<<"|BAD| block "<<i * my_localsize + k<<" stored stamp "<<BlockStamp(buf)<<" at shutdown, want "<<stamps[i * my_localsize + k]<<endl;
+        ++bad;
+      }
+    }
+  }
+  delete[] buf;
+  for(int i = 0; i < my_vlaser_node_num; ++i) {
+    delete cpls[i];
+    delete nodes[i];
+    delete myls[i];
+    unlink(paths[i]);
+  }
+  return bad;
+}
+
+int
+main()
+{
+  const ReplacementPolicy policies[] = {REPLACE_LRU, REPLACE_CLOCK, REPLACE_2Q, REPLACE_ARC};
+  const char* names[] = {"LRU", "CLOCK", "2Q", "ARC"};
+  int bad, all = 0;
+
+  shadows = new vsbyte[(size_t)my_totalsize / 4 * my_blocksize];
+  for(int p = 0; p < 4; ++p) {
+    bad = RunPolicy(policies[p], 0);
+    cout<<(bad ? "|FAIL| " : "|PASS| ")<<names[p]<<" : "<<bad<<" bad blocks"<<endl;
+    all += bad;
+  }
+  bad = RunPolicy(REPLACE_LRU, 1);
+  cout<<(bad ? "|FAIL| " : "|PASS| ")<<"LRU sectored : "<<bad<<" bad blocks"<<endl;
+  all += bad;
+  delete[] shadows;
+  return all ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+#include "vsdirectory.h"
+#include "vstype.h"
+#include <iostream>
+
+#define CHECK(x) do { if(!(x)) { cout<<"|BAD| line "<<__LINE__<<" : "#x<<endl; ++bad; } } while(0)
+
+using namespace std;
+using namespace vlaser;
+
+int bad = 0;
+
+/* the holders listed are ascending, n of them, and each one is Has() */
+void
+CheckList(vsdirectory& dir, vsaddr laddr, int n)
+{
+  vsnodeid* list = new vsnodeid[dir.node_num];
+  int got = dir.List(laddr, list);
+
+  CHECK(got == n);
+  CHECK(dir.Count(laddr) == n);
+  for(int i = 0; i < got; ++i) {
+    CHECK(dir.Has(laddr, list[i]));
+    if(i > 0)
+      CHECK(list[i - 1] < list[i]);
+  }
+  delete[] list;
+}
+
+/* small cluster, one bit for each node, always exact */
+void
+TestBits()
+{
+  vsdirectory dir(8, 100);
+  vsnodeid list[100];
+
+  CHECK(dir.Count(0) == 0);
+  dir.Insert(0, 99);
+  dir.Insert(0, 0);
+  dir.Insert(0, 64);
+  dir.Insert(0, 64);
+  CheckList(dir, 0, 3);
+  dir.List(0, list);
+  CHECK(list[0] == 0 && list[1] == 64 && list[2] == 99);
+  dir.Erase(0, 64);
+  CHECK(!dir.Has(0, 64));
+  CheckList(dir, 0, 2);
+  CHECK(dir.Count(1) == 0); /* entries do not share holders */
+  dir.Clear(0);
+  CheckList(dir, 0, 0);
+}
+
+/* large cluster, VSDIRECTORY_POINTER_NUM exact ids, then a coarse vector */
+void
+TestPointers(vsnodeid nm)
+{
+  vsdirectory dir(4, nm);
+  vsnodeid group = (nm + VSDIRECTORY_BITS_NODE_MAX - 1) / VSDIRECTORY_BITS_NODE_MAX;
+  vsnodeid* list = new vsnodeid[nm];
+  vsnodeid ids[VSDIRECTORY_POINTER_NUM + 1];
+  vsnodeid extra = nm - 1; /* the last group may be shorter than the others */
+  int n;
+
+  for(int i = 0; i < VSDIRECTORY_POINTER_NUM; ++i)
+    ids[i] = (nm / VSDIRECTORY_POINTER_NUM) * (VSDIRECTORY_POINTER_NUM - 1 - i) + 1;
+  ids[VSDIRECTORY_POINTER_NUM] = extra;
+
+  /* exact while the ids fit, in any inserting order */
+  for(int i = 0; i < VSDIRECTORY_POINTER_NUM; ++i)
+    dir.Insert(2, ids[i]);
+  dir.Insert(2, ids[0]);
+  CheckList(dir, 2, VSDIRECTORY_POINTER_NUM);
+  for(int i = 0; i < VSDIRECTORY_POINTER_NUM; ++i)
+    CHECK(dir.Has(2, ids[i]));
+  CHECK(!dir.Has(2, ids[0] + 1));
+  dir.Erase(2, ids[1]);
+  CHECK(!dir.Has(2, ids[1]));
+  CheckList(dir, 2, VSDIRECTORY_POINTER_NUM - 1);
+  dir.Insert(2, ids[1]);
+
+  /* one more id turns the entry coarse, a superset of the holders */
+  dir.Insert(2, extra);
+  n = 0;
+  for(int i = 0; i <= VSDIRECTORY_POINTER_NUM; ++i) {
+    CHECK(dir.Has(2, ids[i]));
+    n += (ids[i] / group + 1) * group <= nm ? group : nm - ids[i] / group * group;
+  }
+  CHECK(group == 1 || dir.Has(2, ids[0] - 1)); /* a group mate of ids[0] */
+  CHECK(!dir.Has(2, (ids[0] / group + 1) * group)); /* the next group */
+  CheckList(dir, 2, n);
+  CHECK(dir.List(2, list) == n);
+  CHECK(list[n - 1] == nm - 1);
+  /* erasing keeps the group's bit, other nodes of it may hold the block */
+  dir.Erase(2, ids[0]);
+  CHECK(dir.Has(2, ids[0]));
+  CheckList(dir, 2, n);
+
+  /* clearing makes it exact again */
+  dir.Clear(2);
+  CheckList(dir, 2, 0);
+  CHECK(!dir.Has(2, ids[0]));
+  dir.Insert(2, ids[0]);
+  CheckList(dir, 2, 1);
+  CHECK(dir.Has(2, ids[0]) && !dir.Has(2, ids[0] - 1));
+
+  /* the other entries are untouched */
+  CheckList(dir, 1, 0);
+  CheckList(dir, 3, 0);
+  delete[] list;
+}
+
+int
+main()
+{
+  TestBits();
+  /* groups of 4 nodes, and groups of 3 with a last group of 2 nodes */
+  TestPointers(512);
+  TestPointers(VSDIRECTORY_BITS_NODE_MAX * 2 + 1);
+  cout<<(bad ? "|FAIL| " : "|PASS| ")<<bad<<" bad checks"<<endl;
+  return bad ? 1 : 0;
+}